@@ -73,7 +73,8 @@ struct BOOST_CONTEXT_DECL activation_record {
     stack_context                                               sctx{};
     bool                                                        main_ctx{ true };
 	activation_record                                       *	from{ nullptr };
-    std::function< activation_record*(activation_record*&) >    ontop{};
+    activation_record * (* ontop)( activation_record *&, void *){ nullptr };
+    void                                                    *   ontop_arg{ nullptr };
     bool                                                        terminated{ false };
     bool                                                        force_unwind{ false };
 #if defined(BOOST_USE_ASAN)
@@ -147,36 +148,11 @@ struct BOOST_CONTEXT_DECL activation_record {
         // `this` will become the active (running) context
         // returned by continuation::current()
         current() = this;
-#if defined(BOOST_NO_CXX14_GENERIC_LAMBDAS)
-        current()->ontop = std::bind(
-                [](typename std::decay< Fn >::type & fn, activation_record *& ptr){
-                    Ctx c{ ptr };
-                    c = fn( std::move( c) );
-                    if ( ! c) {
-                        ptr = nullptr;
-                    }
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-                    return exchange( c.ptr_, nullptr);
-#else
-                    return std::exchange( c.ptr_, nullptr);
-#endif
-                },
-                std::forward< Fn >( fn),
-                std::placeholders::_1);
-#else
-        current()->ontop = [fn=std::forward<Fn>(fn)](activation_record *& ptr){
-            Ctx c{ ptr };
-            c = fn( std::move( c) );
-            if ( ! c) {
-                ptr = nullptr;
-            }
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-            return exchange( c.ptr_, nullptr);
-#else
-            return std::exchange( c.ptr_, nullptr);
-#endif
-        };
-#endif
+        // `p` lives on the stack of the resuming context, which stays
+        // suspended until `this`-context has executed the function
+        typename std::decay< Fn >::type p = std::forward< Fn >( fn);
+        current()->ontop = & activation_record::invoke_ontop< Ctx, decltype(p) >;
+        current()->ontop_arg = & p;
 #if defined(BOOST_USE_SEGMENTED_STACKS)
         // adjust segmented stack properties
         __splitstack_getcontext( from->sctx.segments_ctx);
@@ -199,6 +175,20 @@ struct BOOST_CONTEXT_DECL activation_record {
 #endif
     }
 
+    template< typename Ctx, typename Fn >
+    static activation_record * invoke_ontop( activation_record *& ptr, void * arg) {
+        Ctx c{ ptr };
+        c = ( * static_cast< Fn * >( arg) )( std::move( c) );
+        if ( ! c) {
+            ptr = nullptr;
+        }
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+        return exchange( c.ptr_, nullptr);
+#else
+        return std::exchange( c.ptr_, nullptr);
+#endif
+    }
+
     virtual void deallocate() noexcept {
     }
 };
@@ -424,7 +414,8 @@ public:
         if ( BOOST_UNLIKELY( detail::activation_record::current()->force_unwind) ) {
             throw detail::forced_unwind{ ptr};
         } else if ( BOOST_UNLIKELY( nullptr != detail::activation_record::current()->ontop) ) {
-            ptr = detail::activation_record::current()->ontop( ptr);
+            ptr = detail::activation_record::current()->ontop(
+                    ptr, detail::activation_record::current()->ontop_arg);
             detail::activation_record::current()->ontop = nullptr;
         }
         return { ptr };
@@ -447,7 +438,8 @@ public:
         if ( BOOST_UNLIKELY( detail::activation_record::current()->force_unwind) ) {
             throw detail::forced_unwind{ ptr};
         } else if ( BOOST_UNLIKELY( nullptr != detail::activation_record::current()->ontop) ) {
-            ptr = detail::activation_record::current()->ontop( ptr);
+            ptr = detail::activation_record::current()->ontop(
+                    ptr, detail::activation_record::current()->ontop_arg);
             detail::activation_record::current()->ontop = nullptr;
         }
         return { ptr };
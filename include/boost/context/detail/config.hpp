@@ -124,6 +124,47 @@ static constexpr std::size_t prefetch_stride{ 4 * cacheline_length };
 # include <cxxabi.h>
 #endif
 
+// the fiber hooks, the fiber arena and the propagation of exceptions change
+// the layout of the control structures; translation units and the library
+// built with different settings declare them in distinct inline namespaces
+// (no ODR violation), references to the library fail to link on a mismatch
+#if defined(BOOST_USE_FIBER_HOOKS) && defined(BOOST_USE_FIBER_ARENA) && defined(BOOST_USE_FIBER_EXCEPTIONS)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_hooks_arena_exceptions {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_HOOKS) && defined(BOOST_USE_FIBER_ARENA)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_hooks_arena {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_HOOKS) && defined(BOOST_USE_FIBER_EXCEPTIONS)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_hooks_exceptions {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_ARENA) && defined(BOOST_USE_FIBER_EXCEPTIONS)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_arena_exceptions {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_HOOKS)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_hooks {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_ARENA)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_arena {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#elif defined(BOOST_USE_FIBER_EXCEPTIONS)
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN inline namespace abi_exceptions {
+# define BOOST_CONTEXT_FIBER_ABI_END }
+#else
+# define BOOST_CONTEXT_FIBER_ABI_BEGIN
+# define BOOST_CONTEXT_FIBER_ABI_END
+#endif
+
+// a program containing both backends (performance/backends) compiles the
+// ucontext_t backend with BOOST_CONTEXT_UCONTEXT_NAMESPACE; the library is
+// built without it, its symbols are unchanged
+#if defined(BOOST_CONTEXT_UCONTEXT_NAMESPACE)
+# define BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN inline namespace ucontext_impl {
+# define BOOST_CONTEXT_UCONTEXT_NAMESPACE_END }
+#else
+# define BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN
+# define BOOST_CONTEXT_UCONTEXT_NAMESPACE_END
+#endif
+
 #if defined(__OpenBSD__)
 // stacks need mmap(2) with MAP_STACK
 # define BOOST_CONTEXT_USE_MAP_STACK
@@ -10,6 +10,7 @@
 #include <boost/assert.hpp>
 #include <boost/config.hpp>
 
+#include <boost/context/detail/config.hpp>
 #include <boost/context/detail/fcontext.hpp>
 
 #ifdef BOOST_HAS_ABI_HEADERS
@@ -19,9 +20,14 @@
 namespace boost {
 namespace context {
 namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
 
 struct forced_unwind {
     fcontext_t  fctx{ nullptr };
+#if defined(BOOST_USE_FIBER_HOOKS) || defined(BOOST_USE_FIBER_ARENA) || defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // identity of the context that forced the unwinding
+    void    *   data{ nullptr };
+#endif
 #ifndef BOOST_ASSERT_IS_VOID
     bool        caught{ false };
 #endif
@@ -32,6 +38,13 @@ struct forced_unwind {
         fctx( fctx_) {
     }
 
+#if defined(BOOST_USE_FIBER_HOOKS) || defined(BOOST_USE_FIBER_ARENA) || defined(BOOST_USE_FIBER_EXCEPTIONS)
+    forced_unwind( fcontext_t fctx_, void * data_) :
+        fctx( fctx_),
+        data( data_) {
+    }
+#endif
+
 #ifndef BOOST_ASSERT_IS_VOID
     ~forced_unwind() {
         BOOST_ASSERT( caught);
@@ -39,6 +52,7 @@ struct forced_unwind {
 #endif
 };
 
+BOOST_CONTEXT_FIBER_ABI_END
 }}}
 
 #ifdef BOOST_HAS_ABI_HEADERS
@@ -0,0 +1,38 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_DETAIL_FIBER_ARENA_H
+#define BOOST_CONTEXT_DETAIL_FIBER_ARENA_H
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_ARENA)
+
+namespace boost {
+namespace context {
+namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+// releases the arena (fiber_arena.hpp) held by the record of a fiber,
+// invoked before its stack gets deallocated
+BOOST_CONTEXT_DECL void fiber_arena_release( void *) noexcept;
+
+BOOST_CONTEXT_FIBER_ABI_END
+}}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_DETAIL_FIBER_ARENA_H
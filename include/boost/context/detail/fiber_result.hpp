@@ -0,0 +1,132 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_DETAIL_FIBER_RESULT_H
+#define BOOST_CONTEXT_DETAIL_FIBER_RESULT_H
+
+#include <exception>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#if defined(BOOST_NO_CXX17_STD_INVOKE)
+#include <boost/context/detail/invoke.hpp>
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+namespace detail {
+
+// value or exception produced by the function of a fiber_task
+template< typename T >
+class fiber_result {
+private:
+    static_assert( std::is_object< T >::value, "fiber_task<T> requires an object type or void");
+
+    typename std::aligned_storage< sizeof( T), alignof( T) >::type  storage_;
+    std::exception_ptr                                              except_{};
+    bool                                                            has_value_{ false };
+
+public:
+    fiber_result() noexcept = default;
+
+    fiber_result( fiber_result const&) = delete;
+    fiber_result & operator=( fiber_result const&) = delete;
+
+    ~fiber_result() {
+        if ( has_value_) {
+            reinterpret_cast< T * >( & storage_)->~T();
+        }
+    }
+
+    template< typename Fn, typename Arg >
+    void call( Fn & fn, Arg & arg) {
+        BOOST_ASSERT( ! has_value_);
+#if defined(BOOST_NO_CXX17_STD_INVOKE)
+        ::new ( static_cast< void * >( & storage_) ) T( boost::context::detail::invoke( fn, arg) );
+#else
+        ::new ( static_cast< void * >( & storage_) ) T( std::invoke( fn, arg) );
+#endif
+        has_value_ = true;
+    }
+
+    void set_exception( std::exception_ptr except) noexcept {
+        except_ = std::move( except);
+    }
+
+    T get() {
+        if ( except_) {
+            std::rethrow_exception( std::move( except_) );
+        }
+        BOOST_ASSERT( has_value_);
+        return std::move( * reinterpret_cast< T * >( & storage_) );
+    }
+};
+
+template<>
+class fiber_result< void > {
+private:
+    std::exception_ptr                                              except_{};
+
+public:
+    fiber_result() noexcept = default;
+
+    fiber_result( fiber_result const&) = delete;
+    fiber_result & operator=( fiber_result const&) = delete;
+
+    template< typename Fn, typename Arg >
+    void call( Fn & fn, Arg & arg) {
+#if defined(BOOST_NO_CXX17_STD_INVOKE)
+        boost::context::detail::invoke( fn, arg);
+#else
+        std::invoke( fn, arg);
+#endif
+    }
+
+    void set_exception( std::exception_ptr except) noexcept {
+        except_ = std::move( except);
+    }
+
+    void get() {
+        if ( except_) {
+            std::rethrow_exception( std::move( except_) );
+        }
+    }
+};
+
+// part of the record of a fiber_task that does not depend on the stack
+// allocator and the function; the record is not released when the fiber
+// terminates but by the task after the result has been moved out
+template< typename T >
+struct fiber_task_slot {
+    fiber_result< T >                   result{};
+    void                             (* release)( fiber_task_slot *) noexcept{ nullptr };
+};
+
+// passed as function to create_fiber1/create_fiber2, the record stores
+// the address of its slot in `slot`
+template< typename T, typename Fn >
+struct fiber_task_args {
+    Fn                              &&  fn;
+    fiber_task_slot< T >            **  slot;
+};
+
+}}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_DETAIL_FIBER_RESULT_H
@@ -0,0 +1,160 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_DETAIL_FRAME_WALK_H
+#define BOOST_CONTEXT_DETAIL_FRAME_WALK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+
+#if defined(__linux__) && ( defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) )
+# define BOOST_CONTEXT_HAS_INTERRUPTED_FRAME
+extern "C" {
+# include <pthread.h>
+# include <ucontext.h>
+}
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+namespace detail {
+
+// frame pointer chains: each frame holds the caller's frame pointer
+// followed by the return address (x86, AArch64); the code must be
+// compiled with -fno-omit-frame-pointer
+
+inline
+bool is_frame( char const* fp, char const* low, char const* high) noexcept {
+    return fp >= low && fp + 2 * sizeof( void *) <= high &&
+           0 == reinterpret_cast< std::uintptr_t >( fp) % sizeof( void *);
+}
+
+// invokes fn( pc) followed by fn( return address) for each frame starting
+// at fp until fn returns false; reads only memory in [low,high),
+// async-signal-safe
+template< typename Fn >
+std::size_t walk_frames( void * pc, char * fp, char const* low, char const* high, Fn && fn) noexcept {
+    std::size_t depth = 0;
+    if ( ! fn( pc) ) {
+        return depth;
+    }
+    ++depth;
+    while ( is_frame( fp, low, high) ) {
+        void ** frame = reinterpret_cast< void ** >( fp);
+        if ( nullptr == frame[1] || ! fn( frame[1]) ) {
+            break;
+        }
+        ++depth;
+        char * next = static_cast< char * >( frame[0]);
+        if ( next <= fp) {
+            break;
+        }
+        fp = next;
+    }
+    return depth;
+}
+
+// stores pc followed by the return addresses of the frames starting at fp
+inline
+std::size_t walk_frames( void ** pcs, std::size_t size, void * pc,
+                         char * fp, char const* low, char const* high) noexcept {
+    std::size_t depth = 0;
+    return walk_frames( pc, fp, low, high,
+            [pcs,size,&depth]( void * addr) noexcept {
+                if ( depth == size) {
+                    return false;
+                }
+                pcs[depth++] = addr;
+                return true;
+            });
+}
+
+// frame of the function that suspended a context, given the frame of a
+// switch hook (hook <- hook dispatch <- suspending function); the frame
+// stays valid while the context is suspended
+inline
+bool parked_frame( char * fp, char const* low, char const* high,
+                   void *& parked_fp, void *& parked_pc) noexcept {
+    parked_fp = parked_pc = nullptr;
+    if ( ! is_frame( fp, low, high) ) {
+        return false;
+    }
+    char * dispatch = * reinterpret_cast< char ** >( fp);
+    if ( dispatch <= fp || ! is_frame( dispatch, low, high) ) {
+        return false;
+    }
+    void ** frame = reinterpret_cast< void ** >( dispatch);
+    if ( ! is_frame( static_cast< char * >( frame[0]), dispatch, high) ) {
+        return false;
+    }
+    parked_fp = frame[0];
+    parked_pc = frame[1];
+    return true;
+}
+
+// stack of the calling thread; false if not known
+inline
+bool thread_stack( char *& low, char *& high) noexcept {
+    low = high = nullptr;
+#if defined(BOOST_CONTEXT_HAS_INTERRUPTED_FRAME)
+    pthread_attr_t attr;
+    if ( 0 != ::pthread_getattr_np( ::pthread_self(), & attr) ) {
+        return false;
+    }
+    void * addr = nullptr;
+    std::size_t size = 0;
+    if ( 0 == ::pthread_attr_getstack( & attr, & addr, & size) ) {
+        low = static_cast< char * >( addr);
+        high = low + size;
+    }
+    ::pthread_attr_destroy( & attr);
+#endif
+    return nullptr != low;
+}
+
+// registers of the context interrupted by a signal (third argument of a
+// SA_SIGINFO handler); false if not supported
+inline
+bool interrupted_frame( void * vp, void *& pc, char *& fp, char *& sp) noexcept {
+#if defined(BOOST_CONTEXT_HAS_INTERRUPTED_FRAME)
+    ucontext_t const* uc = static_cast< ucontext_t const* >( vp);
+# if defined(__x86_64__)
+    pc = reinterpret_cast< void * >( uc->uc_mcontext.gregs[REG_RIP]);
+    fp = reinterpret_cast< char * >( uc->uc_mcontext.gregs[REG_RBP]);
+    sp = reinterpret_cast< char * >( uc->uc_mcontext.gregs[REG_RSP]);
+# elif defined(__i386__)
+    pc = reinterpret_cast< void * >( uc->uc_mcontext.gregs[REG_EIP]);
+    fp = reinterpret_cast< char * >( uc->uc_mcontext.gregs[REG_EBP]);
+    sp = reinterpret_cast< char * >( uc->uc_mcontext.gregs[REG_ESP]);
+# else
+    pc = reinterpret_cast< void * >( uc->uc_mcontext.pc);
+    fp = reinterpret_cast< char * >( uc->uc_mcontext.regs[29]);
+    sp = reinterpret_cast< char * >( uc->uc_mcontext.sp);
+# endif
+    return true;
+#else
+    ( void) vp;
+    pc = nullptr;
+    fp = sp = nullptr;
+    return false;
+#endif
+}
+
+}}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_DETAIL_FRAME_WALK_H
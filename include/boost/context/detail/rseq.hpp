@@ -0,0 +1,181 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_DETAIL_RSEQ_H
+#define BOOST_CONTEXT_DETAIL_RSEQ_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+
+#if defined(__linux__)
+extern "C" {
+# include <sched.h>
+}
+#endif
+
+// restartable sequences registered by glibc (2.35 or later); defining
+// BOOST_CONTEXT_NO_RSEQ selects the fallback without rseq
+#if defined(__linux__) && defined(__x86_64__) && defined(__GNUC__) && defined(__has_include) && \
+    ! defined(BOOST_CONTEXT_NO_RSEQ)
+# if __has_include(<sys/rseq.h>)
+extern "C" {
+#  include <sys/rseq.h>
+}
+#  if defined(RSEQ_SIG)
+#   define BOOST_CONTEXT_HAS_RSEQ
+#  endif
+# endif
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+namespace detail {
+
+// per-CPU arrays of words: the first word counts the used slots (rseq
+// only), the slots follow
+//
+// the rseq operations run as critical sections the kernel restarts at
+// the abort handler if the thread is preempted, migrated or signaled
+// before the final store (commit); they neither lock nor use atomic
+// read-modify-write instructions
+
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+
+static_assert( 0x53053053 == RSEQ_SIG, "signature of the abort handlers");
+
+// area of the calling thread; nullptr if the registration is disabled
+// (glibc.pthread.rseq=0) or the kernel does not support rseq
+inline
+struct rseq * rseq_area() noexcept {
+    if ( 0 == __rseq_size) {
+        return nullptr;
+    }
+    char * tp;
+    __asm__ ( "movq %%fs:0, %0" : "=r" ( tp) );
+    return reinterpret_cast< struct rseq * >( tp + __rseq_offset);
+}
+
+inline
+std::uint32_t rseq_cpu( struct rseq const* rs) noexcept {
+    return * static_cast< std::uint32_t const volatile * >( & rs->cpu_id_start);
+}
+
+// returns 0 if `p` has been stored, 1 if the array is full and -1 if the
+// critical section has been aborted (the caller reads the CPU again)
+inline
+int rseq_push( struct rseq * rs, std::uint32_t cpu, std::uintptr_t * words,
+               std::uintptr_t capacity, std::uintptr_t p) noexcept {
+    __asm__ goto (
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"
+        ".quad 1f, (2f - 1f), 4f\n\t"
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %[rseq_cs]\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %[cpu_id]\n\t"
+        "jnz 4f\n\t"
+        "movq (%[words]), %%rax\n\t"
+        "cmpq %[capacity], %%rax\n\t"
+        "jae %l[full]\n\t"
+        "movq %[p], 8(%[words], %%rax, 8)\n\t"
+        "addq $1, %%rax\n\t"
+        // commit
+        "movq %%rax, (%[words])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        // ud1 with the signature as displacement
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [rseq_cs] "m" ( rs->rseq_cs), [cpu_id] "m" ( rs->cpu_id), [cpu] "r" ( cpu),
+          [words] "r" ( words), [capacity] "r" ( capacity), [p] "r" ( p)
+        : "rax", "memory", "cc"
+        : full, abort);
+    return 0;
+full:
+    return 1;
+abort:
+    return -1;
+}
+
+// returns 0 if a slot has been removed and stored in `p`, 1 if the array
+// is empty and -1 if the critical section has been aborted
+inline
+int rseq_pop( struct rseq * rs, std::uint32_t cpu, std::uintptr_t * words,
+              std::uintptr_t * p) noexcept {
+    __asm__ goto (
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"
+        ".quad 1f, (2f - 1f), 4f\n\t"
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %[rseq_cs]\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %[cpu_id]\n\t"
+        "jnz 4f\n\t"
+        "movq (%[words]), %%rax\n\t"
+        "testq %%rax, %%rax\n\t"
+        "jz %l[empty]\n\t"
+        "movq (%[words], %%rax, 8), %%rcx\n\t"
+        "movq %%rcx, (%[p])\n\t"
+        "subq $1, %%rax\n\t"
+        // commit
+        "movq %%rax, (%[words])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [rseq_cs] "m" ( rs->rseq_cs), [cpu_id] "m" ( rs->cpu_id), [cpu] "r" ( cpu),
+          [words] "r" ( words), [p] "r" ( p)
+        : "rax", "rcx", "memory", "cc"
+        : empty, abort);
+    return 0;
+empty:
+    return 1;
+abort:
+    return -1;
+}
+
+#endif
+
+// CPU the calling thread runs on, 0 if not known
+inline
+std::size_t current_cpu() noexcept {
+#if defined(__linux__)
+    int cpu = ::sched_getcpu();
+    return 0 < cpu ? static_cast< std::size_t >( cpu) : 0;
+#else
+    return 0;
+#endif
+}
+
+}}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_DETAIL_RSEQ_H
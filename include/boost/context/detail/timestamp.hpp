@@ -0,0 +1,75 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_DETAIL_TIMESTAMP_H
+#define BOOST_CONTEXT_DETAIL_TIMESTAMP_H
+
+#include <chrono>
+#include <cstdint>
+
+#include <boost/config.hpp>
+#include <boost/predef.h>
+
+#include <boost/context/detail/config.hpp>
+
+#if BOOST_ARCH_X86
+# if BOOST_COMP_MSVC
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+namespace detail {
+
+// cheap timestamp taken on context switches; not serializing
+// x86: time-stamp counter (invariant TSC on modern CPUs)
+// other: steady clock in nano seconds
+BOOST_FORCEINLINE
+std::uint64_t timestamp() noexcept {
+#if BOOST_ARCH_X86
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+// ticks of timestamp() per second; calibrated once against the steady clock
+inline
+double timestamp_frequency() noexcept {
+#if BOOST_ARCH_X86
+    static const double frequency = [](){
+        typedef std::chrono::steady_clock clock_type;
+        clock_type::time_point start = clock_type::now();
+        std::uint64_t tsc_start = timestamp();
+        clock_type::time_point now;
+        do {
+            now = clock_type::now();
+        } while ( now - start < std::chrono::milliseconds( 10) );
+        std::uint64_t tsc_end = timestamp();
+        return static_cast< double >( tsc_end - tsc_start) /
+            std::chrono::duration_cast< std::chrono::duration< double > >( now - start).count();
+    }();
+    return frequency;
+#else
+    return 1e9;
+#endif
+}
+
+}}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_DETAIL_TIMESTAMP_H
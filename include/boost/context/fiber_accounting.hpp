@@ -0,0 +1,57 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_ACCOUNTING_H
+#define BOOST_CONTEXT_FIBER_ACCOUNTING_H
+
+#include <chrono>
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+struct fiber_cpu_usage {
+    // cumulative time the context was running
+    std::chrono::nanoseconds    run_time{ 0 };
+    // number of times the context was switched to
+    std::uint64_t               resumes{ 0 };
+    // longest single run
+    std::chrono::nanoseconds    max_slice{ 0 };
+};
+
+// starts accounting on-CPU time and resumes of each execution context;
+// only runs that begin after this call are accounted
+// returns false if no hook table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_accounting() noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_accounting() noexcept;
+
+// counters of a context, e.g. current_fiber_info() or fiber::info();
+// the run in progress of the running context is not included
+BOOST_CONTEXT_DECL fiber_cpu_usage fiber_usage( fiber_info const*) noexcept;
+
+BOOST_CONTEXT_DECL void reset_fiber_usage( fiber_info *) noexcept;
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_ACCOUNTING_H
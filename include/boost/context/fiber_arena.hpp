@@ -0,0 +1,57 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_ARENA_H
+#define BOOST_CONTEXT_FIBER_ARENA_H
+
+#include <cstddef>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+
+#if defined(__has_include)
+# if __has_include(<memory_resource>) && \
+     ( __cplusplus >= 201703L || ( defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) )
+#  include <memory_resource>
+#  define BOOST_CONTEXT_HAS_MEMORY_RESOURCE
+# endif
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_ARENA) && defined(BOOST_CONTEXT_HAS_MEMORY_RESOURCE) && ! defined(BOOST_USE_WINFIB)
+
+// bytes of the first block of an arena (holding the arena itself);
+// further blocks grow geometrically
+# if ! defined(BOOST_CONTEXT_FIBER_ARENA_SIZE)
+#  define BOOST_CONTEXT_FIBER_ARENA_SIZE 4096
+# endif
+
+namespace boost {
+namespace context {
+
+// monotonic memory resource of the running fiber, created on first use;
+// deallocation is a no-op, the memory is released at once when the stack of
+// the fiber is deallocated - allocated objects must not outlive the fiber
+// returns std::pmr::get_default_resource() for the main context of a thread
+// or if the arena could not be allocated
+BOOST_CONTEXT_DECL std::pmr::memory_resource * fiber_memory_resource() noexcept;
+
+// bytes allocated from the arena of the running fiber
+BOOST_CONTEXT_DECL std::size_t fiber_arena_used() noexcept;
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_ARENA_H
@@ -0,0 +1,79 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_BACKTRACE_H
+#define BOOST_CONTEXT_FIBER_BACKTRACE_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+// maximum number of contexts in the resume chain of a thread
+# if ! defined(BOOST_CONTEXT_BACKTRACE_MAX_CHAIN)
+#  define BOOST_CONTEXT_BACKTRACE_MAX_CHAIN 32
+# endif
+
+namespace boost {
+namespace context {
+
+struct fiber_frame {
+    // return address
+    void                *   pc{ nullptr };
+    // context on whose stack the frame lives
+    fiber_info          *   fiber{ nullptr };
+};
+
+// records on each context switch the frame of the suspended context and the
+// chain of contexts that resumed each other on a thread
+// returns false if not supported (Linux on x86 or AArch64) or if no hook
+// table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_backtrace() noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_backtrace() noexcept;
+
+// frames of the caller walked along the frame pointers, bounded by the
+// stack_context, followed by the frames of the suspended contexts that
+// (transitively) resumed the calling context; innermost first
+// async-signal-safe once the thread has switched with the backtrace started
+BOOST_CONTEXT_DECL std::size_t fiber_backtrace( fiber_frame * frames, std::size_t size) noexcept;
+
+// frames of a suspended fiber, 0 if it has not been suspended while the
+// backtrace (or the profiler) was started
+BOOST_CONTEXT_DECL std::size_t parked_fiber_backtrace(
+        fiber_info const* info, fiber_frame * frames, std::size_t size) noexcept;
+
+// one line per frame (symbolized by dladdr()), preceded by a line naming
+// the context each time the context changes
+BOOST_CONTEXT_DECL void write_fiber_backtrace( std::ostream &, fiber_frame const* frames, std::size_t size);
+
+namespace detail {
+
+// function name (demangled) of a code address, module and offset or
+// the address if not known; `leaf` is false for return addresses
+BOOST_CONTEXT_DECL std::string frame_symbol( void * pc, bool leaf);
+
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_BACKTRACE_H
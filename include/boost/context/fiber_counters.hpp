@@ -0,0 +1,67 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_COUNTERS_H
+#define BOOST_CONTEXT_FIBER_COUNTERS_H
+
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+// events counted in user mode while the context was running
+struct fiber_counters {
+    std::uint64_t           instructions{ 0 };
+    std::uint64_t           cycles{ 0 };
+    std::uint64_t           cache_misses{ 0 };
+    std::uint64_t           branch_misses{ 0 };
+};
+
+// how the counters are read by the calling thread
+enum class fiber_counters_access {
+    // not available (no perf events or not started)
+    none,
+    // read() system call on each switch
+    read,
+    // rdpmc instruction on each switch, no system call
+    rdpmc
+};
+
+// starts attributing hardware events (fiber_counters) to execution contexts;
+// each thread opens a perf_event group on its first switch
+// returns false if the calling thread can not open the perf_event group
+// (Linux only, see /proc/sys/kernel/perf_event_paranoid) or if no hook table
+// could be installed
+BOOST_CONTEXT_DECL bool start_fiber_counters() noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_counters() noexcept;
+
+// events of a context, e.g. current_fiber_info() or fiber::info();
+// the run in progress of the running context is not included
+BOOST_CONTEXT_DECL fiber_counters fiber_counters_of( fiber_info const*) noexcept;
+
+BOOST_CONTEXT_DECL fiber_counters_access fiber_counters_access_of_thread() noexcept;
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_COUNTERS_H
@@ -18,10 +18,14 @@
 #include <memory>
 #include <ostream>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 #include <boost/assert.hpp>
 #include <boost/config.hpp>
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+#include <boost/core/uncaught_exceptions.hpp>
+#endif
 #include <boost/intrusive_ptr.hpp>
 
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
@@ -33,7 +37,10 @@
 #include <boost/context/detail/disable_overload.hpp>
 #include <boost/context/detail/exception.hpp>
 #include <boost/context/detail/fcontext.hpp>
+#include <boost/context/detail/fiber_arena.hpp>
+#include <boost/context/detail/fiber_result.hpp>
 #include <boost/context/detail/tuple.hpp>
+#include <boost/context/fiber_hooks.hpp>
 #include <boost/context/fixedsize_stack.hpp>
 #include <boost/context/flags.hpp>
 #include <boost/context/preallocated.hpp>
@@ -49,13 +56,141 @@
 # pragma warning(disable: 4702)
 #endif
 
+#if defined(BOOST_USE_FIBER_HOOKS) || defined(BOOST_USE_FIBER_ARENA) || defined(BOOST_USE_FIBER_EXCEPTIONS)
+// the running context is tracked per thread
+# define BOOST_CONTEXT_FIBER_IDENTITY
+#endif
+
 namespace boost {
 namespace context {
+
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+template< typename T >
+class fiber_task;
+BOOST_CONTEXT_FIBER_ABI_END
+
 namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+// state of an execution context that fcontext_t does not carry: one per
+// fiber in its control structure, one per thread for the main context
+struct fiber_identity {
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_info      info{};
+#endif
+#if defined(BOOST_USE_FIBER_ARENA)
+    // request-scoped allocations (fiber_arena.hpp), released together
+    // with the stack
+    void        *   arena{ nullptr };
+#endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // context that has switched to the fiber last
+    fcontext_t          resumer{ nullptr };
+    // handle of `resumer` destroyed while an exception unwound the stack
+    // of the fiber (see fiber_park())
+    fcontext_t          parked{ nullptr };
+    fiber_identity  *   parked_identity{ nullptr };
+#endif
+};
+
+// nullptr denotes the main context of the thread
+inline
+fiber_identity *& fiber_current() noexcept {
+    static thread_local fiber_identity * current{ nullptr };
+    return current;
+}
+
+inline
+fiber_identity * fiber_main() noexcept {
+    static thread_local fiber_identity main_identity{};
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // before the identity escapes the thread
+    if ( BOOST_UNLIKELY( 0 == main_identity.info.id) ) {
+        main_identity.info.id = fiber_new_id();
+    }
+#endif
+    return & main_identity;
+}
+
+// makes `to` the running context; returns the identity of the
+// suspended context, passed to `to` via transfer_t::data
+inline
+fiber_identity * fiber_switch_to( fiber_identity * to, fiber_switch kind) noexcept {
+    fiber_identity *& current = fiber_current();
+    fiber_identity * from = nullptr != current ? current : fiber_main();
+    current = to;
+#if defined(BOOST_USE_FIBER_HOOKS)
+    on_fiber_switch( & from->info, & to->info, kind);
+#else
+    ( void) kind;
+#endif
+    return from;
+}
+
+#if defined(BOOST_USE_FIBER_ARENA)
+// arena of the running context, nullptr for the main context
+inline
+void ** fiber_current_arena() noexcept {
+    fiber_identity * current = fiber_current();
+    return nullptr != current && fiber_main() != current ? & current->arena : nullptr;
+}
+#endif
+
+template< typename Fn >
+struct fiber_ontop_args {
+    Fn              *   fn;
+    fiber_identity  *   from;
+};
+#endif
+
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+// records the context that has switched to the running context
+inline
+void fiber_switched_from( fcontext_t from) noexcept {
+    fiber_identity * current = fiber_current();
+    if ( nullptr != current) {
+        current->resumer = from;
+    }
+}
+
+// a handle of the context that has switched to the running fiber last,
+// destroyed while an exception unwinds the stack of the fiber, does not
+// unwind that context: the fiber keeps it, the exception might escape the
+// context-function and is propagated to that context then
+inline
+bool fiber_park( fcontext_t fctx, fiber_identity * identity) noexcept {
+    fiber_identity * current = fiber_current();
+    if ( nullptr == current || fctx != current->resumer || nullptr != current->parked ||
+         fiber_main() == current || 0 == boost::core::uncaught_exceptions() ) {
+        return false;
+    }
+    current->parked = fctx;
+    current->parked_identity = identity;
+    return true;
+}
+
+// the handle kept by fiber_park(), empty if none
+inline
+transfer_t fiber_unpark( fiber_identity * identity) noexcept {
+    transfer_t t{ identity->parked, identity->parked_identity };
+    identity->parked = nullptr;
+    identity->parked_identity = nullptr;
+    return t;
+}
+#endif
 
 inline
 transfer_t fiber_unwind( transfer_t t) {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // the unwinding context holds no handle of this fiber
+    fiber_switched_from( t.fctx);
+#endif
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    throw forced_unwind( t.fctx, t.data);
+#else
     throw forced_unwind( t.fctx);
+#endif
     return { nullptr, nullptr };
 }
 
@@ -67,6 +202,43 @@ transfer_t fiber_exit( transfer_t t) noexcept {
     return { nullptr, nullptr };
 }
 
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+// holds the exception of a context terminated by an exception until it is
+// rethrown by resume()/resume_with() in the frame of the resumer; raw
+// storage, a thread-local std::exception_ptr would register a destructor
+inline
+void * fiber_pending_exception() noexcept {
+    static thread_local typename std::aligned_storage<
+        sizeof( std::exception_ptr), alignof( std::exception_ptr)
+    >::type storage;
+    return & storage;
+}
+
+template< typename Rec >
+transfer_t fiber_exit_rethrow( transfer_t t) noexcept {
+    Rec * rec = static_cast< Rec * >( t.data);
+    // moved out before the context stack is destroyed
+    void * storage = fiber_pending_exception();
+    ::new ( storage) std::exception_ptr( std::move( * rec->unhandled_exception() ) );
+    // destroy context stack
+    rec->deallocate();
+    return { nullptr, storage };
+}
+
+// invoked by resume()/resume_with() in the resumed context
+inline
+void fiber_resumed( transfer_t t) {
+    if ( BOOST_UNLIKELY( nullptr == t.fctx) && fiber_pending_exception() == t.data) {
+        // the context has terminated by an exception
+        std::exception_ptr * p = static_cast< std::exception_ptr * >( t.data);
+        std::exception_ptr except = std::move( * p);
+        p->~exception_ptr();
+        std::rethrow_exception( std::move( except) );
+    }
+    fiber_switched_from( t.fctx);
+}
+#endif
+
 template< typename Rec >
 void fiber_entry( transfer_t t) noexcept {
     // transfer control structure to the context-stack
@@ -75,45 +247,98 @@ void fiber_entry( transfer_t t) noexcept {
     BOOST_ASSERT( nullptr != rec);
     try {
         // jump back to `create_context()`
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        t = jump_fcontext( t.fctx, rec->identity() );
+#else
         t = jump_fcontext( t.fctx, nullptr);
+#endif
         // start executing
-        t.fctx = rec->run( t.fctx);
+        t = rec->run( t);
     } catch ( forced_unwind const& ex) {
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        t = { ex.fctx, ex.data };
+#else
         t = { ex.fctx, nullptr };
+#endif
 #ifndef BOOST_ASSERT_IS_VOID
         const_cast< forced_unwind & >( ex).caught = true;
 #endif
     }
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    catch ( ...) {
+        // escaped from a function executed by resume_with() before the
+        // context-function has been entered
+        t = rec->unhandled( std::current_exception() );
+    }
+#endif
     BOOST_ASSERT( nullptr != t.fctx);
+#if defined(BOOST_USE_FIBER_HOOKS)
+    on_fiber_terminate( rec->info() );
+#endif
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    fiber_switch_to( static_cast< fiber_identity * >( t.data), fiber_switch::exit);
+#endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    if ( BOOST_UNLIKELY( nullptr != rec->unhandled_exception() ) ) {
+        // destroy context-stack of `this`context on next context and
+        // propagate the exception
+        ontop_fcontext( t.fctx, rec, fiber_exit_rethrow< Rec >);
+    }
+#endif
     // destroy context-stack of `this`context on next context
     ontop_fcontext( t.fctx, rec, fiber_exit< Rec >);
     BOOST_ASSERT_MSG( false, "context already terminated");
 }
 
+BOOST_CONTEXT_FIBER_ABI_END
+
+// outside of the inline namespace: GCC does not find a friend function
+// through it; instantiated per fiber type
 template< typename Ctx, typename Fn >
 transfer_t fiber_ontop( transfer_t t) {
     BOOST_ASSERT( nullptr != t.data);
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    auto args = static_cast< fiber_ontop_args< Fn > * >( t.data);
+    auto p = * args->fn;
+    t.data = args->from;
+#else
     auto p = *static_cast< Fn * >( t.data);
     t.data = nullptr;
-    // execute function, pass fiber via reference
-    Ctx c = p( Ctx{ t.fctx } );
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-    return { exchange( c.fctx_, nullptr), nullptr };
-#else
-    return { std::exchange( c.fctx_, nullptr), nullptr };
 #endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // an exception thrown by `p` is thrown in the resumed context
+    fiber_switched_from( t.fctx);
+#endif
+    // execute function, pass fiber via reference
+    Ctx c = p( Ctx{ t } );
+    return c.release();
 }
 
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
 template< typename Ctx, typename StackAlloc, typename Fn >
 class fiber_record {
 private:
     stack_context                                       sctx_;
     typename std::decay< StackAlloc >::type             salloc_;
     typename std::decay< Fn >::type                     fn_;
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    fiber_identity                                      identity_{};
+#endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // escaped from the context-function
+    std::exception_ptr                                  except_{};
+#endif
 
     static void destroy( fiber_record * p) noexcept {
         typename std::decay< StackAlloc >::type salloc = std::move( p->salloc_);
         stack_context sctx = p->sctx_;
+#if defined(BOOST_USE_FIBER_ARENA)
+        // request-scoped allocations of the fiber
+        if ( nullptr != p->identity_.arena) {
+            fiber_arena_release( p->identity_.arena);
+        }
+#endif
         // deallocate fiber_record
         p->~fiber_record();
         // destroy stack with stack allocator
@@ -126,6 +351,11 @@ public:
         sctx_( sctx),
         salloc_( std::forward< StackAlloc >( salloc)),
         fn_( std::forward< Fn >( fn) ) {
+#if defined(BOOST_USE_FIBER_HOOKS)
+        identity_.info.sctx = sctx;
+        identity_.info.id = fiber_new_id();
+        identity_.info.allocator = detail::stack_allocator_name< typename std::decay< StackAlloc >::type >();
+#endif
     }
 
     fiber_record( fiber_record const&) = delete;
@@ -135,27 +365,204 @@ public:
         destroy( this);
     }
 
-    fcontext_t run( fcontext_t fctx) {
-        // invoke context-function
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    fiber_identity * identity() noexcept {
+        return & identity_;
+    }
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_info * info() noexcept {
+        return & identity_.info;
+    }
+#endif
+
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    std::exception_ptr * unhandled_exception() noexcept {
+        return except_ ? & except_ : nullptr;
+    }
+
+    // the context-function has not been entered
+    transfer_t unhandled( std::exception_ptr except) noexcept {
+        except_ = std::move( except);
+        Ctx c{ fiber_unpark( & identity_) };
+        if ( BOOST_UNLIKELY( ! c) ) {
+            // no resumer to propagate the exception to
+            std::terminate();
+        }
+        return c.release();
+    }
+
+    transfer_t run( transfer_t t) {
+        // the resumer, updated by the context-function
+        Ctx c{ t };
+        identity_.resumer = t.fctx;
+        try {
+            // invoke context-function
 #if defined(BOOST_NO_CXX17_STD_INVOKE)
-        Ctx c = boost::context::detail::invoke( fn_, Ctx{ fctx } );
+            c = boost::context::detail::invoke( fn_, std::move( c) );
 #else
-        Ctx c = std::invoke( fn_, Ctx{ fctx } );
+            c = std::invoke( fn_, std::move( c) );
 #endif
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-        return exchange( c.fctx_, nullptr);
+        } catch ( forced_unwind const&) {
+            {
+                // a parked handle is unwound, too
+                Ctx parked{ fiber_unpark( & identity_) };
+            }
+            throw;
+        } catch ( ...) {
+            // the stack is left before the exception is rethrown
+            except_ = std::current_exception();
+        }
+        // the handle kept by fiber_park() replaces a moved-away resumer,
+        // otherwise it is unwound
+        Ctx parked{ fiber_unpark( & identity_) };
+        if ( ! c) {
+            c = std::move( parked);
+        }
+        if ( BOOST_UNLIKELY( ! c && except_) ) {
+            // no resumer to propagate the exception to
+            std::terminate();
+        }
+        return c.release();
+    }
+#else
+    transfer_t run( transfer_t t) {
+        // invoke context-function
+#if defined(BOOST_NO_CXX17_STD_INVOKE)
+        Ctx c = boost::context::detail::invoke( fn_, Ctx{ t } );
 #else
-        return std::exchange( c.fctx_, nullptr);
+        Ctx c = std::invoke( fn_, Ctx{ t } );
+#endif
+        return c.release();
+    }
+#endif
+};
+
+// record of a fiber_task, the result slot lives on the stack of the task;
+// the stack is not released at termination but by the task, after the
+// result has been moved out
+template< typename Ctx, typename StackAlloc, typename Fn, typename T >
+class fiber_task_record : public fiber_task_slot< T > {
+private:
+    stack_context                                       sctx_;
+    typename std::decay< StackAlloc >::type             salloc_;
+    typename std::decay< Fn >::type                     fn_;
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    fiber_identity                                      identity_{};
+#endif
+
+    static void destroy( fiber_task_slot< T > * slot) noexcept {
+        fiber_task_record * p = static_cast< fiber_task_record * >( slot);
+        typename std::decay< StackAlloc >::type salloc = std::move( p->salloc_);
+        stack_context sctx = p->sctx_;
+#if defined(BOOST_USE_FIBER_ARENA)
+        // request-scoped allocations of the fiber
+        if ( nullptr != p->identity_.arena) {
+            fiber_arena_release( p->identity_.arena);
+        }
+#endif
+        // deallocate fiber_task_record
+        p->~fiber_task_record();
+        // destroy stack with stack allocator
+        salloc.deallocate( sctx);
+    }
+
+public:
+    fiber_task_record( stack_context sctx, StackAlloc && salloc,
+            fiber_task_args< T, Fn > && args) noexcept :
+        sctx_( sctx),
+        salloc_( std::forward< StackAlloc >( salloc)),
+        fn_( std::forward< Fn >( args.fn) ) {
+        this->release = & fiber_task_record::destroy;
+        * args.slot = this;
+#if defined(BOOST_USE_FIBER_HOOKS)
+        identity_.info.sctx = sctx;
+        identity_.info.id = fiber_new_id();
+        identity_.info.allocator = detail::stack_allocator_name< typename std::decay< StackAlloc >::type >();
+#endif
+    }
+
+    fiber_task_record( fiber_task_record const&) = delete;
+    fiber_task_record & operator=( fiber_task_record const&) = delete;
+
+    void deallocate() noexcept {
+        // released by the task
+    }
+
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    std::exception_ptr * unhandled_exception() noexcept {
+        // stored in the result slot
+        return nullptr;
+    }
+
+    // the task-function has not been entered
+    transfer_t unhandled( std::exception_ptr except) noexcept {
+        this->result.set_exception( std::move( except) );
+        Ctx c{ fiber_unpark( & identity_) };
+        if ( BOOST_UNLIKELY( ! c) ) {
+            // no resumer to return the result to
+            std::terminate();
+        }
+        return c.release();
+    }
+#endif
+
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    fiber_identity * identity() noexcept {
+        return & identity_;
+    }
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_info * info() noexcept {
+        return & identity_.info;
+    }
+#endif
+
+    transfer_t run( transfer_t t) {
+        Ctx c{ t };
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        identity_.resumer = t.fctx;
+#endif
+        try {
+            // invoke task-function, store the result on this stack
+            this->result.call( fn_, c);
+        } catch ( forced_unwind const&) {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+            {
+                // a parked handle is unwound, too
+                Ctx parked{ fiber_unpark( & identity_) };
+            }
+#endif
+            throw;
+        } catch ( ...) {
+            this->result.set_exception( std::current_exception() );
+        }
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        // the handle kept by fiber_park() replaces a moved-away resumer,
+        // otherwise it is unwound
+        Ctx parked{ fiber_unpark( & identity_) };
+        if ( ! c) {
+            c = std::move( parked);
+        }
 #endif
+        return c.release();
     }
 };
 
 template< typename Record, typename StackAlloc, typename Fn >
-fcontext_t create_fiber1( StackAlloc && salloc, Fn && fn) {
+transfer_t create_fiber1( StackAlloc && salloc, Fn && fn) {
     auto sctx = salloc.allocate();
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // per-context data of the hook tables, above the control structure
+    const std::size_t reserved = fiber_hooks_reserve();
+#else
+    const std::size_t reserved = 0;
+#endif
     // reserve space for control structure
 	void * storage = reinterpret_cast< void * >(
-			( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sizeof( Record) ) )
+			( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sizeof( Record) + reserved) )
             & ~static_cast< uintptr_t >( 0xff) );
     // placment new for control structure on context stack
     Record * record = new ( storage) Record{
@@ -170,15 +577,25 @@ fcontext_t create_fiber1( StackAlloc && salloc, Fn && fn) {
     const std::size_t size = reinterpret_cast< uintptr_t >( stack_top) - reinterpret_cast< uintptr_t >( stack_bottom);
     const fcontext_t fctx = make_fcontext( stack_top, size, & fiber_entry< Record >);
     BOOST_ASSERT( nullptr != fctx);
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_hooks_attach( record->info(), record + 1, reserved);
+    on_fiber_create( record->info() );
+#endif
     // transfer control structure to context-stack
-    return jump_fcontext( fctx, record).fctx;
+    return jump_fcontext( fctx, record);
 }
 
 template< typename Record, typename StackAlloc, typename Fn >
-fcontext_t create_fiber2( preallocated palloc, StackAlloc && salloc, Fn && fn) {
+transfer_t create_fiber2( preallocated palloc, StackAlloc && salloc, Fn && fn) {
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // per-context data of the hook tables, above the control structure
+    const std::size_t reserved = fiber_hooks_reserve();
+#else
+    const std::size_t reserved = 0;
+#endif
     // reserve space for control structure
     void * storage = reinterpret_cast< void * >(
-            ( reinterpret_cast< uintptr_t >( palloc.sp) - static_cast< uintptr_t >( sizeof( Record) ) )
+            ( reinterpret_cast< uintptr_t >( palloc.sp) - static_cast< uintptr_t >( sizeof( Record) + reserved) )
             & ~ static_cast< uintptr_t >( 0xff) );
     // placment new for control structure on context-stack
     Record * record = new ( storage) Record{
@@ -192,17 +609,30 @@ fcontext_t create_fiber2( preallocated palloc, StackAlloc && salloc, Fn && fn) {
     const std::size_t size = reinterpret_cast< uintptr_t >( stack_top) - reinterpret_cast< uintptr_t >( stack_bottom);
     const fcontext_t fctx = make_fcontext( stack_top, size, & fiber_entry< Record >);
     BOOST_ASSERT( nullptr != fctx);
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_hooks_attach( record->info(), record + 1, reserved);
+    on_fiber_create( record->info() );
+#endif
     // transfer control structure to context-stack
-    return jump_fcontext( fctx, record).fctx;
+    return jump_fcontext( fctx, record);
 }
 
+BOOST_CONTEXT_FIBER_ABI_END
 }
 
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
 class fiber {
 private:
     template< typename Ctx, typename StackAlloc, typename Fn >
     friend class detail::fiber_record;
 
+    template< typename Ctx, typename StackAlloc, typename Fn, typename T >
+    friend class detail::fiber_task_record;
+
+    template< typename T >
+    friend class context::fiber_task;
+
     template< typename Ctx, typename Fn >
     friend detail::transfer_t
     detail::fiber_ontop( detail::transfer_t);
@@ -215,10 +645,31 @@ private:
     friend fiber
     callcc( std::allocator_arg_t, preallocated, StackAlloc &&, Fn &&);
 
-    detail::fcontext_t  fctx_{ nullptr };
+    detail::fcontext_t          fctx_{ nullptr };
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+    detail::fiber_identity  *   identity_{ nullptr };
+#endif
 
-    fiber( detail::fcontext_t fctx) noexcept :
-        fctx_{ fctx } {
+    // transfer_t::data carries the identity of the suspended context
+    fiber( detail::transfer_t t) noexcept :
+        fctx_{ t.fctx }
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        , identity_{ static_cast< detail::fiber_identity * >( t.data) }
+#endif
+        {
+    }
+
+    detail::transfer_t release() noexcept {
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+        detail::fcontext_t fctx = detail::exchange( fctx_, nullptr);
+#else
+        detail::fcontext_t fctx = std::exchange( fctx_, nullptr);
+#endif
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        return { fctx, identity_ };
+#else
+        return { fctx, nullptr };
+#endif
     }
 
 public:
@@ -231,13 +682,13 @@ public:
 
     template< typename StackAlloc, typename Fn >
     fiber( std::allocator_arg_t, StackAlloc && salloc, Fn && fn) :
-        fctx_{ detail::create_fiber1< detail::fiber_record< fiber, StackAlloc, Fn > >(
+        fiber{ detail::create_fiber1< detail::fiber_record< fiber, StackAlloc, Fn > >(
                 std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) ) } {
     }
 
     template< typename StackAlloc, typename Fn >
     fiber( std::allocator_arg_t, preallocated palloc, StackAlloc && salloc, Fn && fn) :
-        fctx_{ detail::create_fiber2< detail::fiber_record< fiber, StackAlloc, Fn > >(
+        fiber{ detail::create_fiber2< detail::fiber_record< fiber, StackAlloc, Fn > >(
                 palloc, std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) ) } {
     }
 
@@ -251,14 +702,33 @@ public:
 
     ~fiber() {
         if ( BOOST_UNLIKELY( nullptr != fctx_) ) {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+            if ( BOOST_UNLIKELY( detail::fiber_park( fctx_, identity_) ) ) {
+                // kept by the running fiber
+                return;
+            }
+            detail::transfer_t t = detail::ontop_fcontext(
+#else
             detail::ontop_fcontext(
+#endif
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
                     detail::exchange( fctx_, nullptr),
 #else
                     std::exchange( fctx_, nullptr),
 #endif
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+                   detail::fiber_switch_to( identity_, fiber_switch::unwind),
+#else
                    nullptr,
+#endif
                    detail::fiber_unwind);
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+            if ( BOOST_UNLIKELY( nullptr == t.fctx) && detail::fiber_pending_exception() == t.data) {
+                // terminated by another exception while its stack was
+                // unwound, a destructor must not throw
+                std::terminate();
+            }
+#endif
         }
     }
 
@@ -279,28 +749,57 @@ public:
 
     fiber resume() && {
         BOOST_ASSERT( nullptr != fctx_);
-        return { detail::jump_fcontext(
+        detail::transfer_t t = detail::jump_fcontext(
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
                     detail::exchange( fctx_, nullptr),
 #else
                     std::exchange( fctx_, nullptr),
 #endif
-                    nullptr).fctx };
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+                    detail::fiber_switch_to( identity_, fiber_switch::resume) );
+#else
+                    nullptr);
+#endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        // rethrows the exception of a terminated context
+        detail::fiber_resumed( t);
+#endif
+        return { t };
     }
 
     template< typename Fn >
     fiber resume_with( Fn && fn) && {
         BOOST_ASSERT( nullptr != fctx_);
         auto p = std::forward< Fn >( fn);
-        return { detail::ontop_fcontext(
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        detail::fiber_ontop_args< decltype(p) > args{
+                & p, detail::fiber_switch_to( identity_, fiber_switch::resume_with) };
+#endif
+        detail::transfer_t t = detail::ontop_fcontext(
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
                     detail::exchange( fctx_, nullptr),
 #else
                     std::exchange( fctx_, nullptr),
 #endif
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+                    & args,
+#else
                     & p,
-                    detail::fiber_ontop< fiber, decltype(p) >).fctx };
+#endif
+                    detail::fiber_ontop< fiber, decltype(p) >);
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        // rethrows the exception of a terminated context
+        detail::fiber_resumed( t);
+#endif
+        return { t };
+    }
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // identity of the suspended context
+    fiber_info * info() const noexcept {
+        return nullptr != identity_ ? & identity_->info : nullptr;
     }
+#endif
 
     explicit operator bool() const noexcept {
         return nullptr != fctx_;
@@ -326,6 +825,9 @@ public:
 
     void swap( fiber & other) noexcept {
         std::swap( fctx_, other.fctx_);
+#if defined(BOOST_CONTEXT_FIBER_IDENTITY)
+        std::swap( identity_, other.identity_);
+#endif
     }
 };
 
@@ -336,6 +838,17 @@ void swap( fiber & l, fiber & r) noexcept {
 
 typedef fiber fiber_context;
 
+#if defined(BOOST_USE_FIBER_HOOKS)
+// identity of the running execution context
+inline
+fiber_info * current_fiber_info() noexcept {
+    detail::fiber_identity * current = detail::fiber_current();
+    return & ( nullptr != current ? current : detail::fiber_main() )->info;
+}
+#endif
+
+BOOST_CONTEXT_FIBER_ABI_END
+
 }}
 
 #if defined(BOOST_MSVC)
@@ -0,0 +1,99 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_HISTOGRAM_H
+#define BOOST_CONTEXT_FIBER_HISTOGRAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+// log-linear histogram of durations in ticks of the time-stamp counter:
+// values below 2^sub_bucket_bits have a bucket each, above each power of
+// two is split into 2^sub_bucket_bits buckets (relative error < 1/16)
+struct BOOST_CONTEXT_DECL fiber_histogram {
+    static constexpr std::size_t    sub_bucket_bits = 4;
+    static constexpr std::size_t    sub_bucket_count = std::size_t( 1) << sub_bucket_bits;
+    static constexpr std::size_t    bucket_count = ( 64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    std::uint64_t   counts[bucket_count]{};
+    // number and sum of the recorded values
+    std::uint64_t   count{ 0 };
+    std::uint64_t   sum{ 0 };
+    // ticks per second
+    double          frequency{ 0 };
+
+    static std::size_t bucket_of( std::uint64_t) noexcept;
+
+    // smallest value of a bucket
+    static std::uint64_t lower_bound( std::size_t) noexcept;
+
+    void merge( fiber_histogram const&) noexcept;
+
+    // value below which the fraction q (0..1) of the recorded values fall,
+    // the upper bound of its bucket
+    std::chrono::nanoseconds percentile( double q) const noexcept;
+
+    std::chrono::nanoseconds mean() const noexcept;
+};
+
+struct fiber_histograms {
+    // index of the thread, 0 if merged
+    std::size_t         thread{ 0 };
+    // time between suspension (or creation) and resumption of a fiber
+    fiber_histogram     scheduling_delay{};
+    // time a fiber runs until it is suspended or terminates
+    fiber_histogram     run_slice{};
+};
+
+// starts recording into per-thread histograms; the main contexts of the
+// threads are not recorded
+// returns false if no hook table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_histograms() noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_histograms() noexcept;
+
+BOOST_CONTEXT_DECL void reset_fiber_histograms() noexcept;
+
+// histograms of all threads merged
+BOOST_CONTEXT_DECL fiber_histograms fiber_histograms_snapshot();
+
+BOOST_CONTEXT_DECL std::vector< fiber_histograms > fiber_histograms_per_thread();
+
+// Prometheus text exposition format of the merged histograms
+// (boost_context_fiber_scheduling_delay_seconds and
+// boost_context_fiber_run_slice_seconds)
+BOOST_CONTEXT_DECL void write_fiber_histograms_prometheus( std::ostream &);
+
+BOOST_CONTEXT_DECL void write_fiber_histograms_prometheus( std::function< void( std::string const&) > const&);
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_HISTOGRAM_H
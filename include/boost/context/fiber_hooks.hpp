@@ -0,0 +1,190 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_HOOKS_H
+#define BOOST_CONTEXT_FIBER_HOOKS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/config.hpp>
+#include <boost/core/typeinfo.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/stack_context.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+
+// the way control passes from one execution context to another
+enum class fiber_switch {
+    // fiber::resume()
+    resume,
+    // fiber::resume_with()
+    resume_with,
+    // ~fiber() unwinds the stack of a suspended fiber
+    unwind,
+    // a terminated fiber passes control to its successor
+    exit
+};
+
+}}
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+// maximum number of hook tables installed at the same time
+# if ! defined(BOOST_CONTEXT_MAX_FIBER_HOOKS)
+#  define BOOST_CONTEXT_MAX_FIBER_HOOKS 8
+# endif
+
+// maximum bytes of per-context data of a hook table
+# if ! defined(BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA)
+#  define BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA 64
+# endif
+
+namespace boost {
+namespace context {
+
+// identity of an execution context: one per fiber, stored in the
+// control structure on the fiber's stack, and one per thread for
+// the main context (thread-entry context)
+struct fiber_info {
+    // empty for the main context of a thread
+    stack_context           sctx{};
+    // unique id, assigned when the control structure is constructed (the
+    // main context: by the first switch of the thread); never written
+    // afterwards
+    std::uint64_t           id{ 0 };
+    // optional name shown in traces; must outlive the context
+    char const          *   label{ nullptr };
+    // type of the stack allocator (mangled, see boost::core::demangle()),
+    // nullptr for the main context
+    char const          *   allocator{ nullptr };
+    // per-context data of the hook tables (see fiber_hooks_data())
+    void                *   data{ nullptr };
+};
+
+// hooks are invoked synchronously and must not throw;
+// each member might be nullptr
+struct fiber_hooks {
+    // fiber has been created but not yet entered;
+    // invoked on the stack of the creator
+    void (* on_create)( fiber_info *);
+    // control passes from `from` to `to`;
+    // invoked on the stack of `from`, `to` is already the
+    // running context (see current_fiber_info())
+    void (* on_switch)( fiber_info * from, fiber_info * to, fiber_switch);
+    // fiber has finished (returned or unwound);
+    // invoked on its own stack before the stack gets deallocated
+    void (* on_terminate)( fiber_info *);
+    // bytes of zero-initialized per-context data of the table, at most
+    // BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA (see fiber_hooks_data())
+    std::size_t data_size;
+    // index of the table + 1, assigned by add_fiber_hooks(); kept after
+    // remove_fiber_hooks(), leave zero-initialized
+    mutable std::atomic< std::size_t > slot;
+};
+
+// installs a hook table; the table must remain valid until
+// remove_fiber_hooks() returns and no switch is in flight
+// returns false if BOOST_CONTEXT_MAX_FIBER_HOOKS tables are already installed
+// or if data_size exceeds BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA
+BOOST_CONTEXT_DECL bool add_fiber_hooks( fiber_hooks const*) noexcept;
+
+BOOST_CONTEXT_DECL void remove_fiber_hooks( fiber_hooks const*) noexcept;
+
+// per-context data of a hook table (16 byte aligned); reserved on the stack
+// of fibers created while the table is installed and per thread for the main
+// context; remains valid after remove_fiber_hooks() until the table is
+// installed again
+// returns nullptr if the context has no data for the table
+BOOST_CONTEXT_DECL void * fiber_hooks_data( fiber_hooks const*, fiber_info const*) noexcept;
+
+namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+// number of installed hook tables, tested on each switch
+extern BOOST_CONTEXT_DECL std::atomic< std::size_t > fiber_hooks_installed;
+
+BOOST_CONTEXT_DECL void fiber_hooks_create( fiber_info *) noexcept;
+BOOST_CONTEXT_DECL void fiber_hooks_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+BOOST_CONTEXT_DECL void fiber_hooks_terminate( fiber_info *) noexcept;
+
+// bytes of per-context data of the installed hook tables
+BOOST_CONTEXT_DECL std::size_t fiber_hooks_data_size() noexcept;
+// lays out (and zero-fills) the per-context data of the installed tables
+// that fit into `size` bytes at `data` (16 byte aligned)
+BOOST_CONTEXT_DECL void fiber_hooks_data_init( fiber_info *, void * data, std::size_t size) noexcept;
+
+template< typename StackAlloc >
+char const* stack_allocator_name() noexcept {
+    return BOOST_CORE_TYPEID( StackAlloc).name();
+}
+
+extern BOOST_CONTEXT_DECL std::atomic< std::uint64_t > fiber_next_id;
+
+inline
+std::uint64_t fiber_new_id() noexcept {
+    return fiber_next_id.fetch_add( 1, std::memory_order_relaxed) + 1;
+}
+
+// bytes to reserve above the control structure of a fiber
+inline
+std::size_t fiber_hooks_reserve() noexcept {
+    if ( BOOST_LIKELY( 0 == fiber_hooks_installed.load( std::memory_order_relaxed) ) ) {
+        return 0;
+    }
+    // alignment of the data
+    return fiber_hooks_data_size() + 15;
+}
+
+// places the per-context data behind the control structure ending at `end`
+inline
+void fiber_hooks_attach( fiber_info * info, void * end, std::size_t reserved) noexcept {
+    if ( BOOST_UNLIKELY( 0 != reserved) ) {
+        std::uintptr_t data = ( reinterpret_cast< std::uintptr_t >( end) + 15) & ~ static_cast< std::uintptr_t >( 15);
+        fiber_hooks_data_init( info, reinterpret_cast< void * >( data), reserved - 15);
+    }
+}
+
+inline
+void on_fiber_create( fiber_info * info) noexcept {
+    if ( BOOST_UNLIKELY( 0 != fiber_hooks_installed.load( std::memory_order_relaxed) ) ) {
+        fiber_hooks_create( info);
+    }
+}
+
+inline
+void on_fiber_switch( fiber_info * from, fiber_info * to, fiber_switch kind) noexcept {
+    if ( BOOST_UNLIKELY( 0 != fiber_hooks_installed.load( std::memory_order_relaxed) ) ) {
+        fiber_hooks_switch( from, to, kind);
+    }
+}
+
+inline
+void on_fiber_terminate( fiber_info * info) noexcept {
+    if ( BOOST_UNLIKELY( 0 != fiber_hooks_installed.load( std::memory_order_relaxed) ) ) {
+        fiber_hooks_terminate( info);
+    }
+}
+
+BOOST_CONTEXT_FIBER_ABI_END
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_HOOKS_H
@@ -0,0 +1,76 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_MEMORY_H
+#define BOOST_CONTEXT_FIBER_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+#include <boost/context/fiber_registry.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+// stack of a registered fiber (fiber_registry.hpp)
+struct fiber_stack {
+    // see fiber_info::id
+    std::uint64_t       id{ 0 };
+    char const      *   label{ nullptr };
+    // mangled type name of the stack allocator
+    char const      *   allocator{ nullptr };
+    fiber_state         state{ fiber_state::created };
+    // [begin,end) as described by the stack_context
+    void            *   begin{ nullptr };
+    void            *   end{ nullptr };
+    // address space of the stack
+    std::size_t         reserved{ 0 };
+    // part of the reserved space that is readable and writable
+    // (guard pages excluded)
+    std::size_t         committed{ 0 };
+    // pages of the stack in physical memory
+    std::size_t         resident{ 0 };
+};
+
+// stacks of all registered fibers summed up per stack allocator
+struct fiber_memory {
+    // demangled type name of the stack allocator
+    std::string         allocator{};
+    std::size_t         fibers{ 0 };
+    std::size_t         reserved{ 0 };
+    std::size_t         committed{ 0 };
+    std::size_t         resident{ 0 };
+};
+
+BOOST_CONTEXT_DECL std::vector< fiber_stack > fiber_stacks();
+
+BOOST_CONTEXT_DECL std::vector< fiber_memory > fiber_memory_report();
+
+// table of fiber_memory_report() followed by the total
+BOOST_CONTEXT_DECL void write_fiber_memory_report( std::ostream &);
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_MEMORY_H
@@ -0,0 +1,73 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_PROFILER_H
+#define BOOST_CONTEXT_FIBER_PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+// maximum number of frames recorded per sample
+# if ! defined(BOOST_CONTEXT_PROFILER_MAX_FRAMES)
+#  define BOOST_CONTEXT_PROFILER_MAX_FRAMES 64
+# endif
+
+namespace boost {
+namespace context {
+
+// starts sampling the running threads each `interval` of consumed CPU time
+// (SIGPROF); samples are attributed to the running fiber and its stack is
+// walked along the frame pointers, bounded by the fiber's stack_context
+// keeps up to `capacity` samples, later samples are dropped
+// starts the fiber registry too (fiber_registry.hpp)
+// returns false if not supported (POSIX with ITIMER_PROF on x86 or AArch64),
+// if the profiler is already running or if the hook tables or the buffer
+// could not be installed
+BOOST_CONTEXT_DECL bool start_fiber_profiler(
+        std::chrono::microseconds interval = std::chrono::microseconds( 1000),
+        std::size_t capacity = 16384) noexcept;
+
+// waits for the signal handlers executing on other threads
+BOOST_CONTEXT_DECL void stop_fiber_profiler() noexcept;
+
+// discards all samples; the profiler must be stopped
+BOOST_CONTEXT_DECL void clear_fiber_profile() noexcept;
+
+// records one sample of each suspended, registered fiber: the stack
+// from where it was suspended; returns the number of samples
+BOOST_CONTEXT_DECL std::size_t sample_parked_fibers() noexcept;
+
+// number of samples dropped because the buffer was full
+BOOST_CONTEXT_DECL std::size_t fiber_profile_dropped() noexcept;
+
+// collapsed stacks (one line per distinct stack: frames from the outermost
+// to the innermost separated by ';' followed by the count), input of
+// flamegraph.pl and speedscope; the outermost frame names the fiber (its
+// label or "fiber <id>") or the thread, samples of suspended fibers are
+// rooted at "[parked]"
+BOOST_CONTEXT_DECL void write_fiber_profile_collapsed( std::ostream &);
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_PROFILER_H
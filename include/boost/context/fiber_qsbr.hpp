@@ -0,0 +1,91 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_QSBR_H
+#define BOOST_CONTEXT_FIBER_QSBR_H
+
+#include <cstddef>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+// objects retired by a thread before a grace period is requested
+# if ! defined(BOOST_CONTEXT_QSBR_BATCH)
+#  define BOOST_CONTEXT_QSBR_BATCH 64
+# endif
+
+// quiescent states of a thread between two reclamations of the expired
+// batches of all threads
+# if ! defined(BOOST_CONTEXT_QSBR_INTERVAL)
+#  define BOOST_CONTEXT_QSBR_INTERVAL 1024
+# endif
+
+namespace boost {
+namespace context {
+
+// must not throw and must not switch contexts
+typedef void (* fiber_deleter)( void *);
+
+// context switches that are quiescent states: references to objects
+// protected by fiber_retire() must not be held across such a switch
+enum class fiber_qsbr_mode {
+    // switches to the main context of a thread (back to the scheduler);
+    // a fiber might hold references while resuming other fibers
+    main_context,
+    // every switch
+    every_switch
+};
+
+// returns false if no hook table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_qsbr( fiber_qsbr_mode mode = fiber_qsbr_mode::main_context) noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_qsbr() noexcept;
+
+// `deleter( p)` is invoked once every online thread has passed a quiescent
+// state after `p` has been retired - on the calling thread or on a thread
+// passing a quiescent state (in a context switch); throws std::bad_alloc
+// (`p` is not retired then)
+// does not put the calling thread online, a thread is offline until its
+// first switch (or call of fiber_quiescent_state(), fiber_qsbr_online())
+BOOST_CONTEXT_DECL void fiber_retire( void * p, fiber_deleter deleter);
+
+template< typename T >
+void fiber_retire( T * p) {
+    fiber_retire( static_cast< void * >( p),
+                  []( void * vp) noexcept { delete static_cast< T * >( vp); });
+}
+
+// quiescent state outside of context switches (threads not running fibers)
+BOOST_CONTEXT_DECL void fiber_quiescent_state() noexcept;
+
+// an offline thread does not hold references and does not delay grace
+// periods (blocked in a system call, idle); each switch puts it online again
+BOOST_CONTEXT_DECL void fiber_qsbr_offline() noexcept;
+
+BOOST_CONTEXT_DECL void fiber_qsbr_online() noexcept;
+
+// quiescent state of the calling thread (if online) followed by invoking the
+// deleters of the retired objects (of all threads) whose grace period has
+// elapsed; returns their number
+BOOST_CONTEXT_DECL std::size_t fiber_qsbr_reclaim() noexcept;
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_QSBR_H
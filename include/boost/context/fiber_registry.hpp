@@ -0,0 +1,76 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_REGISTRY_H
+#define BOOST_CONTEXT_FIBER_REGISTRY_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+enum class fiber_state : unsigned char {
+    // not yet entered
+    created,
+    running,
+    suspended
+};
+
+// starts registering fibers created afterwards until they terminate;
+// registration and removal are lock-free
+// calls nest, the registry is stopped by the last stop_fiber_registry()
+// returns false if no hook table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_registry() noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_registry() noexcept;
+
+// number of registered fibers
+BOOST_CONTEXT_DECL std::size_t fiber_count() noexcept;
+
+// state of a registered fiber, fiber_state::created for contexts the
+// registry has not seen
+BOOST_CONTEXT_DECL fiber_state fiber_state_of( fiber_info const*) noexcept;
+
+namespace detail {
+
+BOOST_CONTEXT_DECL void visit_fibers( void (* visitor)( fiber_info &, void *), void * vp);
+
+}
+
+// invokes fn( fiber_info &) for each registered fiber; the fiber is not
+// deallocated while it is visited (its termination waits) - fn must not
+// terminate a visited fiber on the calling thread
+// fibers registered or removed concurrently might be skipped
+template< typename Fn >
+void for_each_fiber( Fn && fn) {
+    detail::visit_fibers(
+            []( fiber_info & info, void * vp) {
+                ( * static_cast< typename std::remove_reference< Fn >::type * >( vp) )( info);
+            },
+            & fn);
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_REGISTRY_H
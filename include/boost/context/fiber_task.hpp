@@ -0,0 +1,144 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_TASK_H
+#define BOOST_CONTEXT_FIBER_TASK_H
+
+#include <memory>
+#include <utility>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/detail/disable_overload.hpp>
+#include <boost/context/detail/fiber_result.hpp>
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/preallocated.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+// fiber producing a value of T (or an exception), stored in the record on the
+// stack of the fiber; `fn` is invoked as `T fn( fiber & caller)`, `caller`
+// has to be updated if the task switches back before it returns
+template< typename T >
+class fiber_task {
+private:
+    // inside the record of the task, valid until released; set while `f_`
+    // is initialized
+    detail::fiber_task_slot< T >        *   slot_{ nullptr };
+    fiber                                   f_{};
+
+    // unwinds the task if it has not completed, releases its stack
+    void release() noexcept {
+        if ( nullptr != slot_) {
+            f_ = fiber{};
+            slot_->release( slot_);
+            slot_ = nullptr;
+        }
+    }
+
+    struct releaser {
+        fiber_task                      *   task;
+
+        ~releaser() {
+            task->release();
+        }
+    };
+
+public:
+    fiber_task() noexcept = default;
+
+    template< typename Fn, typename = detail::disable_overload< fiber_task, Fn > >
+    fiber_task( Fn && fn) :
+        fiber_task{ std::allocator_arg, fixedsize_stack(), std::forward< Fn >( fn) } {
+    }
+
+    template< typename StackAlloc, typename Fn >
+    fiber_task( std::allocator_arg_t, StackAlloc && salloc, Fn && fn) :
+        f_{ detail::create_fiber1< detail::fiber_task_record< fiber, StackAlloc, Fn, T > >(
+                std::forward< StackAlloc >( salloc),
+                detail::fiber_task_args< T, Fn >{ std::forward< Fn >( fn), & slot_ }) } {
+    }
+
+    template< typename StackAlloc, typename Fn >
+    fiber_task( std::allocator_arg_t, preallocated palloc, StackAlloc && salloc, Fn && fn) :
+        f_{ detail::create_fiber2< detail::fiber_task_record< fiber, StackAlloc, Fn, T > >(
+                palloc, std::forward< StackAlloc >( salloc),
+                detail::fiber_task_args< T, Fn >{ std::forward< Fn >( fn), & slot_ }) } {
+    }
+
+    ~fiber_task() {
+        release();
+    }
+
+    fiber_task( fiber_task && other) noexcept {
+        swap( other);
+    }
+
+    fiber_task & operator=( fiber_task && other) noexcept {
+        if ( BOOST_LIKELY( this != & other) ) {
+            fiber_task tmp = std::move( other);
+            swap( tmp);
+        }
+        return * this;
+    }
+
+    fiber_task( fiber_task const& other) noexcept = delete;
+    fiber_task & operator=( fiber_task const& other) noexcept = delete;
+
+    // switches to the task until it switches back or completes
+    void resume() {
+        BOOST_ASSERT( ! done() );
+        f_ = std::move( f_).resume();
+    }
+
+    // switches to the task until it has completed; returns its result or
+    // rethrows its exception, the stack is released afterwards
+    T join() {
+        BOOST_ASSERT( joinable() );
+        while ( f_) {
+            f_ = std::move( f_).resume();
+        }
+        releaser r{ this };
+        return slot_->result.get();
+    }
+
+    // the task has completed, join() does not switch
+    bool done() const noexcept {
+        return nullptr != slot_ && ! f_;
+    }
+
+    bool joinable() const noexcept {
+        return nullptr != slot_;
+    }
+
+    void swap( fiber_task & other) noexcept {
+        std::swap( f_, other.f_);
+        std::swap( slot_, other.slot_);
+    }
+};
+
+template< typename T >
+void swap( fiber_task< T > & l, fiber_task< T > & r) noexcept {
+    l.swap( r);
+}
+
+BOOST_CONTEXT_FIBER_ABI_END
+}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_TASK_H
@@ -0,0 +1,54 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_TRACE_H
+#define BOOST_CONTEXT_FIBER_TRACE_H
+
+#include <cstddef>
+#include <ostream>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+
+// starts recording creation, context switches and termination of fibers
+// into per-thread ring buffers; each ring buffer keeps the last `capacity`
+// events (rounded up to a power of two), the capacity applies to ring
+// buffers allocated afterwards
+// returns false if no hook table could be installed
+BOOST_CONTEXT_DECL bool start_fiber_trace( std::size_t capacity = 65536) noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_trace() noexcept;
+
+// discards all recorded events; tracing must be stopped
+BOOST_CONTEXT_DECL void clear_fiber_trace() noexcept;
+
+// Chrome trace-event format (JSON), viewable with chrome://tracing
+// or ui.perfetto.dev; one track per thread, one slice per run of a fiber
+BOOST_CONTEXT_DECL void write_fiber_trace_json( std::ostream &);
+
+// Perfetto trace (protobuf), viewable with ui.perfetto.dev
+BOOST_CONTEXT_DECL void write_fiber_trace_perfetto( std::ostream &);
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_TRACE_H
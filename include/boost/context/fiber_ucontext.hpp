@@ -23,6 +23,7 @@ extern "C" {
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <functional>
 #include <memory>
 #include <ostream>
@@ -32,15 +33,21 @@ extern "C" {
 
 #include <boost/assert.hpp>
 #include <boost/config.hpp>
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+#include <boost/core/uncaught_exceptions.hpp>
+#endif
 
 #include <boost/context/detail/disable_overload.hpp>
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
 #include <boost/context/detail/exchange.hpp>
 #endif
 #include <boost/context/detail/externc.hpp>
+#include <boost/context/detail/fiber_arena.hpp>
+#include <boost/context/detail/fiber_result.hpp>
 #if defined(BOOST_NO_CXX17_STD_INVOKE)
 #include <boost/context/detail/invoke.hpp>
 #endif
+#include <boost/context/fiber_hooks.hpp>
 #include <boost/context/fixedsize_stack.hpp>
 #include <boost/context/flags.hpp>
 #include <boost/context/preallocated.hpp>
@@ -55,7 +62,18 @@ extern "C" {
 
 namespace boost {
 namespace context {
+
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+template< typename T >
+class fiber_task;
+BOOST_CONTEXT_FIBER_ABI_END
+
+// with BOOST_CONTEXT_UCONTEXT_NAMESPACE the ucontext_t backend lives in an
+// inline namespace of its own: its classes do not collide with those of
+// fcontext_t in a program containing both backends (see performance/backends)
 namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN
 
 // tampoline function
 // entered if the execution context
@@ -73,14 +91,33 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
     stack_context                                               sctx{};
     bool                                                        main_ctx{ true };
 	fiber_activation_record                                       *	from{ nullptr };
-    std::function< fiber_activation_record*(fiber_activation_record*&) >    ontop{};
+    fiber_activation_record * (* ontop)( fiber_activation_record *&, void *){ nullptr };
+    void                                                    *   ontop_arg{ nullptr };
     bool                                                        terminated{ false };
     bool                                                        force_unwind{ false };
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // escaped from the context-function of a terminated context, rethrown
+    // by the resumer
+    std::exception_ptr                                          except{};
+    // context that has switched to this context last
+    fiber_activation_record                                 *   resumer{ nullptr };
+    // handle of `resumer` destroyed while an exception unwound the stack
+    // (see park())
+    fiber_activation_record                                 *   parked{ nullptr };
+#endif
 #if defined(BOOST_USE_ASAN)
     void                                                    *   fake_stack{ nullptr };
     void                                                    *   stack_bottom{ nullptr };
     std::size_t                                                 stack_size{ 0 };
 #endif
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_info                                                  info{};
+#endif
+#if defined(BOOST_USE_FIBER_ARENA)
+    // request-scoped allocations (fiber_arena.hpp), released together
+    // with the stack
+    void                                                    *   arena{ nullptr };
+#endif
 
     static fiber_activation_record *& current() noexcept;
 
@@ -92,11 +129,18 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
                     std::error_code( errno, std::system_category() ),
                     "getcontext() failed");
         }
+#if defined(BOOST_USE_FIBER_HOOKS)
+        info.id = fiber_new_id();
+#endif
     }
 
     fiber_activation_record( stack_context sctx_) noexcept :
         sctx( sctx_ ),
         main_ctx( false ) {
+#if defined(BOOST_USE_FIBER_HOOKS)
+        info.sctx = sctx_;
+        info.id = fiber_new_id();
+#endif
     } 
 
     virtual ~fiber_activation_record() {
@@ -114,6 +158,12 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
         // store `this` in static, thread local pointer
         // `this` will become the active (running) context
         current() = this;
+#if defined(BOOST_USE_FIBER_HOOKS)
+        on_fiber_switch( & from->info, & info,
+                from->terminated
+                    ? fiber_switch::exit
+                    : ( force_unwind ? fiber_switch::unwind : fiber_switch::resume) );
+#endif
 #if defined(BOOST_USE_SEGMENTED_STACKS)
         // adjust segmented stack properties
         __splitstack_getcontext( from->sctx.segments_ctx);
@@ -133,6 +183,10 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
                                          (const void **) & current()->from->stack_bottom,
                                          & current()->from->stack_size);
 #endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        // a terminated context holds no handle
+        current()->resumer = current()->from->terminated ? nullptr : current()->from;
+#endif
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
         return exchange( current()->from, nullptr);
 #else
@@ -147,36 +201,16 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
         // `this` will become the active (running) context
         // returned by fiber::current()
         current() = this;
-#if defined(BOOST_NO_CXX14_GENERIC_LAMBDAS)
-        current()->ontop = std::bind(
-                [](typename std::decay< Fn >::type & fn, fiber_activation_record *& ptr){
-                    Ctx c{ ptr };
-                    c = fn( std::move( c) );
-                    if ( ! c) {
-                        ptr = nullptr;
-                    }
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-                    return exchange( c.ptr_, nullptr);
-#else
-                    return std::exchange( c.ptr_, nullptr);
-#endif
-                },
-                std::forward< Fn >( fn),
-                std::placeholders::_1);
-#else
-        current()->ontop = [fn=std::forward<Fn>(fn)](fiber_activation_record *& ptr){
-            Ctx c{ ptr };
-            c = fn( std::move( c) );
-            if ( ! c) {
-                ptr = nullptr;
-            }
-#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
-            return exchange( c.ptr_, nullptr);
-#else
-            return std::exchange( c.ptr_, nullptr);
-#endif
-        };
+#if defined(BOOST_USE_FIBER_HOOKS)
+        on_fiber_switch( & from->info, & info, fiber_switch::resume_with);
 #endif
+        // `p` lives on the stack of the resuming context, which stays
+        // suspended until `this`-context has executed the function (on
+        // return from resume() or, if not yet started, before the
+        // context-function is invoked)
+        typename std::decay< Fn >::type p = std::forward< Fn >( fn);
+        current()->ontop = & fiber_activation_record::invoke_ontop< Ctx, decltype(p) >;
+        current()->ontop_arg = & p;
 #if defined(BOOST_USE_SEGMENTED_STACKS)
         // adjust segmented stack properties
         __splitstack_getcontext( from->sctx.segments_ctx);
@@ -192,6 +226,10 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
                                          (const void **) & current()->from->stack_bottom,
                                          & current()->from->stack_size);
 #endif
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        // a terminated context holds no handle
+        current()->resumer = current()->from->terminated ? nullptr : current()->from;
+#endif
 #if defined(BOOST_NO_CXX14_STD_EXCHANGE)
         return exchange( current()->from, nullptr);
 #else
@@ -199,10 +237,59 @@ struct BOOST_CONTEXT_DECL fiber_activation_record {
 #endif
     }
 
+    template< typename Ctx, typename Fn >
+    static fiber_activation_record * invoke_ontop( fiber_activation_record *& ptr, void * arg) {
+        Ctx c{ ptr };
+        c = ( * static_cast< Fn * >( arg) )( std::move( c) );
+        if ( ! c) {
+            ptr = nullptr;
+        }
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+        return exchange( c.ptr_, nullptr);
+#else
+        return std::exchange( c.ptr_, nullptr);
+#endif
+    }
+
+    // executes the function passed by resume_with() on top of `this`-context
+    fiber_activation_record * invoke_pending_ontop( fiber_activation_record *& ptr) {
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+        auto fn = exchange( ontop, nullptr);
+#else
+        auto fn = std::exchange( ontop, nullptr);
+#endif
+        return fn( ptr, ontop_arg);
+    }
+
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // a handle of the context that has switched to the running fiber last,
+    // destroyed while an exception unwinds the stack of the fiber, does not
+    // unwind that context: the fiber keeps it, the exception might escape
+    // the context-function and is propagated to that context then
+    static bool park( fiber_activation_record * ptr) noexcept {
+        fiber_activation_record * self = current();
+        if ( ptr != self->resumer || nullptr != self->parked ||
+             self->main_ctx || 0 == boost::core::uncaught_exceptions() ) {
+            return false;
+        }
+        self->parked = ptr;
+        return true;
+    }
+#endif
+
     virtual void deallocate() noexcept {
     }
 };
 
+#if defined(BOOST_USE_FIBER_ARENA)
+// arena of the running context, nullptr for the main context
+inline
+void ** fiber_current_arena() noexcept {
+    fiber_activation_record * current = fiber_activation_record::current();
+    return current->is_main_context() ? nullptr : & current->arena;
+}
+#endif
+
 struct BOOST_CONTEXT_DECL fiber_activation_record_initializer {
     fiber_activation_record_initializer() noexcept;
     ~fiber_activation_record_initializer();
@@ -234,6 +321,12 @@ private:
     static void destroy( fiber_capture_record * p) noexcept {
         typename std::decay< StackAlloc >::type salloc = std::move( p->salloc_);
         stack_context sctx = p->sctx;
+#if defined(BOOST_USE_FIBER_ARENA)
+        // request-scoped allocations of the fiber
+        if ( nullptr != p->arena) {
+            fiber_arena_release( p->arena);
+        }
+#endif
         // deallocate activation record
         p->~fiber_capture_record();
         // destroy stack with stack allocator
@@ -245,6 +338,9 @@ public:
         fiber_activation_record{ sctx },
         salloc_{ std::forward< StackAlloc >( salloc) },
         fn_( std::forward< Fn >( fn) ) {
+#if defined(BOOST_USE_FIBER_HOOKS)
+        info.allocator = stack_allocator_name< typename std::decay< StackAlloc >::type >();
+#endif
     }
 
     void deallocate() noexcept override final {
@@ -259,7 +355,16 @@ public:
                                          & from->stack_size);
 #endif
         Ctx c{ from };
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        resumer = from;
+#endif
         try {
+            if ( BOOST_UNLIKELY( nullptr != ontop) ) {
+                // entered by resume_with(), the function owns the resumer
+                fiber_activation_record * ptr = c.ptr_;
+                c.ptr_ = nullptr;
+                c.ptr_ = invoke_pending_ontop( ptr);
+            }
             // invoke context-function
 #if defined(BOOST_NO_CXX17_STD_INVOKE)
             c = boost::context::detail::invoke( fn_, std::move( c) );
@@ -272,6 +377,31 @@ public:
             const_cast< forced_unwind & >( ex).caught = true;
 #endif
         }
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        catch ( ...) {
+            // the stack is left before the exception is rethrown
+            except = std::current_exception();
+        }
+        {
+            // the handle kept by park() replaces a moved-away resumer,
+            // otherwise it is unwound
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+            Ctx p{ exchange( parked, nullptr) };
+#else
+            Ctx p{ std::exchange( parked, nullptr) };
+#endif
+            if ( ! c) {
+                c = std::move( p);
+            }
+        }
+        if ( BOOST_UNLIKELY( ! c && nullptr != except) ) {
+            // no resumer to propagate the exception to
+            std::terminate();
+        }
+#endif
+#if defined(BOOST_USE_FIBER_HOOKS)
+        on_fiber_terminate( & info);
+#endif
         // this context has finished its task
 		from = nullptr;
         ontop = nullptr;
@@ -282,24 +412,124 @@ public:
     }
 };
 
-template< typename Ctx, typename StackAlloc, typename Fn >
-static fiber_activation_record * create_fiber1( StackAlloc && salloc, Fn && fn) {
-    typedef fiber_capture_record< Ctx, StackAlloc, Fn >  capture_t;
+// record of a fiber_task, the result slot lives on the stack of the task;
+// the stack is not released at termination but by the task, after the
+// result has been moved out
+template< typename Ctx, typename StackAlloc, typename Fn, typename T >
+class fiber_task_record : public fiber_activation_record, public fiber_task_slot< T > {
+private:
+    typename std::decay< StackAlloc >::type             salloc_;
+    typename std::decay< Fn >::type                     fn_;
+
+    static void destroy( fiber_task_slot< T > * slot) noexcept {
+        fiber_task_record * p = static_cast< fiber_task_record * >( slot);
+        typename std::decay< StackAlloc >::type salloc = std::move( p->salloc_);
+        stack_context sctx = p->sctx;
+#if defined(BOOST_USE_FIBER_ARENA)
+        // request-scoped allocations of the fiber
+        if ( nullptr != p->arena) {
+            fiber_arena_release( p->arena);
+        }
+#endif
+        // deallocate activation record
+        p->~fiber_task_record();
+        // destroy stack with stack allocator
+        salloc.deallocate( sctx);
+    }
 
+public:
+    fiber_task_record( stack_context sctx, StackAlloc && salloc, fiber_task_args< T, Fn > && args) noexcept :
+        fiber_activation_record{ sctx },
+        salloc_{ std::forward< StackAlloc >( salloc) },
+        fn_( std::forward< Fn >( args.fn) ) {
+        this->release = & fiber_task_record::destroy;
+        * args.slot = this;
+#if defined(BOOST_USE_FIBER_HOOKS)
+        info.allocator = stack_allocator_name< typename std::decay< StackAlloc >::type >();
+#endif
+    }
+
+    void deallocate() noexcept override final {
+        BOOST_ASSERT( terminated);
+        // released by the task
+    }
+
+    void run() {
+#if defined(BOOST_USE_ASAN)
+        __sanitizer_finish_switch_fiber( fake_stack,
+                                         (const void **) & from->stack_bottom,
+                                         & from->stack_size);
+#endif
+        Ctx c{ from };
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        resumer = from;
+#endif
+        try {
+            if ( BOOST_UNLIKELY( nullptr != ontop) ) {
+                // entered by resume_with(), the function owns the resumer
+                fiber_activation_record * ptr = c.ptr_;
+                c.ptr_ = nullptr;
+                c.ptr_ = invoke_pending_ontop( ptr);
+            }
+            // invoke task-function, store the result on this stack
+            this->result.call( fn_, c);
+        } catch ( forced_unwind const& ex) {
+            c = Ctx{ ex.from };
+#ifndef BOOST_ASSERT_IS_VOID
+            const_cast< forced_unwind & >( ex).caught = true;
+#endif
+        } catch ( ...) {
+            this->result.set_exception( std::current_exception() );
+        }
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        {
+            // the handle kept by park() replaces a moved-away resumer,
+            // otherwise it is unwound
+#if defined(BOOST_NO_CXX14_STD_EXCHANGE)
+            Ctx p{ exchange( parked, nullptr) };
+#else
+            Ctx p{ std::exchange( parked, nullptr) };
+#endif
+            if ( ! c) {
+                c = std::move( p);
+            }
+        }
+#endif
+#if defined(BOOST_USE_FIBER_HOOKS)
+        on_fiber_terminate( & info);
+#endif
+        // this context has finished its task
+		from = nullptr;
+        ontop = nullptr;
+        terminated = true;
+        force_unwind = false;
+        std::move( c).resume();
+        BOOST_ASSERT_MSG( false, "fiber already terminated");
+    }
+};
+
+template< typename Record, typename StackAlloc, typename Fn >
+static fiber_activation_record * create_fiber1( StackAlloc && salloc, Fn && fn) {
     auto sctx = salloc.allocate();
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // per-context data of the hook tables, above the control structure
+    const std::size_t reserved = fiber_hooks_reserve();
+#else
+    const std::size_t reserved = 0;
+#endif
     // reserve space for control structure
     void * storage = reinterpret_cast< void * >(
-            ( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sizeof( capture_t) ) )
+            ( reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sizeof( Record) + reserved) )
             & ~ static_cast< uintptr_t >( 0xff) );
     // placment new for control structure on context stack
-    capture_t * record = new ( storage) capture_t{
+    Record * record = new ( storage) Record{
             sctx, std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) };
     // stack bottom
     void * stack_bottom = reinterpret_cast< void * >(
             reinterpret_cast< uintptr_t >( sctx.sp) - static_cast< uintptr_t >( sctx.size) );
     // create user-context
     if ( BOOST_UNLIKELY( 0 != ::getcontext( & record->uctx) ) ) {
-        record->~capture_t();
+        record->~Record();
         salloc.deallocate( sctx);
         throw std::system_error(
                 std::error_code( errno, std::system_category() ),
@@ -310,31 +540,39 @@ static fiber_activation_record * create_fiber1( StackAlloc && salloc, Fn && fn)
     record->uctx.uc_stack.ss_size = reinterpret_cast< uintptr_t >( storage) -
             reinterpret_cast< uintptr_t >( stack_bottom) - static_cast< uintptr_t >( 64);
     record->uctx.uc_link = nullptr;
-    ::makecontext( & record->uctx, ( void (*)() ) & fiber_entry_func< capture_t >, 1, record);
+    ::makecontext( & record->uctx, ( void (*)() ) & fiber_entry_func< Record >, 1, record);
 #if defined(BOOST_USE_ASAN)
     record->stack_bottom = record->uctx.uc_stack.ss_sp;
     record->stack_size = record->uctx.uc_stack.ss_size;
+#endif
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_hooks_attach( & record->info, record + 1, reserved);
+    on_fiber_create( & record->info);
 #endif
     return record;
 }
 
-template< typename Ctx, typename StackAlloc, typename Fn >
+template< typename Record, typename StackAlloc, typename Fn >
 static fiber_activation_record * create_fiber2( preallocated palloc, StackAlloc && salloc, Fn && fn) {
-    typedef fiber_capture_record< Ctx, StackAlloc, Fn >  capture_t; 
-
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // per-context data of the hook tables, above the control structure
+    const std::size_t reserved = fiber_hooks_reserve();
+#else
+    const std::size_t reserved = 0;
+#endif
     // reserve space for control structure
     void * storage = reinterpret_cast< void * >(
-            ( reinterpret_cast< uintptr_t >( palloc.sp) - static_cast< uintptr_t >( sizeof( capture_t) ) )
+            ( reinterpret_cast< uintptr_t >( palloc.sp) - static_cast< uintptr_t >( sizeof( Record) + reserved) )
             & ~ static_cast< uintptr_t >( 0xff) );
     // placment new for control structure on context stack
-    capture_t * record = new ( storage) capture_t{
+    Record * record = new ( storage) Record{
             palloc.sctx, std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) };
     // stack bottom
     void * stack_bottom = reinterpret_cast< void * >(
             reinterpret_cast< uintptr_t >( palloc.sctx.sp) - static_cast< uintptr_t >( palloc.sctx.size) );
     // create user-context
     if ( BOOST_UNLIKELY( 0 != ::getcontext( & record->uctx) ) ) {
-        record->~capture_t();
+        record->~Record();
         salloc.deallocate( palloc.sctx);
         throw std::system_error(
                 std::error_code( errno, std::system_category() ),
@@ -345,16 +583,25 @@ static fiber_activation_record * create_fiber2( preallocated palloc, StackAlloc
     record->uctx.uc_stack.ss_size = reinterpret_cast< uintptr_t >( storage) -
             reinterpret_cast< uintptr_t >( stack_bottom) - static_cast< uintptr_t >( 64);
     record->uctx.uc_link = nullptr;
-    ::makecontext( & record->uctx,  ( void (*)() ) & fiber_entry_func< capture_t >, 1, record);
+    ::makecontext( & record->uctx,  ( void (*)() ) & fiber_entry_func< Record >, 1, record);
 #if defined(BOOST_USE_ASAN)
     record->stack_bottom = record->uctx.uc_stack.ss_sp;
     record->stack_size = record->uctx.uc_stack.ss_size;
+#endif
+#if defined(BOOST_USE_FIBER_HOOKS)
+    fiber_hooks_attach( & record->info, record + 1, reserved);
+    on_fiber_create( & record->info);
 #endif
     return record;
 }
 
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_END
+BOOST_CONTEXT_FIBER_ABI_END
 }
 
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN
+
 class BOOST_CONTEXT_DECL fiber {
 private:
     friend struct detail::fiber_activation_record;
@@ -362,10 +609,16 @@ private:
     template< typename Ctx, typename StackAlloc, typename Fn >
     friend class detail::fiber_capture_record;
 
-	template< typename Ctx, typename StackAlloc, typename Fn >
+    template< typename Ctx, typename StackAlloc, typename Fn, typename T >
+    friend class detail::fiber_task_record;
+
+    template< typename T >
+    friend class context::fiber_task;
+
+	template< typename Record, typename StackAlloc, typename Fn >
 	friend detail::fiber_activation_record * detail::create_fiber1( StackAlloc &&, Fn &&);
 
-	template< typename Ctx, typename StackAlloc, typename Fn >
+	template< typename Record, typename StackAlloc, typename Fn >
 	friend detail::fiber_activation_record * detail::create_fiber2( preallocated, StackAlloc &&, Fn &&);
 
     template< typename StackAlloc, typename Fn >
@@ -399,23 +652,36 @@ public:
 
     template< typename StackAlloc, typename Fn >
     fiber( std::allocator_arg_t, StackAlloc && salloc, Fn && fn) :
-        ptr_{ detail::create_fiber1< fiber >(
+        ptr_{ detail::create_fiber1< detail::fiber_capture_record< fiber, StackAlloc, Fn > >(
                 std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) ) } {
     }
 
     template< typename StackAlloc, typename Fn >
     fiber( std::allocator_arg_t, preallocated palloc, StackAlloc && salloc, Fn && fn) :
-        ptr_{ detail::create_fiber2< fiber >(
+        ptr_{ detail::create_fiber2< detail::fiber_capture_record< fiber, StackAlloc, Fn > >(
                 palloc, std::forward< StackAlloc >( salloc), std::forward< Fn >( fn) ) } {
     }
 
     ~fiber() {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        if ( BOOST_UNLIKELY( nullptr != ptr_) && detail::fiber_activation_record::park( ptr_) ) {
+            // kept by the running fiber
+            return;
+        }
+#endif
         if ( BOOST_UNLIKELY( nullptr != ptr_) && ! ptr_->main_ctx) {
             if ( BOOST_LIKELY( ! ptr_->terminated) ) {
                 ptr_->force_unwind = true;
                 ptr_->resume();
                 BOOST_ASSERT( ptr_->terminated);
             }
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+            if ( BOOST_UNLIKELY( nullptr != ptr_->except) ) {
+                // terminated by another exception while its stack was
+                // unwound, a destructor must not throw
+                std::terminate();
+            }
+#endif
             ptr_->deallocate();
         }
     }
@@ -444,9 +710,16 @@ public:
 #endif
         if ( BOOST_UNLIKELY( detail::fiber_activation_record::current()->force_unwind) ) {
             throw detail::forced_unwind{ ptr};
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        } else if ( BOOST_UNLIKELY( nullptr != ptr->except) ) {
+            // `ptr` has terminated by an exception, its stack is destroyed
+            // before the exception is rethrown
+            std::exception_ptr except = std::move( ptr->except);
+            ptr->deallocate();
+            std::rethrow_exception( std::move( except) );
+#endif
         } else if ( BOOST_UNLIKELY( nullptr != detail::fiber_activation_record::current()->ontop) ) {
-            ptr = detail::fiber_activation_record::current()->ontop( ptr);
-            detail::fiber_activation_record::current()->ontop = nullptr;
+            ptr = detail::fiber_activation_record::current()->invoke_pending_ontop( ptr);
         }
         return { ptr };
     }
@@ -463,13 +736,27 @@ public:
 #endif
         if ( BOOST_UNLIKELY( detail::fiber_activation_record::current()->force_unwind) ) {
             throw detail::forced_unwind{ ptr};
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        } else if ( BOOST_UNLIKELY( nullptr != ptr->except) ) {
+            // `ptr` has terminated by an exception, its stack is destroyed
+            // before the exception is rethrown
+            std::exception_ptr except = std::move( ptr->except);
+            ptr->deallocate();
+            std::rethrow_exception( std::move( except) );
+#endif
         } else if ( BOOST_UNLIKELY( nullptr != detail::fiber_activation_record::current()->ontop) ) {
-            ptr = detail::fiber_activation_record::current()->ontop( ptr);
-            detail::fiber_activation_record::current()->ontop = nullptr;
+            ptr = detail::fiber_activation_record::current()->invoke_pending_ontop( ptr);
         }
         return { ptr };
     }
 
+#if defined(BOOST_USE_FIBER_HOOKS)
+    // identity of the suspended context
+    fiber_info * info() const noexcept {
+        return nullptr != ptr_ ? & ptr_->info : nullptr;
+    }
+#endif
+
     explicit operator bool() const noexcept {
         return nullptr != ptr_ && ! ptr_->terminated;
     }
@@ -504,6 +791,17 @@ void swap( fiber & l, fiber & r) noexcept {
 
 typedef fiber fiber_context;
 
+#if defined(BOOST_USE_FIBER_HOOKS)
+// identity of the running execution context
+inline
+fiber_info * current_fiber_info() noexcept {
+    return & detail::fiber_activation_record::current()->info;
+}
+#endif
+
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_END
+BOOST_CONTEXT_FIBER_ABI_END
+
 }}
 
 #ifdef BOOST_HAS_ABI_HEADERS
@@ -0,0 +1,74 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_FIBER_WATCHDOG_H
+#define BOOST_CONTEXT_FIBER_WATCHDOG_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/fiber_hooks.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+// maximum number of frames captured for a report
+# if ! defined(BOOST_CONTEXT_WATCHDOG_MAX_FRAMES)
+#  define BOOST_CONTEXT_WATCHDOG_MAX_FRAMES 64
+# endif
+
+namespace boost {
+namespace context {
+
+struct fiber_watchdog_report {
+    // index of the thread (in order of the first switch)
+    std::size_t                 thread{ 0 };
+    // fiber running without switching
+    fiber_info              *   fiber{ nullptr };
+    std::uint64_t               id{ 0 };
+    char const              *   label{ nullptr };
+    // time since the last switch on the thread
+    std::chrono::nanoseconds    stalled{ 0 };
+    // program counter followed by the return addresses (frame pointers)
+    std::size_t                 depth{ 0 };
+    void                    *   frames[BOOST_CONTEXT_WATCHDOG_MAX_FRAMES];
+};
+
+// invoked by a signal handler on the stalled thread: must be async-signal-safe
+typedef void (* fiber_watchdog_callback)( fiber_watchdog_report const&);
+
+// starts a monitor thread that samples the switch epoch of each thread
+// (bumped on every switch); if a fiber runs longer than `threshold` without
+// switching, signal `signo` (0: SIGURG) is sent to its thread and `callback`
+// is invoked there - once per stall
+// returns false if not supported (POSIX threads only), if no hook table
+// could be installed or if the watchdog is already running
+BOOST_CONTEXT_DECL bool start_fiber_watchdog(
+        std::chrono::milliseconds threshold,
+        fiber_watchdog_callback callback,
+        int signo = 0) noexcept;
+
+BOOST_CONTEXT_DECL void stop_fiber_watchdog() noexcept;
+
+// writes the report as text to a file descriptor; async-signal-safe
+BOOST_CONTEXT_DECL void write_fiber_watchdog_report( int fd, fiber_watchdog_report const&) noexcept;
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_FIBER_WATCHDOG_H
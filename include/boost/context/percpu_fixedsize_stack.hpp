@@ -0,0 +1,291 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_CONTEXT_PERCPU_FIXEDSIZE_H
+#define BOOST_CONTEXT_PERCPU_FIXEDSIZE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+#include <boost/context/detail/config.hpp>
+#include <boost/context/detail/rseq.hpp>
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+
+#if defined(__linux__)
+extern "C" {
+#include <unistd.h>
+}
+#endif
+
+#if defined(BOOST_CONTEXT_USE_MAP_STACK)
+extern "C" {
+#include <sys/mman.h>
+}
+#endif
+
+#if defined(BOOST_USE_VALGRIND)
+#include <valgrind/valgrind.h>
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_PREFIX
+#endif
+
+namespace boost {
+namespace context {
+
+// caches up to `max_cached` deallocated stacks per CPU; copies share the
+// caches and may be used by any number of threads
+template< typename traitsT >
+class basic_percpu_fixedsize_stack {
+private:
+    class storage {
+    private:
+        // words of one CPU, aligned to cache lines
+        static constexpr std::size_t line_words = 64 / sizeof( std::uintptr_t);
+
+        typedef std::atomic< std::uintptr_t >   word_type;
+
+        std::atomic< std::size_t >                                  use_count_;
+        std::size_t                                                 stack_size_;
+        std::size_t                                                 capacity_;
+        std::size_t                                                 cpus_;
+        std::size_t                                                 stride_;
+        word_type                                               *   buffer_;
+        word_type                                               *   words_;
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+        bool                                                        rseq_;
+#endif
+
+        static std::size_t configured_cpus() noexcept {
+#if defined(__linux__)
+            long n = ::sysconf( _SC_NPROCESSORS_CONF);
+            return 0 < n ? static_cast< std::size_t >( n) : 1;
+#else
+            // a single cache shared by all CPUs
+            return 1;
+#endif
+        }
+
+        word_type * words_of( std::size_t cpu) const noexcept {
+            return words_ + cpu * stride_;
+        }
+
+        void * allocate_stack() {
+#if defined(BOOST_CONTEXT_USE_MAP_STACK)
+            void * vp = ::mmap( 0, stack_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_STACK, -1, 0);
+            if ( vp == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#else
+            void * vp = std::malloc( stack_size_);
+            if ( ! vp) {
+                throw std::bad_alloc();
+            }
+#endif
+            return vp;
+        }
+
+        void deallocate_stack( void * vp) noexcept {
+#if defined(BOOST_CONTEXT_USE_MAP_STACK)
+            ::munmap( vp, stack_size_);
+#else
+            std::free( vp);
+#endif
+        }
+
+        // returns nullptr if the cache of the current CPU is empty
+        void * pop() noexcept {
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+            if ( rseq_) {
+                struct rseq * rs = detail::rseq_area();
+                std::uintptr_t p = 0;
+                for (;;) {
+                    std::uint32_t cpu = detail::rseq_cpu( rs);
+                    if ( cpu >= cpus_) {
+                        return nullptr;
+                    }
+                    int result = detail::rseq_pop( rs, cpu,
+                            reinterpret_cast< std::uintptr_t * >( words_of( cpu) ), & p);
+                    if ( 0 == result) {
+                        return reinterpret_cast< void * >( p);
+                    }
+                    if ( 0 < result) {
+                        return nullptr;
+                    }
+                }
+            }
+#endif
+            std::size_t cpu = detail::current_cpu();
+            if ( cpu >= cpus_) {
+                return nullptr;
+            }
+            word_type * words = words_of( cpu);
+            for ( std::size_t i = 1; i <= capacity_; ++i) {
+                if ( 0 != words[i].load( std::memory_order_relaxed) ) {
+                    std::uintptr_t p = words[i].exchange( 0, std::memory_order_acquire);
+                    if ( 0 != p) {
+                        return reinterpret_cast< void * >( p);
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        // returns false if the cache of the current CPU is full
+        bool push( void * vp) noexcept {
+            std::uintptr_t p = reinterpret_cast< std::uintptr_t >( vp);
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+            if ( rseq_) {
+                struct rseq * rs = detail::rseq_area();
+                for (;;) {
+                    std::uint32_t cpu = detail::rseq_cpu( rs);
+                    if ( cpu >= cpus_) {
+                        return false;
+                    }
+                    int result = detail::rseq_push( rs, cpu,
+                            reinterpret_cast< std::uintptr_t * >( words_of( cpu) ), capacity_, p);
+                    if ( 0 <= result) {
+                        return 0 == result;
+                    }
+                }
+            }
+#endif
+            std::size_t cpu = detail::current_cpu();
+            if ( cpu >= cpus_) {
+                return false;
+            }
+            word_type * words = words_of( cpu);
+            for ( std::size_t i = 1; i <= capacity_; ++i) {
+                std::uintptr_t expected = 0;
+                if ( 0 == words[i].load( std::memory_order_relaxed) &&
+                     words[i].compare_exchange_strong( expected, p, std::memory_order_release, std::memory_order_relaxed) ) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    public:
+        storage( std::size_t stack_size, std::size_t max_cached) :
+                use_count_( 0),
+                stack_size_( stack_size),
+                capacity_( max_cached),
+                cpus_( configured_cpus() ),
+                stride_( ( max_cached + line_words) / line_words * line_words),
+                buffer_( new word_type[cpus_ * stride_ + line_words]),
+                words_( buffer_)
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+                , rseq_( nullptr != detail::rseq_area() )
+#endif
+                {
+            BOOST_ASSERT( traits_type::is_unbounded() || ( traits_type::maximum_size() >= stack_size_) );
+            std::uintptr_t offset = reinterpret_cast< std::uintptr_t >( buffer_) % 64;
+            if ( 0 != offset) {
+                words_ += ( 64 - offset) / sizeof( word_type);
+            }
+            for ( std::size_t i = 0; i < cpus_ * stride_; ++i) {
+                words_[i].store( 0, std::memory_order_relaxed);
+            }
+        }
+
+        ~storage() {
+            for ( std::size_t cpu = 0; cpu < cpus_; ++cpu) {
+                word_type * words = words_of( cpu);
+                std::size_t n = capacity_;
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+                if ( rseq_) {
+                    // slots behind the count have been popped
+                    n = words[0].load( std::memory_order_acquire);
+                }
+#endif
+                for ( std::size_t i = 1; i <= n; ++i) {
+                    std::uintptr_t p = words[i].load( std::memory_order_acquire);
+                    if ( 0 != p) {
+                        deallocate_stack( reinterpret_cast< void * >( p) );
+                    }
+                }
+            }
+            delete [] buffer_;
+        }
+
+        storage( storage const&) = delete;
+        storage & operator=( storage const&) = delete;
+
+        stack_context allocate() {
+            void * vp = pop();
+            if ( nullptr == vp) {
+                vp = allocate_stack();
+            }
+            stack_context sctx;
+            sctx.size = stack_size_;
+            sctx.sp = static_cast< char * >( vp) + sctx.size;
+#if defined(BOOST_USE_VALGRIND)
+            sctx.valgrind_stack_id = VALGRIND_STACK_REGISTER( sctx.sp, vp);
+#endif
+            return sctx;
+        }
+
+        void deallocate( stack_context & sctx) BOOST_NOEXCEPT_OR_NOTHROW {
+            BOOST_ASSERT( sctx.sp);
+            BOOST_ASSERT( traits_type::is_unbounded() || ( traits_type::maximum_size() >= sctx.size) );
+
+#if defined(BOOST_USE_VALGRIND)
+            VALGRIND_STACK_DEREGISTER( sctx.valgrind_stack_id);
+#endif
+            void * vp = static_cast< char * >( sctx.sp) - sctx.size;
+            if ( ! push( vp) ) {
+                deallocate_stack( vp);
+            }
+        }
+
+        friend void intrusive_ptr_add_ref( storage * s) noexcept {
+            ++s->use_count_;
+        }
+
+        friend void intrusive_ptr_release( storage * s) noexcept {
+            if ( 0 == --s->use_count_) {
+                delete s;
+            }
+        }
+    };
+
+    intrusive_ptr< storage >    storage_;
+
+public:
+    typedef traitsT traits_type;
+
+    basic_percpu_fixedsize_stack( std::size_t stack_size = traits_type::default_size(),
+                                  std::size_t max_cached = 16) :
+        storage_( new storage( stack_size, max_cached) ) {
+    }
+
+    stack_context allocate() {
+        return storage_->allocate();
+    }
+
+    void deallocate( stack_context & sctx) BOOST_NOEXCEPT_OR_NOTHROW {
+        storage_->deallocate( sctx);
+    }
+};
+
+typedef basic_percpu_fixedsize_stack< stack_traits >  percpu_fixedsize_stack;
+
+}}
+
+#ifdef BOOST_HAS_ABI_HEADERS
+#  include BOOST_ABI_SUFFIX
+#endif
+
+#endif // BOOST_CONTEXT_PERCPU_FIXEDSIZE_H
@@ -0,0 +1,320 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// the stack allocators in isolation: allocate/deallocate throughput,
+// first-touch cost, system calls, memory mappings and address reuse,
+// single-threaded and under multi-threaded churn
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/percpu_fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+#include <boost/context/segmented_stack.hpp>
+#endif
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../../test/allocations.hpp"
+#include "../benchmark.hpp"
+#include "../memory.hpp"
+#include "../syscalls.hpp"
+
+namespace ctx = boost::context;
+
+struct settings {
+    benchmark_options   options;
+    std::size_t         stack_size{ ctx::stack_traits::default_size() };
+    // bytes written below the top of each stack for the first-touch cost
+    std::size_t         touch{ ctx::stack_traits::page_size() };
+    // stacks held for the first-touch cost, the mappings and the reuse
+    std::size_t         batch{ 1024 };
+    std::size_t         threads{ (std::max)( std::thread::hardware_concurrency(), 1u) };
+    // the churn continues up to `threads` times this factor
+    std::size_t         oversubscribe{ 4 };
+};
+
+double nanoseconds( duration_type d) {
+    return static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() );
+}
+
+// writes one byte per page of the top `size` bytes of the stack
+void touch_stack( ctx::stack_context const& sctx, std::size_t size) {
+    std::size_t page = ctx::stack_traits::page_size();
+    volatile char * top = static_cast< char * >( sctx.sp);
+    for ( std::size_t offset = 1; offset <= size; offset += page) {
+        top[-static_cast< std::ptrdiff_t >( offset)] = 0;
+    }
+}
+
+struct single_result {
+    // per allocate/deallocate pair
+    double              pair_ns{ 0 };
+    double              syscalls{ 0 };
+    double              mallocs{ 0 };
+    // per stack of a batch
+    double              touch_ns{ 0 };
+    double              faults{ 0 };
+    double              mappings{ 0 };
+    // addresses of a batch handed out again after deallocating it
+    double              reuse{ 0 };
+};
+
+template< typename StackAlloc >
+single_result measure_single( StackAlloc salloc, settings const& s) {
+    single_result r;
+    boost::uint64_t n = (std::max)( s.options.jobs, boost::uint64_t( 1) );
+    std::size_t trials = (std::max)( s.options.trials, std::size_t( 1) );
+    // allocate/deallocate pairs
+    std::vector< double > values;
+    for ( std::size_t t = 0; t < s.options.warmup + trials; ++t) {
+        std::size_t calls = syscalls();
+        std::size_t allocs = allocations();
+        time_point_type start( clock_type::now() );
+        for ( boost::uint64_t i = 0; i < n; ++i) {
+            ctx::stack_context sctx = salloc.allocate();
+            salloc.deallocate( sctx);
+        }
+        duration_type d = clock_type::now() - start;
+        if ( t >= s.options.warmup) {
+            values.push_back( nanoseconds( d) / n);
+            r.syscalls = static_cast< double >( syscalls() - calls) / n;
+            r.mallocs = static_cast< double >( allocations() - allocs) / n;
+        }
+    }
+    r.pair_ns = summarize( "", values, n).median;
+    // first touch of a batch of fresh stacks
+    values.clear();
+    std::vector< double > faults, mappings, reuse;
+    std::vector< ctx::stack_context > stacks( s.batch);
+    for ( std::size_t t = 0; t < trials; ++t) {
+        process_memory before = memory_of_process();
+        for ( ctx::stack_context & sctx : stacks) {
+            sctx = salloc.allocate();
+        }
+        time_point_type start( clock_type::now() );
+        for ( ctx::stack_context & sctx : stacks) {
+            touch_stack( sctx, s.touch);
+        }
+        duration_type d = clock_type::now() - start;
+        process_memory after = memory_of_process();
+        values.push_back( nanoseconds( d) / s.batch);
+        faults.push_back( static_cast< double >( after.minor_faults - before.minor_faults) / s.batch);
+        mappings.push_back( ( static_cast< double >( after.mappings) - before.mappings) / s.batch);
+        std::set< void * > addresses;
+        for ( ctx::stack_context & sctx : stacks) {
+            addresses.insert( sctx.sp);
+            salloc.deallocate( sctx);
+        }
+        std::size_t reused = 0;
+        for ( ctx::stack_context & sctx : stacks) {
+            sctx = salloc.allocate();
+            reused += addresses.count( sctx.sp);
+        }
+        for ( ctx::stack_context & sctx : stacks) {
+            salloc.deallocate( sctx);
+        }
+        reuse.push_back( static_cast< double >( reused) / s.batch);
+    }
+    r.touch_ns = summarize( "", values, s.batch).median;
+    r.faults = summarize( "", faults, s.batch).median;
+    r.mappings = summarize( "", mappings, s.batch).median;
+    r.reuse = summarize( "", reuse, s.batch).median;
+    return r;
+}
+
+// each thread replaces random stacks of a working set, touching the new one;
+// returns the mean over the threads of the ns per replacement
+template< typename StackAlloc >
+double measure_churn( StackAlloc const* shared, std::size_t stack_size, std::size_t threads, boost::uint64_t n) {
+    constexpr std::size_t working_set = 16;
+    std::vector< double > ns( threads);
+    std::vector< std::thread > pool;
+    std::atomic< std::size_t > ready{ 0 };
+    std::atomic< bool > go{ false };
+    for ( std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back( [&ns,&ready,&go,shared,stack_size,n,t](){
+                    // own allocator unless shared: the pool behind
+                    // pooled_fixedsize_stack is not synchronized
+                    StackAlloc salloc = nullptr != shared ? * shared : StackAlloc{ stack_size };
+                    ctx::stack_context stacks[working_set];
+                    for ( ctx::stack_context & sctx : stacks) {
+                        sctx = salloc.allocate();
+                    }
+                    boost::uint32_t x = 2463534242u + static_cast< boost::uint32_t >( t);
+                    ++ready;
+                    while ( ! go.load( std::memory_order_acquire) ) {
+                        std::this_thread::yield();
+                    }
+                    time_point_type start( clock_type::now() );
+                    for ( boost::uint64_t i = 0; i < n; ++i) {
+                        // xorshift32
+                        x ^= x << 13;
+                        x ^= x >> 17;
+                        x ^= x << 5;
+                        ctx::stack_context & sctx = stacks[x % working_set];
+                        salloc.deallocate( sctx);
+                        sctx = salloc.allocate();
+                        touch_stack( sctx, 1);
+                    }
+                    ns[t] = nanoseconds( clock_type::now() - start) / n;
+                    for ( ctx::stack_context & sctx : stacks) {
+                        salloc.deallocate( sctx);
+                    }
+                });
+    }
+    while ( threads != ready.load() ) {
+        std::this_thread::yield();
+    }
+    go.store( true, std::memory_order_release);
+    for ( std::thread & t : pool) {
+        t.join();
+    }
+    double sum = 0;
+    for ( double v : ns) {
+        sum += v;
+    }
+    return sum / threads;
+}
+
+enum allocator_flags {
+    // copies of one allocator are used by all threads of the churn
+    shared_allocator = 1,
+    // the stacks are taken from malloc(); its system calls are made inside
+    // the C library, the wrappers of syscalls.hpp do not see them
+    malloc_backed = 2
+};
+
+#if defined(BOOST_CONTEXT_USE_MAP_STACK)
+constexpr int map_stack_backed = 0;
+#else
+constexpr int map_stack_backed = malloc_backed;
+#endif
+
+template< typename StackAlloc >
+void run_allocator( std::string const& name, settings const& s, int flags) {
+    if ( std::string::npos == name.find( s.options.filter) ) {
+        return;
+    }
+    bool shared = 0 != ( flags & shared_allocator);
+    single_result r = measure_single( StackAlloc{ s.stack_size }, s);
+    std::cout << std::fixed << std::setprecision( 2)
+              << std::left << std::setw( 26) << name << std::right
+              << std::setw( 11) << r.pair_ns << std::setw( 10);
+    if ( 0 != ( flags & malloc_backed) ) {
+        std::cout << "n/a";
+    } else {
+        std::cout << r.syscalls;
+    }
+    std::cout << std::setw( 9) << r.mallocs
+              << std::setw( 11) << r.touch_ns << std::setw( 9) << r.faults << std::setw( 8) << r.mappings
+              << std::setw( 7) << r.reuse * 100 << '%' << std::endl;
+    std::cout << std::left << std::setw( 26) << "  churn" << std::right;
+    std::vector< std::size_t > counts;
+    for ( std::size_t t = 1; t < s.threads; t *= 2) {
+        counts.push_back( t);
+    }
+    counts.push_back( s.threads);
+    // oversubscribed: more threads than CPUs
+    for ( std::size_t t = s.threads; t < s.threads * s.oversubscribe; ) {
+        t = (std::min)( 2 * t, s.threads * s.oversubscribe);
+        counts.push_back( t);
+    }
+    boost::uint64_t n = (std::max)( s.options.jobs / 10, boost::uint64_t( 1) );
+    double single = 0;
+    for ( std::size_t threads : counts) {
+        std::vector< double > values;
+        for ( std::size_t t = 0; t < (std::max)( s.options.trials, std::size_t( 1) ); ++t) {
+            StackAlloc salloc{ s.stack_size };
+            values.push_back( measure_churn< StackAlloc >( shared ? & salloc : nullptr, s.stack_size, threads, n) );
+        }
+        double ns = summarize( "", values, n).median;
+        if ( 1 == threads) {
+            single = ns;
+        }
+        std::cout << "  " << threads << "T " << ns << " ns";
+        if ( 1 < threads && 0 < single) {
+            std::cout << " (" << ns / single << "x)";
+        }
+    }
+    std::cout << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        s.options.trials = 11;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & s.options.jobs), "allocate/deallocate pairs per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & s.options.trials), "measured trials")
+            ("warmup,w", boost::program_options::value< std::size_t >( & s.options.warmup), "warm-up trials")
+            ("filter,f", boost::program_options::value< std::string >( & s.options.filter), "stack allocators containing this string")
+            ("stack-size", boost::program_options::value< std::size_t >( & s.stack_size), "stack size in bytes")
+            ("touch", boost::program_options::value< std::size_t >( & s.touch), "bytes touched per stack for the first-touch cost")
+            ("batch", boost::program_options::value< std::size_t >( & s.batch), "stacks held for first touch, mappings and reuse")
+            ("threads", boost::program_options::value< std::size_t >( & s.threads), "number of threads for the churn (CPUs)")
+            ("oversubscribe", boost::program_options::value< std::size_t >( & s.oversubscribe), "churn up to this multiple of --threads");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == s.batch || 0 == s.threads || 0 == s.oversubscribe || s.touch > s.stack_size) {
+            throw std::invalid_argument("--batch, --threads and --oversubscribe must be positive, --touch at most --stack-size");
+        }
+#if ! defined(BOOST_CONTEXT_COUNT_SYSCALLS)
+        std::cerr << "system calls are not counted on this platform" << std::endl;
+#endif
+
+        std::cout << s.stack_size << " bytes stack, " << s.touch << " bytes touched, batches of " << s.batch << std::endl;
+        std::cout << std::left << std::setw( 26) << "allocator" << std::right
+                  << std::setw( 11) << "pair ns" << std::setw( 10) << "syscalls" << std::setw( 9) << "mallocs"
+                  << std::setw( 11) << "touch ns" << std::setw( 9) << "faults" << std::setw( 8) << "VMAs"
+                  << std::setw( 8) << "reuse" << std::endl;
+        run_allocator< ctx::fixedsize_stack >( "fixedsize_stack", s, map_stack_backed);
+        run_allocator< ctx::protected_fixedsize_stack >( "protected_fixedsize_stack", s, 0);
+        // the pool takes its blocks from posix_memalign(), with MAP_STACK too
+        run_allocator< ctx::pooled_fixedsize_stack >( "pooled_fixedsize_stack", s, malloc_backed);
+        run_allocator< ctx::percpu_fixedsize_stack >( "percpu_fixedsize_stack", s, shared_allocator | map_stack_backed);
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+        // the segments are allocated by libgcc
+        run_allocator< ctx::segmented_stack >( "segmented_stack", s, malloc_backed);
+#endif
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
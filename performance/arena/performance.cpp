@@ -0,0 +1,198 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// concurrent request fibers building request-scoped header lists with
+// std::string/std::vector (malloc) against the per-fiber arena
+// (std::pmr, released with the stack)
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/context/fiber_arena.hpp>
+
+#if defined(BOOST_USE_FIBER_ARENA) && defined(BOOST_CONTEXT_HAS_MEMORY_RESOURCE)
+
+#include <algorithm>
+#include <iomanip>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../../test/allocations.hpp"
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+struct settings {
+    benchmark_options   options;
+    // requests in flight
+    std::size_t         fibers{ 1000 };
+    // headers per request, the fiber is suspended after each
+    std::size_t         headers{ 16 };
+    std::size_t         stack_size{ 16 * 1024 };
+};
+
+volatile std::size_t sink = 0;
+
+// header of 16..143 bytes
+std::size_t header_size( boost::uint32_t & x) noexcept {
+    // xorshift32
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return 16 + x % 128;
+}
+
+struct malloc_request {
+    static void run( ctx::fiber & f, settings const& s, boost::uint32_t seed) {
+        std::vector< std::string > headers;
+        for ( std::size_t i = 0; i < s.headers; ++i) {
+            headers.emplace_back( header_size( seed), 'h');
+            f = std::move( f).resume();
+        }
+        sink = headers.back().size();
+    }
+};
+
+struct arena_request {
+    static void run( ctx::fiber & f, settings const& s, boost::uint32_t seed) {
+        std::pmr::vector< std::pmr::string > headers{ ctx::fiber_memory_resource() };
+        for ( std::size_t i = 0; i < s.headers; ++i) {
+            headers.emplace_back( header_size( seed), 'h');
+            f = std::move( f).resume();
+        }
+        sink = headers.back().size();
+    }
+};
+
+struct result {
+    double              request_ns{ 0 };
+    double              mallocs{ 0 };
+};
+
+// `fibers` requests in flight, resumed round-robin; a finished request is
+// replaced by a new fiber until `n` requests have been served
+template< typename Request >
+result run( settings const& s, boost::uint64_t n) {
+    ctx::pooled_fixedsize_stack salloc{ s.stack_size };
+    std::vector< ctx::fiber > requests( s.fibers);
+    boost::uint64_t started = 0;
+    boost::uint64_t served = 0;
+    auto spawn = [&salloc,&s,&started](){
+        boost::uint32_t seed = 2463534242u + static_cast< boost::uint32_t >( started++);
+        return ctx::fiber{ std::allocator_arg, salloc,
+            [&s,seed]( ctx::fiber && f) {
+                Request::run( f, s, seed);
+                return std::move( f);
+            }};
+    };
+    // warm-up: stacks of the pool
+    for ( ctx::fiber & f : requests) {
+        f = spawn();
+    }
+    std::size_t allocs = allocations();
+    time_point_type start( clock_type::now() );
+    while ( served < n) {
+        for ( ctx::fiber & f : requests) {
+            f = std::move( f).resume();
+            if ( ! f) {
+                ++served;
+                f = spawn();
+            }
+        }
+    }
+    duration_type d = clock_type::now() - start;
+    result r;
+    r.request_ns = static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) / served;
+    r.mallocs = static_cast< double >( allocations() - allocs) / served;
+    return r;
+}
+
+template< typename Request >
+void measure( std::string const& name, settings const& s) {
+    if ( std::string::npos == name.find( s.options.filter) ) {
+        return;
+    }
+    boost::uint64_t n = (std::max)( s.options.jobs, boost::uint64_t( s.fibers) );
+    std::vector< double > ns, mallocs;
+    for ( std::size_t t = 0; t < s.options.warmup + (std::max)( s.options.trials, std::size_t( 1) ); ++t) {
+        result r = run< Request >( s, n);
+        if ( t >= s.options.warmup) {
+            ns.push_back( r.request_ns);
+            mallocs.push_back( r.mallocs);
+        }
+    }
+    std::sort( ns.begin(), ns.end() );
+    std::sort( mallocs.begin(), mallocs.end() );
+    std::cout << std::fixed << std::setprecision( 2)
+              << std::left << std::setw( 10) << name << std::right
+              << std::setw( 14) << median_of( ns) << std::setw( 12) << median_of( mallocs) << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        s.options.trials = 5;
+        s.options.warmup = 1;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & s.options.jobs), "requests per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & s.options.trials), "measured trials")
+            ("fibers", boost::program_options::value< std::size_t >( & s.fibers), "requests in flight")
+            ("headers", boost::program_options::value< std::size_t >( & s.headers), "headers per request")
+            ("stack-size", boost::program_options::value< std::size_t >( & s.stack_size), "stack size in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & s.options.filter), "variants containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == s.fibers || 0 == s.headers) {
+            throw std::invalid_argument("--fibers and --headers must be positive");
+        }
+
+        std::cout << s.fibers << " requests in flight, " << s.headers << " headers each" << std::endl;
+        std::cout << std::left << std::setw( 10) << "variant" << std::right
+                  << std::setw( 14) << "ns/request" << std::setw( 12) << "mallocs" << std::endl;
+        measure< malloc_request >( "malloc", s);
+        measure< arena_request >( "arena", s);
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
+
+#else
+
+int main() {
+    std::cerr << "requires the fiber arena (fiber-arena=on) and std::pmr (C++17)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
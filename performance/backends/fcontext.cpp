@@ -0,0 +1,25 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+
+#include "../benchmark.hpp"
+#include "../fiber_workloads.hpp"
+
+namespace ctx = boost::context;
+
+namespace {
+
+// context switches per iteration: 2
+register_benchmark resume_benchmark{ "fcontext/resume", fiber_resume< ctx::fiber >, 2 };
+register_benchmark resume_with_benchmark{ "fcontext/resume_with", fiber_resume_with< ctx::fiber >, 2 };
+register_benchmark create_benchmark{
+    "fcontext/create", fiber_create< ctx::fiber, ctx::fixedsize_stack >, 1, 10 };
+register_benchmark unwind_benchmark{
+    "fcontext/unwind", fiber_unwind< ctx::fiber, ctx::fixedsize_stack >, 1, 10 };
+
+}
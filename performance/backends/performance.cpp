@@ -0,0 +1,115 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// the same fiber workloads with each backend (fcontext.cpp, ucontext.cpp)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/config.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../benchmark.hpp"
+
+// one row per workload, one column per backend
+void write_comparison( std::ostream & os, std::vector< benchmark_summary > const& summaries) {
+    std::vector< std::string > backends;
+    std::vector< std::string > workloads;
+    std::map< std::string, std::map< std::string, benchmark_summary > > rows;
+    for ( benchmark_summary const& s : summaries) {
+        std::string::size_type i = s.name.find( '/');
+        std::string backend = s.name.substr( 0, i);
+        std::string workload = s.name.substr( i + 1);
+        if ( backends.end() == std::find( backends.begin(), backends.end(), backend) ) {
+            backends.push_back( backend);
+        }
+        if ( workloads.end() == std::find( workloads.begin(), workloads.end(), workload) ) {
+            workloads.push_back( workload);
+        }
+        rows[workload][backend] = s;
+    }
+    os << std::left << std::setw( 14) << "workload" << std::right;
+    for ( std::string const& b : backends) {
+        os << std::setw( 14) << b + " ns" << std::setw( 10) << "MAD";
+    }
+    for ( std::size_t i = 1; i < backends.size(); ++i) {
+        os << std::setw( 20) << backends[i] + "/" + backends[0];
+    }
+    os << '\n' << std::fixed << std::setprecision( 2);
+    for ( std::string const& w : workloads) {
+        std::map< std::string, benchmark_summary > & row = rows[w];
+        os << std::left << std::setw( 14) << w << std::right;
+        for ( std::string const& b : backends) {
+            os << std::setw( 14) << row[b].median << std::setw( 10) << row[b].mad;
+        }
+        for ( std::size_t i = 1; i < backends.size(); ++i) {
+            double base = row[backends[0]].median;
+            os << std::setw( 19) << ( 0 < base ? row[backends[i]].median / base : 0.0) << 'x';
+        }
+        os << '\n';
+    }
+    os.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        benchmark_options options;
+        std::string json;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & options.jobs), "iterations per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & options.trials), "measured trials")
+            ("warmup,w", boost::program_options::value< std::size_t >( & options.warmup), "warm-up trials")
+            ("filter,f", boost::program_options::value< std::string >( & options.filter), "run benchmarks containing this string")
+            ("json", boost::program_options::value< std::string >( & json), "write the results as JSON to this file");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::vector< benchmark_summary > summaries = run_benchmarks( options);
+        std::cout << options.trials << " trials of " << options.jobs << " iterations ("
+                  << options.warmup << " warm-up), median ns per operation" << std::endl;
+        write_comparison( std::cout, summaries);
+        if ( ! json.empty() ) {
+            std::map< std::string, std::string > context;
+            context["compiler"] = BOOST_COMPILER;
+            context["platform"] = BOOST_PLATFORM;
+            std::ofstream os{ json };
+            write_json( os, summaries, context);
+            if ( ! os) {
+                throw std::runtime_error("unable to write " + json);
+            }
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,352 @@
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <istream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+
+#include "clock.hpp"
+#include "counters.hpp"
+
+// runs `n` iterations and returns the time spent in the measured part
+// (setup and teardown excluded)
+typedef std::function< duration_type( boost::uint64_t) >   benchmark_fn;
+
+struct benchmark {
+    std::string         name;
+    benchmark_fn        fn;
+    // operations per iteration (e.g. 2 context switches per round trip),
+    // results are reported per operation
+    boost::uint64_t     ops;
+    // iterations per trial = jobs / divisor (for expensive operations)
+    boost::uint64_t     divisor;
+};
+
+inline
+std::vector< benchmark > & benchmarks() {
+    static std::vector< benchmark > registry;
+    return registry;
+}
+
+// registers a benchmark at static initialization
+struct register_benchmark {
+    register_benchmark( std::string name, benchmark_fn fn,
+                        boost::uint64_t ops = 1, boost::uint64_t divisor = 1) {
+        benchmarks().push_back( benchmark{ std::move( name), std::move( fn), ops, divisor });
+    }
+};
+
+struct benchmark_options {
+    // iterations per trial
+    boost::uint64_t     jobs{ 100000 };
+    std::size_t         warmup{ 3 };
+    std::size_t         trials{ 31 };
+    // run benchmarks whose name contains `filter`
+    std::string         filter{};
+    // count hardware events per trial (the whole call of the benchmark
+    // function, including its setup)
+    bool                counters{ false };
+};
+
+// JSON keys of the hardware events
+inline
+char const* perf_event_key( std::size_t i) {
+    static char const* keys[perf_event_count] = {
+        "cycles", "instructions", "branch_misses", "l1d_misses", "cache_misses", "dtlb_misses" };
+    return keys[i];
+}
+
+// statistics of the trials in nano seconds per operation
+struct benchmark_summary {
+    std::string         name{};
+    std::size_t         trials{ 0 };
+    boost::uint64_t     iterations{ 0 };
+    double              median{ 0 };
+    double              p99{ 0 };
+    // median absolute deviation from the median
+    double              mad{ 0 };
+    double              min{ 0 };
+    double              mean{ 0 };
+    // median of the hardware events per operation, if counted
+    bool                has_events{ false };
+    double              events[perf_event_count]{};
+};
+
+// median of sorted values
+inline
+double median_of( std::vector< double > const& sorted) {
+    BOOST_ASSERT( ! sorted.empty() );
+    std::size_t n = sorted.size();
+    return 0 == n % 2 ? ( sorted[n / 2 - 1] + sorted[n / 2]) / 2 : sorted[n / 2];
+}
+
+// nearest-rank percentile of sorted values, q in (0,1]
+inline
+double percentile_of( std::vector< double > const& sorted, double q) {
+    BOOST_ASSERT( ! sorted.empty() );
+    std::size_t rank = static_cast< std::size_t >( std::ceil( q * sorted.size() ) );
+    return sorted[(std::min)( 0 < rank ? rank - 1 : 0, sorted.size() - 1)];
+}
+
+inline
+benchmark_summary summarize( std::string const& name, std::vector< double > values, boost::uint64_t iterations) {
+    BOOST_ASSERT( ! values.empty() );
+    benchmark_summary s;
+    s.name = name;
+    s.trials = values.size();
+    s.iterations = iterations;
+    std::sort( values.begin(), values.end() );
+    s.median = median_of( values);
+    s.p99 = percentile_of( values, 0.99);
+    s.min = values.front();
+    s.mean = std::accumulate( values.begin(), values.end(), 0.0) / values.size();
+    std::vector< double > deviations;
+    deviations.reserve( values.size() );
+    for ( double v : values) {
+        deviations.push_back( std::fabs( v - s.median) );
+    }
+    std::sort( deviations.begin(), deviations.end() );
+    s.mad = median_of( deviations);
+    return s;
+}
+
+// warm-up trials followed by the measured trials, for each benchmark
+inline
+std::vector< benchmark_summary > run_benchmarks( benchmark_options const& options) {
+    std::vector< benchmark_summary > summaries;
+    std::unique_ptr< perf_counters > counters;
+    if ( options.counters) {
+        counters.reset( new perf_counters{} );
+        if ( ! counters->valid() ) {
+            counters.reset();
+        }
+    }
+    for ( benchmark const& b : benchmarks() ) {
+        if ( std::string::npos == b.name.find( options.filter) ) {
+            continue;
+        }
+        boost::uint64_t n = (std::max)( options.jobs / b.divisor, boost::uint64_t( 1) );
+        for ( std::size_t i = 0; i < options.warmup; ++i) {
+            b.fn( n);
+        }
+        double ops = static_cast< double >( n * b.ops);
+        std::vector< double > values;
+        std::vector< double > events[perf_event_count];
+        values.reserve( options.trials);
+        for ( std::size_t i = 0; i < (std::max)( options.trials, std::size_t( 1) ); ++i) {
+            perf_sample before{};
+            if ( counters) {
+                before = counters->read();
+            }
+            duration_type d = b.fn( n);
+            if ( counters) {
+                perf_sample after = counters->read();
+                for ( std::size_t j = 0; j < perf_event_count; ++j) {
+                    events[j].push_back( static_cast< double >( after.values[j] - before.values[j]) / ops);
+                }
+            }
+            values.push_back(
+                    static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) / ops);
+        }
+        summaries.push_back( summarize( b.name, std::move( values), n) );
+        if ( counters) {
+            benchmark_summary & s = summaries.back();
+            s.has_events = true;
+            for ( std::size_t j = 0; j < perf_event_count; ++j) {
+                std::sort( events[j].begin(), events[j].end() );
+                s.events[j] = median_of( events[j]);
+            }
+        }
+    }
+    return summaries;
+}
+
+inline
+void write_table( std::ostream & os, std::vector< benchmark_summary > const& summaries) {
+    std::size_t width = 9;
+    for ( benchmark_summary const& s : summaries) {
+        width = (std::max)( width, s.name.size() );
+    }
+    os << std::left << std::setw( width) << "benchmark" << std::right
+       << std::setw( 12) << "median ns" << std::setw( 12) << "p99 ns"
+       << std::setw( 12) << "MAD ns" << std::setw( 12) << "min ns" << '\n';
+    os << std::fixed << std::setprecision( 2);
+    for ( benchmark_summary const& s : summaries) {
+        os << std::left << std::setw( width) << s.name << std::right
+           << std::setw( 12) << s.median << std::setw( 12) << s.p99
+           << std::setw( 12) << s.mad << std::setw( 12) << s.min << '\n';
+    }
+    if ( summaries.end() != std::find_if( summaries.begin(), summaries.end(),
+                                          []( benchmark_summary const& s) { return s.has_events; }) ) {
+        // medians per operation
+        os << '\n' << std::left << std::setw( width) << "benchmark" << std::right;
+        for ( std::size_t j = 0; j < perf_event_count; ++j) {
+            os << std::setw( 15) << perf_event_name( j);
+        }
+        os << std::setw( 8) << "IPC" << '\n';
+        for ( benchmark_summary const& s : summaries) {
+            if ( ! s.has_events) {
+                continue;
+            }
+            os << std::left << std::setw( width) << s.name << std::right;
+            for ( std::size_t j = 0; j < perf_event_count; ++j) {
+                os << std::setw( 15) << s.events[j];
+            }
+            os << std::setw( 8)
+               << ( 0 < s.events[perf_cycles] ? s.events[perf_instructions] / s.events[perf_cycles] : 0.0) << '\n';
+        }
+    }
+    os.unsetf( std::ios_base::floatfield);
+}
+
+inline
+std::string json_escape( std::string const& str) {
+    std::string escaped;
+    for ( char c : str) {
+        if ( '"' == c || '\\' == c) {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// one benchmark per line, read back by read_baseline()
+inline
+void write_json( std::ostream & os, std::vector< benchmark_summary > const& summaries,
+                 std::map< std::string, std::string > const& context) {
+    os << "{\n  \"context\": {";
+    char const* separator = "";
+    for ( auto const& c : context) {
+        os << separator << "\"" << json_escape( c.first) << "\": \"" << json_escape( c.second) << "\"";
+        separator = ", ";
+    }
+    os << "},\n  \"unit\": \"ns\",\n  \"benchmarks\": [\n";
+    os << std::setprecision( 6);
+    for ( std::size_t i = 0; i < summaries.size(); ++i) {
+        benchmark_summary const& s = summaries[i];
+        os << "    {\"name\": \"" << json_escape( s.name) << "\""
+           << ", \"trials\": " << s.trials
+           << ", \"iterations\": " << s.iterations
+           << ", \"median\": " << s.median
+           << ", \"p99\": " << s.p99
+           << ", \"mad\": " << s.mad
+           << ", \"min\": " << s.min
+           << ", \"mean\": " << s.mean;
+        if ( s.has_events) {
+            for ( std::size_t j = 0; j < perf_event_count; ++j) {
+                os << ", \"" << perf_event_key( j) << "\": " << s.events[j];
+            }
+        }
+        os << "}"
+           << ( i + 1 < summaries.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+// reads the benchmarks of a file written by write_json()
+inline
+std::map< std::string, benchmark_summary > read_baseline( std::istream & is) {
+    std::map< std::string, benchmark_summary > baseline;
+    auto number = []( std::string const& line, char const* key) {
+        std::string::size_type i = line.find( std::string{ "\"" } + key + "\": ");
+        return std::string::npos != i
+            ? std::strtod( line.c_str() + i + std::char_traits< char >::length( key) + 4, nullptr)
+            : 0.0;
+    };
+    std::string line;
+    while ( std::getline( is, line) ) {
+        std::string::size_type begin = line.find( "{\"name\": \"");
+        if ( std::string::npos == begin) {
+            continue;
+        }
+        begin += 10;
+        std::string::size_type end = line.find( '"', begin);
+        if ( std::string::npos == end) {
+            continue;
+        }
+        benchmark_summary s;
+        s.name = line.substr( begin, end - begin);
+        s.median = number( line, "median");
+        s.p99 = number( line, "p99");
+        s.mad = number( line, "mad");
+        s.min = number( line, "min");
+        s.mean = number( line, "mean");
+        for ( std::size_t j = 0; j < perf_event_count; ++j) {
+            if ( std::string::npos != line.find( std::string{ "\"" } + perf_event_key( j) + "\": ") ) {
+                s.has_events = true;
+                s.events[j] = number( line, perf_event_key( j) );
+            }
+        }
+        baseline[s.name] = s;
+    }
+    return baseline;
+}
+
+// a benchmark regressed if its median is slower by more than `threshold`
+// (relative) and by more than three times the combined MADs (noise), or if
+// both runs counted instructions and it executes more than `threshold`
+// additional instructions per operation (independent of clock noise)
+// returns the number of regressions
+inline
+std::size_t compare_baseline( std::ostream & os, std::vector< benchmark_summary > const& summaries,
+                              std::map< std::string, benchmark_summary > const& baseline, double threshold) {
+    std::size_t regressions = 0;
+    std::size_t width = 9;
+    for ( benchmark_summary const& s : summaries) {
+        width = (std::max)( width, s.name.size() );
+    }
+    os << std::left << std::setw( width) << "benchmark" << std::right
+       << std::setw( 12) << "baseline ns" << std::setw( 12) << "median ns"
+       << std::setw( 10) << "change" << std::setw( 14) << "instructions" << '\n';
+    os << std::fixed << std::setprecision( 2);
+    for ( benchmark_summary const& s : summaries) {
+        auto i = baseline.find( s.name);
+        if ( baseline.end() == i) {
+            os << std::left << std::setw( width) << s.name << std::right
+               << std::setw( 12) << "-" << std::setw( 12) << s.median << std::setw( 10) << "new" << '\n';
+            continue;
+        }
+        benchmark_summary const& b = i->second;
+        double change = 0 < b.median ? ( s.median - b.median) / b.median : 0.0;
+        bool regressed = change > threshold && s.median - b.median > 3 * ( s.mad + b.mad);
+        os << std::left << std::setw( width) << s.name << std::right
+           << std::setw( 12) << b.median << std::setw( 12) << s.median
+           << std::setw( 9) << change * 100 << '%';
+        if ( s.has_events && b.has_events && 0 < b.events[perf_instructions]) {
+            double instructions = ( s.events[perf_instructions] - b.events[perf_instructions]) / b.events[perf_instructions];
+            regressed = regressed || instructions > threshold;
+            os << std::setw( 13) << instructions * 100 << '%';
+        } else {
+            os << std::setw( 14) << "-";
+        }
+        os << ( regressed ? "  REGRESSION" : "") << '\n';
+        if ( regressed) {
+            ++regressions;
+        }
+    }
+    os.unsetf( std::ios_base::floatfield);
+    return regressions;
+}
+
+#endif // BENCHMARK_H
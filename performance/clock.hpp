@@ -39,7 +39,7 @@ duration_type overhead_clock()
             overhead.begin(), overhead.end(),
             clock_overhead() );
     BOOST_ASSERT( overhead.begin() != overhead.end() );
-    return duration_type( std::accumulate( overhead.begin(), overhead.end(), 0) / iterations);
+    return duration_type( std::accumulate( overhead.begin(), overhead.end(), boost::uint64_t( 0) ) / iterations);
 }
 
 #endif // CLOCK_H
@@ -0,0 +1,556 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// generator, ping-pong and pipeline workloads implemented with fibers,
+// C++20 stackless coroutines and OS threads handing off with a futex
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <climits>
+#include <coroutine>
+#include <exception>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/stack_traits.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#if defined(__linux__)
+extern "C" {
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+}
+#endif
+
+#include "../benchmark.hpp"
+#include "../memory.hpp"
+
+namespace ctx = boost::context;
+
+// keeps results alive
+volatile boost::uint64_t sink = 0;
+
+// fibers
+
+ctx::fiber fiber_loop( ctx::fiber && f) {
+    while ( true) {
+        f = std::move( f).resume();
+    }
+    return ctx::fiber{};
+}
+
+duration_type fiber_ping_pong( boost::uint64_t n) {
+    ctx::fiber f{ fiber_loop };
+    f = std::move( f).resume();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+// yields 0, 1, 2, ... through `value`
+struct fiber_generator {
+    boost::uint64_t     value{ 0 };
+    ctx::fiber          f;
+
+    fiber_generator() :
+        f{ [this]( ctx::fiber && caller) {
+                for ( boost::uint64_t i = 0;; ++i) {
+                    value = i;
+                    caller = std::move( caller).resume();
+                }
+                return std::move( caller);
+            }} {
+    }
+
+    boost::uint64_t next() {
+        f = std::move( f).resume();
+        return value;
+    }
+};
+
+duration_type fiber_generate( boost::uint64_t n) {
+    fiber_generator g;
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += g.next();
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    return d;
+}
+
+// each stage pulls from the previous one and adds 1
+struct fiber_stage {
+    boost::uint64_t     value{ 0 };
+    ctx::fiber          f;
+
+    template< typename Source >
+    fiber_stage( Source & source) :
+        f{ [this,&source]( ctx::fiber && caller) {
+                for (;;) {
+                    value = source.next() + 1;
+                    caller = std::move( caller).resume();
+                }
+                return std::move( caller);
+            }} {
+    }
+
+    boost::uint64_t next() {
+        f = std::move( f).resume();
+        return value;
+    }
+};
+
+constexpr std::size_t pipeline_stages = 4;
+
+duration_type fiber_pipeline( boost::uint64_t n) {
+    fiber_generator source;
+    fiber_stage s1{ source }, s2{ s1 }, s3{ s2 }, s4{ s3 };
+    static_assert( 4 == pipeline_stages, "stages");
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += s4.next();
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    return d;
+}
+
+duration_type fiber_create( boost::uint64_t n) {
+    ctx::fixedsize_stack salloc;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        ctx::fiber f{ std::allocator_arg, salloc,
+            []( ctx::fiber && f) {
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+// C++20 coroutines
+
+// size of the last coroutine frame allocated
+std::size_t frame_size = 0;
+
+struct generator {
+    struct promise_type {
+        boost::uint64_t     value{ 0 };
+
+        static void * operator new( std::size_t size) {
+            frame_size = size;
+            return ::operator new( size);
+        }
+
+        static void operator delete( void * p) noexcept {
+            ::operator delete( p);
+        }
+
+        generator get_return_object() noexcept {
+            return generator{ std::coroutine_handle< promise_type >::from_promise( * this) };
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always yield_value( boost::uint64_t v) noexcept {
+            value = v;
+            return {};
+        }
+
+        void return_void() noexcept {
+        }
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+
+    std::coroutine_handle< promise_type >   h;
+
+    explicit generator( std::coroutine_handle< promise_type > h_) noexcept :
+        h{ h_ } {
+    }
+
+    generator( generator && other) noexcept :
+        h{ other.h } {
+        other.h = nullptr;
+    }
+
+    generator( generator const&) = delete;
+    generator & operator=( generator const&) = delete;
+
+    ~generator() {
+        if ( h) {
+            h.destroy();
+        }
+    }
+
+    boost::uint64_t next() {
+        h.resume();
+        return h.promise().value;
+    }
+};
+
+generator counter() {
+    for ( boost::uint64_t i = 0;; ++i) {
+        co_yield i;
+    }
+}
+
+generator stage( generator & source) {
+    for (;;) {
+        co_yield source.next() + 1;
+    }
+}
+
+generator empty() {
+    co_return;
+}
+
+duration_type coroutine_ping_pong( boost::uint64_t n) {
+    generator g = counter();
+    g.next();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        g.h.resume();
+    }
+    return clock_type::now() - start;
+}
+
+duration_type coroutine_generate( boost::uint64_t n) {
+    generator g = counter();
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += g.next();
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    return d;
+}
+
+duration_type coroutine_pipeline( boost::uint64_t n) {
+    generator source = counter();
+    generator s1 = stage( source), s2 = stage( s1), s3 = stage( s2), s4 = stage( s3);
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += s4.next();
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    return d;
+}
+
+duration_type coroutine_create( boost::uint64_t n) {
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        generator g = empty();
+        g.h.resume();
+    }
+    return clock_type::now() - start;
+}
+
+// OS threads handing off with a futex
+
+#if defined(__linux__)
+void futex_wait( std::atomic< boost::uint32_t > & a, boost::uint32_t expected) {
+    ::syscall( SYS_futex, reinterpret_cast< boost::uint32_t * >( & a), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake( std::atomic< boost::uint32_t > & a, bool all = false) {
+    ::syscall( SYS_futex, reinterpret_cast< boost::uint32_t * >( & a), FUTEX_WAKE_PRIVATE,
+               all ? INT_MAX : 1, nullptr, nullptr, 0);
+}
+#else
+void futex_wait( std::atomic< boost::uint32_t > & a, boost::uint32_t expected) {
+    a.wait( expected, std::memory_order_acquire);
+}
+
+void futex_wake( std::atomic< boost::uint32_t > & a, bool all = false) {
+    if ( all) {
+        a.notify_all();
+    } else {
+        a.notify_one();
+    }
+}
+#endif
+
+// single-slot channel
+struct channel {
+    std::atomic< boost::uint32_t >  full{ 0 };
+    boost::uint64_t                 value{ 0 };
+
+    void wait_for( boost::uint32_t state) {
+        boost::uint32_t s;
+        while ( state != ( s = full.load( std::memory_order_acquire) ) ) {
+            futex_wait( full, s);
+        }
+    }
+
+    void push( boost::uint64_t v) {
+        wait_for( 0);
+        value = v;
+        full.store( 1, std::memory_order_release);
+        futex_wake( full);
+    }
+
+    boost::uint64_t pop() {
+        wait_for( 1);
+        boost::uint64_t v = value;
+        full.store( 0, std::memory_order_release);
+        futex_wake( full);
+        return v;
+    }
+};
+
+duration_type thread_generate( boost::uint64_t n) {
+    channel c;
+    std::thread producer{ [&c,n](){
+                for ( boost::uint64_t i = 0; i < n; ++i) {
+                    c.push( i);
+                }
+            }};
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += c.pop();
+    }
+    duration_type d = clock_type::now() - start;
+    producer.join();
+    sink = sum;
+    return d;
+}
+
+duration_type thread_ping_pong( boost::uint64_t n) {
+    channel ping, pong;
+    std::thread t{ [&ping,&pong,n](){
+                for ( boost::uint64_t i = 0; i < n; ++i) {
+                    pong.push( ping.pop() );
+                }
+            }};
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        ping.push( i);
+        pong.pop();
+    }
+    duration_type d = clock_type::now() - start;
+    t.join();
+    return d;
+}
+
+duration_type thread_pipeline( boost::uint64_t n) {
+    channel channels[pipeline_stages + 1];
+    std::vector< std::thread > threads;
+    threads.emplace_back( [&channels,n](){
+                for ( boost::uint64_t i = 0; i < n; ++i) {
+                    channels[0].push( i);
+                }
+            });
+    for ( std::size_t s = 0; s < pipeline_stages; ++s) {
+        threads.emplace_back( [&channels,s,n](){
+                    for ( boost::uint64_t i = 0; i < n; ++i) {
+                        channels[s + 1].push( channels[s].pop() + 1);
+                    }
+                });
+    }
+    boost::uint64_t sum = 0;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        sum += channels[pipeline_stages].pop();
+    }
+    duration_type d = clock_type::now() - start;
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    sink = sum;
+    return d;
+}
+
+duration_type thread_create( boost::uint64_t n) {
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        std::thread{ [](){} }.join();
+    }
+    return clock_type::now() - start;
+}
+
+// ping-pong: 2 switches per iteration; generator: one value (2 switches);
+// pipeline: one value through all stages
+register_benchmark fiber_ping_pong_benchmark{ "ping-pong/fiber", fiber_ping_pong, 2 };
+register_benchmark coroutine_ping_pong_benchmark{ "ping-pong/coroutine", coroutine_ping_pong, 2 };
+register_benchmark thread_ping_pong_benchmark{ "ping-pong/thread", thread_ping_pong, 2, 100 };
+register_benchmark fiber_generate_benchmark{ "generator/fiber", fiber_generate };
+register_benchmark coroutine_generate_benchmark{ "generator/coroutine", coroutine_generate };
+register_benchmark thread_generate_benchmark{ "generator/thread", thread_generate, 1, 100 };
+register_benchmark fiber_pipeline_benchmark{ "pipeline/fiber", fiber_pipeline };
+register_benchmark coroutine_pipeline_benchmark{ "pipeline/coroutine", coroutine_pipeline };
+register_benchmark thread_pipeline_benchmark{ "pipeline/thread", thread_pipeline, 1, 100 };
+register_benchmark fiber_create_benchmark{ "create/fiber", fiber_create, 1, 10 };
+register_benchmark coroutine_create_benchmark{ "create/coroutine", coroutine_create, 1, 10 };
+register_benchmark thread_create_benchmark{ "create/thread", thread_create, 1, 1000 };
+
+// memory of suspended tasks
+
+struct task_memory {
+    std::string         name;
+    std::size_t         tasks;
+    // bytes reserved per task (stack, coroutine frame)
+    std::size_t         reserved;
+    process_memory      before;
+    process_memory      after;
+};
+
+void write_memory( std::ostream & os, task_memory const& m) {
+    double n = static_cast< double >( m.tasks);
+    double resident = static_cast< double >( m.after.resident - (std::min)( m.after.resident, m.before.resident) );
+    os << std::fixed << std::setprecision( 1)
+       << std::left << std::setw( 12) << m.name << std::right << std::setw( 9) << m.tasks
+       << std::setw( 14) << m.reserved << std::setw( 14) << resident / n
+       << std::setw( 12) << static_cast< double >( m.after.mappings - m.before.mappings) / n << std::endl;
+    os.unsetf( std::ios_base::floatfield);
+}
+
+task_memory fiber_memory( std::size_t n) {
+    task_memory m{ "fiber", n, ctx::stack_traits::default_size(), {}, {} };
+    std::vector< ctx::fiber > fibers;
+    fibers.reserve( n);
+    m.before = memory_of_process();
+    ctx::fixedsize_stack salloc;
+    for ( std::size_t i = 0; i < n; ++i) {
+        fibers.push_back( ctx::fiber{ std::allocator_arg, salloc, fiber_loop }.resume() );
+    }
+    m.after = memory_of_process();
+    return m;
+}
+
+task_memory coroutine_memory( std::size_t n) {
+    task_memory m{ "coroutine", n, 0, {}, {} };
+    std::vector< generator > coroutines;
+    coroutines.reserve( n);
+    m.before = memory_of_process();
+    for ( std::size_t i = 0; i < n; ++i) {
+        coroutines.push_back( counter() );
+        coroutines.back().next();
+    }
+    m.reserved = frame_size;
+    m.after = memory_of_process();
+    return m;
+}
+
+task_memory thread_memory( std::size_t n) {
+    task_memory m{ "thread", n, 0, {}, {} };
+#if defined(__linux__)
+    pthread_attr_t attr;
+    if ( 0 == ::pthread_getattr_default_np( & attr) ) {
+        ::pthread_attr_getstacksize( & attr, & m.reserved);
+        ::pthread_attr_destroy( & attr);
+    }
+#endif
+    channel blocked;
+    std::vector< std::thread > threads;
+    threads.reserve( n);
+    m.before = memory_of_process();
+    std::atomic< std::size_t > started{ 0 };
+    for ( std::size_t i = 0; i < n; ++i) {
+        threads.emplace_back( [&blocked,&started](){
+                    ++started;
+                    blocked.wait_for( 1);
+                });
+    }
+    while ( n != started.load() ) {
+        std::this_thread::yield();
+    }
+    m.after = memory_of_process();
+    blocked.full.store( 1, std::memory_order_release);
+    futex_wake( blocked.full, true);
+    for ( std::thread & t : threads) {
+        t.join();
+    }
+    return m;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        benchmark_options options;
+        std::size_t tasks = 10000;
+        std::size_t thread_tasks = 1000;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & options.jobs), "iterations per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & options.trials), "measured trials")
+            ("warmup,w", boost::program_options::value< std::size_t >( & options.warmup), "warm-up trials")
+            ("filter,f", boost::program_options::value< std::string >( & options.filter), "run benchmarks containing this string")
+            ("tasks", boost::program_options::value< std::size_t >( & tasks), "suspended fibers and coroutines for the memory footprint")
+            ("threads", boost::program_options::value< std::size_t >( & thread_tasks), "blocked threads for the memory footprint");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::cout << options.trials << " trials of " << options.jobs << " iterations ("
+                  << options.warmup << " warm-up), ns per switch, value or task" << std::endl;
+        write_table( std::cout, run_benchmarks( options) );
+
+        std::cout << std::endl << std::left << std::setw( 12) << "memory" << std::right << std::setw( 9) << "tasks"
+                  << std::setw( 14) << "reserved" << std::setw( 14) << "RSS/task" << std::setw( 12) << "VMAs/task" << std::endl;
+        write_memory( std::cout, fiber_memory( tasks) );
+        write_memory( std::cout, coroutine_memory( tasks) );
+        write_memory( std::cout, thread_memory( thread_tasks) );
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
+
+#else
+
+int main() {
+    std::cerr << "C++20 coroutines are not supported by this compiler" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
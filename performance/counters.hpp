@@ -0,0 +1,134 @@
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstddef>
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+#include <boost/predef.h>
+
+#if BOOST_OS_LINUX
+# define BOOST_CONTEXT_PERF_COUNTERS
+extern "C" {
+# include <linux/perf_event.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+}
+#endif
+
+// hardware events counted by perf_counters
+enum perf_event_index {
+    perf_cycles = 0,
+    perf_instructions,
+    perf_branch_misses,
+    perf_l1d_misses,
+    perf_cache_misses,
+    perf_dtlb_misses,
+    perf_event_count
+};
+
+inline
+char const* perf_event_name( std::size_t i) {
+    static char const* names[perf_event_count] = {
+        "cycles", "instructions", "branch-misses", "L1D-misses", "cache-misses", "dTLB-misses" };
+    return names[i];
+}
+
+struct perf_sample {
+    boost::uint64_t     values[perf_event_count];
+};
+
+// perf_event_open(2) group counting the calling thread in user mode;
+// events not supported by the CPU (or the hypervisor) read as zero
+class perf_counters {
+private:
+    int                 fd_[perf_event_count];
+    int                 leader_{ -1 };
+
+public:
+    perf_counters() {
+        for ( std::size_t i = 0; i < perf_event_count; ++i) {
+            fd_[i] = -1;
+        }
+#if defined(BOOST_CONTEXT_PERF_COUNTERS)
+        static boost::uint64_t const configs[perf_event_count][2] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                  ( PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                  ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            // last level cache
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                  ( PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                  ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16) } };
+        for ( std::size_t i = 0; i < perf_event_count; ++i) {
+            perf_event_attr attr;
+            std::memset( & attr, 0, sizeof( attr) );
+            attr.size = sizeof( attr);
+            attr.type = static_cast< boost::uint32_t >( configs[i][0]);
+            attr.config = configs[i][1];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fd_[i] = static_cast< int >( ::syscall(
+                    __NR_perf_event_open, & attr, 0, -1, leader_, PERF_FLAG_FD_CLOEXEC) );
+            if ( -1 == leader_) {
+                leader_ = fd_[i];
+            }
+        }
+#endif
+    }
+
+    ~perf_counters() {
+#if defined(BOOST_CONTEXT_PERF_COUNTERS)
+        for ( std::size_t i = 0; i < perf_event_count; ++i) {
+            if ( -1 != fd_[i]) {
+                ::close( fd_[i]);
+            }
+        }
+#endif
+    }
+
+    perf_counters( perf_counters const&) = delete;
+    perf_counters & operator=( perf_counters const&) = delete;
+
+    // false if no event could be opened (no PMU, perf_event_paranoid)
+    bool valid() const {
+        return -1 != leader_;
+    }
+
+    bool supported( std::size_t i) const {
+        return -1 != fd_[i];
+    }
+
+    perf_sample read() const {
+        perf_sample s;
+        std::memset( & s, 0, sizeof( s) );
+#if defined(BOOST_CONTEXT_PERF_COUNTERS)
+        if ( ! valid() ) {
+            return s;
+        }
+        // PERF_FORMAT_GROUP: number of events followed by the values
+        // in the order the events were added to the group
+        boost::uint64_t buffer[1 + perf_event_count] = { 0 };
+        if ( 0 > ::read( leader_, buffer, sizeof( buffer) ) ) {
+            return s;
+        }
+        for ( std::size_t i = 0, j = 1; i < perf_event_count; ++i) {
+            if ( -1 != fd_[i] && j <= buffer[0]) {
+                s.values[i] = buffer[j++];
+            }
+        }
+#endif
+        return s;
+    }
+};
+
+#endif // COUNTERS_H
@@ -20,17 +20,17 @@
 
 typedef boost::uint64_t cycle_type;
 
+// fenced by rdtscp/lfence, see cycle_x86-64.hpp
 #if _MSC_VER
+# include <intrin.h>
+# pragma intrinsic(__rdtscp)
+# pragma intrinsic(_mm_lfence)
 inline
 cycle_type cycles()
 {
-    cycle_type c;
-    __asm {
-        cpuid 
-        rdtsc
-        mov dword ptr [c + 0], eax
-        mov dword ptr [c + 4], edx
-    }
+    unsigned int aux;
+    cycle_type c = __rdtscp( & aux);
+    _mm_lfence();
     return c;
 }
 #elif defined(__GNUC__) || \
@@ -41,18 +41,12 @@ cycle_type cycles()
     boost::uint32_t lo, hi;
 
     __asm__ __volatile__ (
-        "xorl %%eax, %%eax\n"
-        "cpuid\n"
-        ::: "%eax", "%ebx", "%ecx", "%edx"
-    );
-    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi) );
-    __asm__ __volatile__ (
-        "xorl %%eax, %%eax\n"
-        "cpuid\n"
-        ::: "%eax", "%ebx", "%ecx", "%edx"
+        "rdtscp\n"
+        "lfence\n"
+        : "=a" (lo), "=d" (hi) :: "%ecx", "memory"
     );
 
-    return ( cycle_type)hi << 32 | lo; 
+    return ( cycle_type)hi << 32 | lo;
 }
 #else
 # error "this compiler is not supported"
@@ -77,7 +71,7 @@ cycle_type overhead_cycle()
             overhead.begin(), overhead.end(),
             cycle_overhead() );
     BOOST_ASSERT( overhead.begin() != overhead.end() );
-    return std::accumulate( overhead.begin(), overhead.end(), 0) / iterations;
+    return std::accumulate( overhead.begin(), overhead.end(), cycle_type( 0) ) / iterations;
 }
 
 #endif // CYCLE_I386_H
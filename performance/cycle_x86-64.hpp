@@ -20,16 +20,31 @@
 
 typedef boost::uint64_t cycle_type;
 
+// rdtscp waits until the preceding instructions have executed, lfence
+// keeps the following instructions from starting before the counter is
+// read; unlike cpuid neither causes a VM exit under virtualization
 #if _MSC_VER >= 1400
 # include <intrin.h>
-# pragma intrinsic(__rdtsc)
+# pragma intrinsic(__rdtscp)
+# pragma intrinsic(_mm_lfence)
 inline
 cycle_type cycles()
-{ return __rdtsc(); }
+{
+    unsigned int aux;
+    cycle_type c = __rdtscp( & aux);
+    _mm_lfence();
+    return c;
+}
 #elif defined(__INTEL_COMPILER) || defined(__ICC) || defined(_ECC) || defined(__ICL)
+# include <immintrin.h>
 inline
 cycle_type cycles()
-{ return __rdtsc(); }
+{
+    unsigned int aux;
+    cycle_type c = __rdtscp( & aux);
+    _mm_lfence();
+    return c;
+}
 #elif defined(__GNUC__) || defined(__SUNPRO_C)
 inline
 cycle_type cycles()
@@ -37,18 +52,12 @@ cycle_type cycles()
     boost::uint32_t lo, hi;
 
     __asm__ __volatile__ (
-        "xorl %%eax, %%eax\n"
-        "cpuid\n"
-        ::: "%rax", "%rbx", "%rcx", "%rdx"
-    );
-    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi) );
-    __asm__ __volatile__ (
-        "xorl %%eax, %%eax\n"
-        "cpuid\n"
-        ::: "%rax", "%rbx", "%rcx", "%rdx"
+        "rdtscp\n"
+        "lfence\n"
+        : "=a" (lo), "=d" (hi) :: "%rcx", "memory"
     );
 
-    return ( cycle_type)hi << 32 | lo; 
+    return ( cycle_type)hi << 32 | lo;
 }
 #else
 # error "this compiler is not supported"
@@ -73,7 +82,7 @@ cycle_type overhead_cycle()
             overhead.begin(), overhead.end(),
             cycle_overhead() );
     BOOST_ASSERT( overhead.begin() != overhead.end() );
-    return std::accumulate( overhead.begin(), overhead.end(), 0) / iterations;
+    return std::accumulate( overhead.begin(), overhead.end(), cycle_type( 0) ) / iterations;
 }
 
 #endif // CYCLE_X86_64_H
@@ -0,0 +1,379 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// fiber-per-connection echo server and an in-process load generator over
+// AF_UNIX socketpairs, scheduled by one thread waiting in epoll (Linux)
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+#include <boost/context/segmented_stack.hpp>
+#endif
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+#include "../benchmark.hpp"
+#include "../memory.hpp"
+
+namespace ctx = boost::context;
+
+class scheduler;
+
+struct task {
+    ctx::fiber          f{};
+    bool                done{ false };
+};
+
+// one end of a socketpair, registered edge-triggered for reading and writing
+struct endpoint {
+    int                 fd{ -1 };
+    task            *   reader{ nullptr };
+    task            *   writer{ nullptr };
+};
+
+class scheduler {
+private:
+    int                                 epfd_;
+    std::deque< task * >                ready_{};
+    std::vector< std::unique_ptr< task > >  tasks_{};
+    std::size_t                         live_{ 0 };
+    task                            *   running_{ nullptr };
+    // continuation of run() while a task is running
+    ctx::fiber                          loop_{};
+
+public:
+    scheduler() :
+        epfd_{ ::epoll_create1( EPOLL_CLOEXEC) } {
+        if ( -1 == epfd_) {
+            throw std::system_error( errno, std::system_category(), "epoll_create1() failed");
+        }
+    }
+
+    ~scheduler() {
+        ::close( epfd_);
+    }
+
+    scheduler( scheduler const&) = delete;
+    scheduler & operator=( scheduler const&) = delete;
+
+    template< typename StackAlloc, typename Fn >
+    void spawn( StackAlloc salloc, Fn fn) {
+        tasks_.emplace_back( new task{} );
+        task * t = tasks_.back().get();
+        t->f = ctx::fiber{ std::allocator_arg, salloc,
+            [this,t,fn]( ctx::fiber && f) {
+                loop_ = std::move( f);
+                fn();
+                t->done = true;
+                return std::move( loop_);
+            }};
+        ready_.push_back( t);
+        ++live_;
+    }
+
+    void add( endpoint & ep) {
+        ::epoll_event ev;
+        std::memset( & ev, 0, sizeof( ev) );
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = & ep;
+        if ( -1 == ::epoll_ctl( epfd_, EPOLL_CTL_ADD, ep.fd, & ev) ) {
+            throw std::system_error( errno, std::system_category(), "epoll_ctl() failed");
+        }
+    }
+
+    // suspends the running task until `ep` becomes readable/writable
+    void wait_readable( endpoint & ep) {
+        ep.reader = running_;
+        loop_ = std::move( loop_).resume();
+    }
+
+    void wait_writable( endpoint & ep) {
+        ep.writer = running_;
+        loop_ = std::move( loop_).resume();
+    }
+
+    void run() {
+        ::epoll_event events[256];
+        while ( 0 < live_) {
+            while ( ! ready_.empty() ) {
+                running_ = ready_.front();
+                ready_.pop_front();
+                running_->f = std::move( running_->f).resume();
+                if ( running_->done) {
+                    --live_;
+                }
+            }
+            running_ = nullptr;
+            if ( 0 == live_) {
+                break;
+            }
+            int n = ::epoll_wait( epfd_, events, 256, -1);
+            if ( -1 == n && EINTR != errno) {
+                throw std::system_error( errno, std::system_category(), "epoll_wait() failed");
+            }
+            for ( int i = 0; i < n; ++i) {
+                endpoint * ep = static_cast< endpoint * >( events[i].data.ptr);
+                if ( nullptr != ep->reader && 0 != ( events[i].events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR) ) ) {
+                    ready_.push_back( ep->reader);
+                    ep->reader = nullptr;
+                }
+                if ( nullptr != ep->writer && 0 != ( events[i].events & ( EPOLLOUT | EPOLLHUP | EPOLLERR) ) ) {
+                    ready_.push_back( ep->writer);
+                    ep->writer = nullptr;
+                }
+            }
+        }
+        tasks_.clear();
+    }
+};
+
+// false at end of stream
+bool read_full( scheduler & s, endpoint & ep, char * buffer, std::size_t size) {
+    while ( 0 < size) {
+        ssize_t n = ::read( ep.fd, buffer, size);
+        if ( 0 < n) {
+            buffer += n;
+            size -= static_cast< std::size_t >( n);
+        } else if ( 0 == n) {
+            return false;
+        } else if ( EAGAIN == errno || EWOULDBLOCK == errno) {
+            s.wait_readable( ep);
+        } else if ( EINTR != errno) {
+            throw std::system_error( errno, std::system_category(), "read() failed");
+        }
+    }
+    return true;
+}
+
+void write_full( scheduler & s, endpoint & ep, char const* buffer, std::size_t size) {
+    while ( 0 < size) {
+        ssize_t n = ::write( ep.fd, buffer, size);
+        if ( 0 <= n) {
+            buffer += n;
+            size -= static_cast< std::size_t >( n);
+        } else if ( EAGAIN == errno || EWOULDBLOCK == errno) {
+            s.wait_writable( ep);
+        } else if ( EINTR != errno) {
+            throw std::system_error( errno, std::system_category(), "write() failed");
+        }
+    }
+}
+
+struct settings {
+    std::size_t         requests{ 100000 };
+    std::size_t         message{ 64 };
+};
+
+struct load_result {
+    double              requests_per_second{ 0 };
+    // latencies in micro seconds
+    double              p50{ 0 };
+    double              p99{ 0 };
+    double              p999{ 0 };
+};
+
+// `connections` clients send `requests` messages in total (one outstanding
+// per connection) to one server fiber per connection, which echoes them
+template< typename StackAlloc >
+load_result run_load( StackAlloc salloc, std::size_t connections, settings const& s) {
+    std::vector< endpoint > servers( connections), clients( connections);
+    std::vector< double > latencies;
+    latencies.reserve( s.requests);
+    scheduler sched;
+    try {
+        for ( std::size_t i = 0; i < connections; ++i) {
+            int fds[2];
+            if ( -1 == ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) ) {
+                throw std::system_error( errno, std::system_category(), "socketpair() failed");
+            }
+            servers[i].fd = fds[0];
+            clients[i].fd = fds[1];
+            sched.add( servers[i]);
+            sched.add( clients[i]);
+        }
+        std::size_t per_connection = (std::max)( s.requests / connections, std::size_t( 1) );
+        std::size_t message = s.message;
+        for ( std::size_t i = 0; i < connections; ++i) {
+            endpoint * server = & servers[i];
+            endpoint * client = & clients[i];
+            sched.spawn( salloc, [&sched,server,message](){
+                        std::vector< char > buffer( message);
+                        while ( read_full( sched, * server, buffer.data(), message) ) {
+                            write_full( sched, * server, buffer.data(), message);
+                        }
+                    });
+            sched.spawn( salloc, [&sched,&latencies,client,message,per_connection](){
+                        std::vector< char > buffer( message, 'x');
+                        for ( std::size_t r = 0; r < per_connection; ++r) {
+                            time_point_type start( clock_type::now() );
+                            write_full( sched, * client, buffer.data(), message);
+                            read_full( sched, * client, buffer.data(), message);
+                            latencies.push_back( static_cast< double >(
+                                    boost::chrono::duration_cast< boost::chrono::nanoseconds >(
+                                        clock_type::now() - start).count() ) / 1000);
+                        }
+                        // end of stream for the server
+                        ::shutdown( client->fd, SHUT_WR);
+                    });
+        }
+        time_point_type start( clock_type::now() );
+        sched.run();
+        duration_type d = clock_type::now() - start;
+        load_result r;
+        double ns = static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() );
+        r.requests_per_second = 0 < ns ? latencies.size() * 1e9 / ns : 0.0;
+        std::sort( latencies.begin(), latencies.end() );
+        if ( ! latencies.empty() ) {
+            r.p50 = percentile_of( latencies, 0.5);
+            r.p99 = percentile_of( latencies, 0.99);
+            r.p999 = percentile_of( latencies, 0.999);
+        }
+        for ( std::size_t i = 0; i < connections; ++i) {
+            ::close( servers[i].fd);
+            ::close( clients[i].fd);
+        }
+        return r;
+    } catch (...) {
+        for ( std::size_t i = 0; i < connections; ++i) {
+            if ( -1 != servers[i].fd) {
+                ::close( servers[i].fd);
+            }
+            if ( -1 != clients[i].fd) {
+                ::close( clients[i].fd);
+            }
+        }
+        throw;
+    }
+}
+
+void write_row( std::string const& allocator, std::size_t stack_size, std::size_t connections, load_result const& r) {
+    std::cout << std::fixed << std::setprecision( 1)
+              << std::left << std::setw( 26) << allocator << std::right << std::setw( 10) << stack_size
+              << std::setw( 12) << connections << std::setw( 14) << r.requests_per_second
+              << std::setw( 10) << r.p50 << std::setw( 10) << r.p99 << std::setw( 10) << r.p999 << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+template< typename StackAlloc >
+void sweep( std::string const& name, std::vector< std::size_t > const& stack_sizes,
+            std::vector< std::size_t > const& connections, std::string const& filter, settings const& s) {
+    if ( std::string::npos == name.find( filter) ) {
+        return;
+    }
+    for ( std::size_t stack_size : stack_sizes) {
+        for ( std::size_t n : connections) {
+            // two fibers per connection
+            if ( std::string{ "protected_fixedsize_stack" } == name && 2 * n > max_protected_stacks() ) {
+                std::cerr << name << ": " << n << " connections exceed vm.max_map_count" << std::endl;
+                break;
+            }
+            try {
+                write_row( name, stack_size, n, run_load( StackAlloc{ stack_size }, n, s) );
+            } catch ( std::system_error const& e) {
+                std::cerr << name << ": " << n << " connections: " << e.what() << std::endl;
+                break;
+            } catch ( std::bad_alloc const&) {
+                std::cerr << name << ": unable to allocate " << 2 * n << " fibers" << std::endl;
+                break;
+            }
+        }
+    }
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        std::vector< std::size_t > stack_sizes{ 16 * 1024, 64 * 1024 };
+        std::vector< std::size_t > connections{ 1, 10, 100, 1000, 10000 };
+        std::string filter;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("requests,r", boost::program_options::value< std::size_t >( & s.requests), "requests per run")
+            ("message", boost::program_options::value< std::size_t >( & s.message), "bytes per request and response")
+            ("connections,c", boost::program_options::value< std::vector< std::size_t > >( & connections)->multitoken(), "connection counts")
+            ("stack-size,s", boost::program_options::value< std::vector< std::size_t > >( & stack_sizes)->multitoken(), "stack sizes in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & filter), "stack allocators containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == s.message || 0 == s.requests) {
+            throw std::invalid_argument("--message and --requests must be positive");
+        }
+        // two descriptors per connection
+        rlimit limit;
+        if ( 0 == ::getrlimit( RLIMIT_NOFILE, & limit) ) {
+            limit.rlim_cur = limit.rlim_max;
+            ::setrlimit( RLIMIT_NOFILE, & limit);
+        }
+
+        std::cout << s.requests << " requests of " << s.message << " bytes per run, latency in micro seconds" << std::endl;
+        std::cout << std::left << std::setw( 26) << "allocator" << std::right << std::setw( 10) << "stack"
+                  << std::setw( 12) << "connections" << std::setw( 14) << "requests/s"
+                  << std::setw( 10) << "p50" << std::setw( 10) << "p99" << std::setw( 10) << "p99.9" << std::endl;
+        sweep< ctx::fixedsize_stack >( "fixedsize_stack", stack_sizes, connections, filter, s);
+        sweep< ctx::protected_fixedsize_stack >( "protected_fixedsize_stack", stack_sizes, connections, filter, s);
+        sweep< ctx::pooled_fixedsize_stack >( "pooled_fixedsize_stack", stack_sizes, connections, filter, s);
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+        sweep< ctx::segmented_stack >( "segmented_stack", stack_sizes, connections, filter, s);
+#endif
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
+
+#else
+
+int main() {
+    std::cerr << "the echo benchmark requires epoll (Linux)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
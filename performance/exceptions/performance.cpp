@@ -0,0 +1,237 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// generators failing every N-th item: the error reported by a status flag,
+// by an exception caught in the generator and rethrown by the consumer
+// (std::exception_ptr), and by an exception propagated by resume()
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../../test/allocations.hpp"
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+struct settings {
+    benchmark_options   options;
+    // every N-th item fails, the generator terminates
+    std::size_t         error_every{ 16 };
+    std::size_t         stack_size{ 16 * 1024 };
+};
+
+struct bad_item : public std::exception {
+    char const* what() const noexcept override {
+        return "bad item";
+    }
+};
+
+volatile boost::uint64_t sink = 0;
+
+bool failing( settings const& s, boost::uint64_t k) noexcept {
+    return 0 == ( k + 1) % s.error_every;
+}
+
+struct result {
+    double              item_ns{ 0 };
+    double              error_mallocs{ 0 };
+};
+
+// `n` items are consumed, a new generator replaces a failed one
+template< typename Consume >
+result measure_items( boost::uint64_t n, Consume && consume) {
+    boost::uint64_t next = 0;
+    boost::uint64_t sum = 0;
+    boost::uint64_t errors = 0;
+    std::size_t allocs = allocations();
+    time_point_type start( clock_type::now() );
+    while ( next < n) {
+        consume( next, sum, errors);
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    result r;
+    r.item_ns = static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) / next;
+    r.error_mallocs = 0 != errors ? static_cast< double >( allocations() - allocs) / errors : 0;
+    return r;
+}
+
+result run_status( settings const& s, ctx::pooled_fixedsize_stack & salloc, boost::uint64_t n) {
+    return measure_items( n, [&s,&salloc,n]( boost::uint64_t & next, boost::uint64_t & sum, boost::uint64_t & errors) {
+        boost::uint64_t value = 0;
+        bool failed = false;
+        ctx::fiber f{ std::allocator_arg, salloc,
+            [&s,&next,&value,&failed]( ctx::fiber && f) {
+                for (;;) {
+                    boost::uint64_t k = next++;
+                    if ( failing( s, k) ) {
+                        failed = true;
+                        break;
+                    }
+                    value = k;
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        while ( next < n) {
+            f = std::move( f).resume();
+            if ( failed) {
+                ++errors;
+                return;
+            }
+            sum += value;
+        }
+    });
+}
+
+result run_exception_ptr( settings const& s, ctx::pooled_fixedsize_stack & salloc, boost::uint64_t n) {
+    return measure_items( n, [&s,&salloc,n]( boost::uint64_t & next, boost::uint64_t & sum, boost::uint64_t & errors) {
+        boost::uint64_t value = 0;
+        std::exception_ptr except;
+        ctx::fiber f{ std::allocator_arg, salloc,
+            [&s,&next,&value,&except]( ctx::fiber && f) {
+                try {
+                    for (;;) {
+                        boost::uint64_t k = next++;
+                        if ( failing( s, k) ) {
+                            throw bad_item{};
+                        }
+                        value = k;
+                        f = std::move( f).resume();
+                    }
+                } catch ( ctx::detail::forced_unwind const&) {
+                    throw;
+                } catch ( ...) {
+                    except = std::current_exception();
+                }
+                return std::move( f);
+            }};
+        try {
+            while ( next < n) {
+                f = std::move( f).resume();
+                if ( except) {
+                    std::rethrow_exception( except);
+                }
+                sum += value;
+            }
+        } catch ( bad_item const&) {
+            ++errors;
+        }
+    });
+}
+
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+result run_propagated( settings const& s, ctx::pooled_fixedsize_stack & salloc, boost::uint64_t n) {
+    return measure_items( n, [&s,&salloc,n]( boost::uint64_t & next, boost::uint64_t & sum, boost::uint64_t & errors) {
+        boost::uint64_t value = 0;
+        ctx::fiber f{ std::allocator_arg, salloc,
+            [&s,&next,&value]( ctx::fiber && f) {
+                for (;;) {
+                    boost::uint64_t k = next++;
+                    if ( failing( s, k) ) {
+                        throw bad_item{};
+                    }
+                    value = k;
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        try {
+            while ( next < n) {
+                f = std::move( f).resume();
+                sum += value;
+            }
+        } catch ( bad_item const&) {
+            ++errors;
+        }
+    });
+}
+#endif
+
+template< typename Run >
+void measure( std::string const& name, settings const& s, Run run) {
+    if ( std::string::npos == name.find( s.options.filter) ) {
+        return;
+    }
+    // stacks are recycled by the pool
+    ctx::pooled_fixedsize_stack salloc{ s.stack_size };
+    std::vector< double > ns, mallocs;
+    for ( std::size_t t = 0; t < s.options.warmup + (std::max)( s.options.trials, std::size_t( 1) ); ++t) {
+        result r = run( s, salloc, (std::max)( s.options.jobs, boost::uint64_t( 1) ) );
+        if ( t >= s.options.warmup) {
+            ns.push_back( r.item_ns);
+            mallocs.push_back( r.error_mallocs);
+        }
+    }
+    std::sort( ns.begin(), ns.end() );
+    std::sort( mallocs.begin(), mallocs.end() );
+    std::cout << std::fixed << std::setprecision( 2)
+              << std::left << std::setw( 16) << name << std::right
+              << std::setw( 12) << median_of( ns) << std::setw( 16) << median_of( mallocs) << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        s.options.trials = 5;
+        s.options.warmup = 1;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & s.options.jobs), "items per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & s.options.trials), "measured trials")
+            ("error-every", boost::program_options::value< std::size_t >( & s.error_every), "every N-th item fails")
+            ("stack-size", boost::program_options::value< std::size_t >( & s.stack_size), "stack size in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & s.options.filter), "variants containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == s.error_every) {
+            throw std::invalid_argument("--error-every must be positive");
+        }
+
+        std::cout << "every " << s.error_every << ". item fails" << std::endl;
+        std::cout << std::left << std::setw( 16) << "variant" << std::right
+                  << std::setw( 12) << "ns/item" << std::setw( 16) << "mallocs/error" << std::endl;
+        measure( "status", s, run_status);
+        measure( "exception_ptr", s, run_exception_ptr);
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+        measure( "propagated", s, run_propagated);
+#endif
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
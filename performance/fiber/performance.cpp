@@ -10,13 +10,22 @@
 #include <stdexcept>
 
 #include <boost/context/fiber.hpp>
+#if defined(BOOST_USE_FIBER_HOOKS)
+#include <boost/context/fiber_accounting.hpp>
+#include <boost/context/fiber_counters.hpp>
+#include <boost/context/fiber_histogram.hpp>
+#include <boost/context/fiber_trace.hpp>
+#endif
 #include <boost/cstdint.hpp>
 #include <boost/program_options.hpp>
 
+#include "../../test/allocations.hpp"
 #include "../clock.hpp"
+#include "../counters.hpp"
 #include "../cycle.hpp"
 
 boost::uint64_t jobs = 1000000;
+std::size_t loop_allocations = 0;
 
 namespace ctx = boost::context;
 
@@ -32,11 +41,13 @@ duration_type measure_time() {
     ctx::fiber f{ foo };
     f = std::move( f).resume();
 
+    std::size_t allocs = allocations();
     time_point_type start( clock_type::now() );
     for ( std::size_t i = 0; i < jobs; ++i) {
         f = std::move( f).resume();
     }
     duration_type total = clock_type::now() - start;
+    loop_allocations = allocations() - allocs;
     total -= overhead_clock(); // overhead of measurement
     total /= jobs;  // loops
     total /= 2;  // 2x jump_fcontext
@@ -64,12 +75,42 @@ cycle_type measure_cycles() {
 }
 #endif
 
+// hardware events per switch; false if not available
+bool measure_events( double (& events)[perf_event_count]) {
+    perf_counters counters;
+    if ( ! counters.valid() ) {
+        return false;
+    }
+    // cache warum-up
+    ctx::fixedsize_stack alloc;
+    ctx::fiber f{ std::allocator_arg, alloc, foo };
+    f = std::move( f).resume();
+
+    perf_sample start = counters.read();
+    for ( std::size_t i = 0; i < jobs; ++i) {
+        f = std::move( f).resume();
+    }
+    perf_sample stop = counters.read();
+    for ( std::size_t i = 0; i < perf_event_count; ++i) {
+        // 2x jump_fcontext per loop
+        events[i] = static_cast< double >( stop.values[i] - start.values[i]) / ( 2 * jobs);
+    }
+    return true;
+}
+
 int main( int argc, char * argv[]) {
     try {
         boost::program_options::options_description desc("allowed options");
         desc.add_options()
             ("help", "help message")
-            ("jobs,j", boost::program_options::value< boost::uint64_t >( & jobs), "jobs to run");
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & jobs), "jobs to run")
+#if defined(BOOST_USE_FIBER_HOOKS)
+            ("trace", "record context switches with the fiber tracer")
+            ("accounting", "account on-CPU time and resumes per fiber")
+            ("counters", "attribute hardware events to fibers")
+            ("histograms", "record run-slice and scheduling-delay histograms")
+#endif
+            ;
 
         boost::program_options::variables_map vm;
         boost::program_options::store(
@@ -85,12 +126,58 @@ int main( int argc, char * argv[]) {
             return EXIT_SUCCESS;
         }
 
+#if defined(BOOST_USE_FIBER_HOOKS)
+        if ( vm.count("trace") ) {
+            if ( ! ctx::start_fiber_trace() ) {
+                throw std::runtime_error("no fiber hook table left for the tracer");
+            }
+            std::cout << "fiber: tracing enabled" << std::endl;
+        }
+        if ( vm.count("accounting") ) {
+            if ( ! ctx::start_fiber_accounting() ) {
+                throw std::runtime_error("no fiber hook table left for the accounting");
+            }
+            std::cout << "fiber: accounting enabled" << std::endl;
+        }
+        if ( vm.count("counters") ) {
+            if ( ! ctx::start_fiber_counters() ) {
+                throw std::runtime_error("hardware counters not available");
+            }
+            std::cout << "fiber: hardware counters enabled ("
+                      << ( ctx::fiber_counters_access::rdpmc == ctx::fiber_counters_access_of_thread() ? "rdpmc" : "read")
+                      << ")" << std::endl;
+        }
+        if ( vm.count("histograms") ) {
+            if ( ! ctx::start_fiber_histograms() ) {
+                throw std::runtime_error("no fiber hook table left for the histograms");
+            }
+            std::cout << "fiber: histograms enabled" << std::endl;
+        }
+#endif
         boost::uint64_t res = measure_time().count();
         std::cout << "fiber: average of " << res << " nano seconds" << std::endl;
+        std::cout << "fiber: " << loop_allocations << " heap allocations" << std::endl;
 #ifdef BOOST_CONTEXT_CYCLE
         res = measure_cycles();
         std::cout << "fiber: average of " << res << " cpu cycles" << std::endl;
 #endif
+        double events[perf_event_count];
+        if ( measure_events( events) ) {
+            for ( std::size_t i = 0; i < perf_event_count; ++i) {
+                std::cout << "fiber: " << events[i] << " " << perf_event_name( i) << " per switch" << std::endl;
+            }
+        }
+#if defined(BOOST_USE_FIBER_HOOKS)
+        if ( vm.count("histograms") ) {
+            ctx::fiber_histograms h = ctx::fiber_histograms_snapshot();
+            for ( double q : { 0.5, 0.99, 0.999 }) {
+                std::cout << "fiber: run slice p" << q * 100 << " "
+                          << h.run_slice.percentile( q).count() << " nano seconds, scheduling delay p"
+                          << q * 100 << " " << h.scheduling_delay.percentile( q).count()
+                          << " nano seconds" << std::endl;
+            }
+        }
+#endif
 
         return EXIT_SUCCESS;
     } catch ( std::exception const& e) {
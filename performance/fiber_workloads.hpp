@@ -0,0 +1,80 @@
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// fiber workloads, shared by the suite and the backend comparison; the
+// templates take the fiber type, so every backend gets its own instantiation
+
+#ifndef FIBER_WORKLOADS_H
+#define FIBER_WORKLOADS_H
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/cstdint.hpp>
+
+#include "benchmark.hpp"
+
+template< typename Fiber >
+Fiber fiber_loop( Fiber && f) {
+    while ( true) {
+        f = std::move( f).resume();
+    }
+    return Fiber{};
+}
+
+template< typename Fiber >
+duration_type fiber_resume( boost::uint64_t n) {
+    Fiber f{ fiber_loop< Fiber > };
+    f = std::move( f).resume();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+template< typename Fiber >
+duration_type fiber_resume_with( boost::uint64_t n) {
+    Fiber f{ fiber_loop< Fiber > };
+    f = std::move( f).resume();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        f = std::move( f).resume_with(
+                []( Fiber && f) {
+                    return std::move( f);
+                });
+    }
+    return clock_type::now() - start;
+}
+
+// creation, first resume, termination and deallocation
+template< typename Fiber, typename StackAlloc >
+duration_type fiber_create( boost::uint64_t n) {
+    StackAlloc salloc;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        Fiber f{ std::allocator_arg, salloc,
+            []( Fiber && f) {
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+// creation, first resume and destruction of the suspended fiber (forced unwind)
+template< typename Fiber, typename StackAlloc >
+duration_type fiber_unwind( boost::uint64_t n) {
+    StackAlloc salloc;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        Fiber f{ std::allocator_arg, salloc, fiber_loop< Fiber > };
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+#endif // FIBER_WORKLOADS_H
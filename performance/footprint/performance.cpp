@@ -0,0 +1,186 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// memory footprint of many suspended fibers, each having touched
+// `--touch` bytes of its stack
+
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+#include <boost/context/segmented_stack.hpp>
+#endif
+#include <boost/context/stack_traits.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../clock.hpp"
+#include "../memory.hpp"
+
+namespace ctx = boost::context;
+
+std::size_t touch = 0;
+
+// writes the frames of `size` bytes of stack below the caller
+BOOST_NOINLINE
+void touch_stack( std::size_t size) {
+    volatile char buffer[1024];
+    buffer[0] = 0;
+    buffer[sizeof( buffer) - 1] = 0;
+    if ( sizeof( buffer) < size) {
+        touch_stack( size - sizeof( buffer) );
+    }
+    // no tail call
+    buffer[1] = buffer[0];
+}
+
+ctx::fiber suspended( ctx::fiber && f) {
+    touch_stack( touch);
+    f = std::move( f).resume();
+    return std::move( f);
+}
+
+struct footprint {
+    std::string         allocator;
+    std::size_t         fibers{ 0 };
+    process_memory      before{};
+    process_memory      after{};
+    duration_type       creation{ 0 };
+    duration_type       teardown{ 0 };
+};
+
+template< typename StackAlloc >
+bool measure( std::string const& name, StackAlloc salloc, std::size_t n, footprint & result) {
+    result.allocator = name;
+    result.fibers = n;
+    std::vector< ctx::fiber > fibers;
+    fibers.reserve( n);
+    result.before = memory_of_process();
+    time_point_type start( clock_type::now() );
+    try {
+        for ( std::size_t i = 0; i < n; ++i) {
+            fibers.push_back( ctx::fiber{ std::allocator_arg, salloc, suspended }.resume() );
+        }
+    } catch ( std::bad_alloc const&) {
+        std::cerr << name << ": unable to allocate " << n << " fibers" << std::endl;
+        return false;
+    }
+    result.creation = clock_type::now() - start;
+    result.after = memory_of_process();
+    start = clock_type::now();
+    // forced unwinding and deallocation
+    fibers.clear();
+    result.teardown = clock_type::now() - start;
+    return true;
+}
+
+void write_header( std::ostream & os) {
+    os << std::left << std::setw( 26) << "allocator" << std::right << std::setw( 9) << "fibers"
+       << std::setw( 12) << "RSS MiB" << std::setw( 12) << "RSS/fiber" << std::setw( 9) << "VMAs"
+       << std::setw( 14) << "minor faults" << std::setw( 14) << "major faults"
+       << std::setw( 14) << "create ns" << std::setw( 14) << "teardown ns" << std::endl;
+}
+
+// per fiber unless stated otherwise; RSS and VMAs of the fibers only
+void write_row( std::ostream & os, footprint const& f) {
+    double n = static_cast< double >( f.fibers);
+    double resident = static_cast< double >( f.after.resident - (std::min)( f.after.resident, f.before.resident) );
+    os << std::fixed << std::setprecision( 1)
+       << std::left << std::setw( 26) << f.allocator << std::right << std::setw( 9) << f.fibers
+       << std::setw( 12) << resident / ( 1024 * 1024) << std::setw( 12) << resident / n
+       << std::setw( 9) << static_cast< boost::int64_t >( f.after.mappings - f.before.mappings)
+       << std::setw( 14) << static_cast< double >( f.after.minor_faults - f.before.minor_faults) / n
+       << std::setw( 14) << static_cast< double >( f.after.major_faults - f.before.major_faults) / n
+       << std::setw( 14) << static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( f.creation).count() ) / n
+       << std::setw( 14) << static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( f.teardown).count() ) / n
+       << std::endl;
+    os.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        std::size_t fibers = 1024 * 1024;
+        std::size_t stack_size = 16 * 1024;
+        std::string filter;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("fibers,n", boost::program_options::value< std::size_t >( & fibers), "suspended fibers")
+            ("stack-size", boost::program_options::value< std::size_t >( & stack_size), "stack size in bytes")
+            ("touch", boost::program_options::value< std::size_t >( & touch), "bytes of stack touched by each fiber")
+            ("filter,f", boost::program_options::value< std::string >( & filter), "stack allocators containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        // leave room for the fiber record and the frames of suspended()
+        if ( touch + 2 * ctx::stack_traits::page_size() > stack_size) {
+            throw std::invalid_argument("--touch must be at least two pages smaller than --stack-size");
+        }
+#if ! defined(BOOST_CONTEXT_PROCESS_MEMORY)
+        std::cerr << "memory of the process not available on this platform" << std::endl;
+#endif
+
+        auto selected = [&filter]( char const* name) {
+            return std::string::npos != std::string{ name }.find( filter);
+        };
+        std::cout << fibers << " suspended fibers, " << stack_size << " bytes stack, "
+                  << touch << " bytes touched" << std::endl;
+        write_header( std::cout);
+        footprint result;
+        if ( selected("fixedsize_stack") &&
+             measure( "fixedsize_stack", ctx::fixedsize_stack{ stack_size }, fibers, result) ) {
+            write_row( std::cout, result);
+        }
+        if ( selected("protected_fixedsize_stack") ) {
+            if ( fibers > max_protected_stacks() ) {
+                std::cerr << "protected_fixedsize_stack: " << fibers << " fibers exceed vm.max_map_count" << std::endl;
+            } else if ( measure( "protected_fixedsize_stack", ctx::protected_fixedsize_stack{ stack_size }, fibers, result) ) {
+                write_row( std::cout, result);
+            }
+        }
+        if ( selected("pooled_fixedsize_stack") ) {
+            // the pool releases its memory with the allocator
+            if ( measure( "pooled_fixedsize_stack", ctx::pooled_fixedsize_stack{ stack_size }, fibers, result) ) {
+                write_row( std::cout, result);
+            }
+        }
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+        if ( selected("segmented_stack") &&
+             measure( "segmented_stack", ctx::segmented_stack{ stack_size }, fibers, result) ) {
+            write_row( std::cout, result);
+        }
+#endif
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
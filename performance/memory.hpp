@@ -0,0 +1,77 @@
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/predef.h>
+
+#if BOOST_OS_LINUX
+# define BOOST_CONTEXT_PROCESS_MEMORY
+extern "C" {
+# include <sys/resource.h>
+# include <unistd.h>
+}
+#endif
+
+// memory of the process, read from /proc (Linux); zero if not available
+struct process_memory {
+    // resident set size in bytes
+    boost::uint64_t     resident{ 0 };
+    // number of memory mappings (VMAs)
+    boost::uint64_t     mappings{ 0 };
+    boost::uint64_t     minor_faults{ 0 };
+    boost::uint64_t     major_faults{ 0 };
+};
+
+inline
+process_memory memory_of_process() {
+    process_memory m;
+#if defined(BOOST_CONTEXT_PROCESS_MEMORY)
+    {
+        // size and resident pages
+        std::ifstream is{ "/proc/self/statm" };
+        boost::uint64_t size = 0, resident = 0;
+        if ( is >> size >> resident) {
+            m.resident = resident * static_cast< boost::uint64_t >( ::sysconf( _SC_PAGESIZE) );
+        }
+    }
+    {
+        std::ifstream is{ "/proc/self/maps" };
+        std::string line;
+        while ( std::getline( is, line) ) {
+            ++m.mappings;
+        }
+    }
+    rusage usage;
+    if ( 0 == ::getrusage( RUSAGE_SELF, & usage) ) {
+        m.minor_faults = static_cast< boost::uint64_t >( usage.ru_minflt);
+        m.major_faults = static_cast< boost::uint64_t >( usage.ru_majflt);
+    }
+#endif
+    return m;
+}
+
+// each protected stack takes two memory mappings (guard page, stack);
+// mprotect() fails beyond vm.max_map_count
+inline
+std::size_t max_protected_stacks() {
+    std::ifstream is{ "/proc/sys/vm/max_map_count" };
+    std::size_t count = 0;
+    if ( is >> count) {
+        // keep some mappings for the program itself
+        return count / 2 - (std::min)( count / 2, std::size_t( 1024) );
+    }
+    return (std::numeric_limits< std::size_t >::max)();
+}
+
+#endif // MEMORY_H
@@ -0,0 +1,284 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// cost of resuming a fiber on another CPU than the one it last ran on:
+// two pinned threads hand a fiber back and forth (spinning, no wake-up),
+// the fiber touches `--touch` bytes of hot data on its stack per resume
+// the switch cost is the same-CPU resume without touching; the transfer
+// cost of the hot lines is the difference to the same-CPU resume with
+// the same amount touched
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+extern "C" {
+#include <sched.h>
+}
+
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+// largest amount of hot data on the stack of the fiber
+constexpr std::size_t max_touch = 64 * 1024;
+constexpr std::size_t cache_line = 64;
+
+// CPU topology from sysfs; -1 if not known
+struct cpu_topology {
+    int                 package{ -1 };
+    int                 core{ -1 };
+};
+
+int read_int( std::string const& path) {
+    std::ifstream is{ path };
+    int value = -1;
+    is >> value;
+    return value;
+}
+
+cpu_topology topology_of( int cpu) {
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string( cpu) + "/topology/";
+    cpu_topology t;
+    t.package = read_int( dir + "physical_package_id");
+    t.core = read_int( dir + "core_id");
+    return t;
+}
+
+bool pin( int cpu) {
+    cpu_set_t set;
+    CPU_ZERO( & set);
+    CPU_SET( cpu, & set);
+    // calling thread
+    return 0 == ::sched_setaffinity( 0, sizeof( set), & set);
+}
+
+// CPUs the process may run on
+std::vector< int > allowed_cpus() {
+    std::vector< int > cpus;
+    cpu_set_t set;
+    CPU_ZERO( & set);
+    if ( 0 == ::sched_getaffinity( 0, sizeof( set), & set) ) {
+        for ( int i = 0; i < CPU_SETSIZE; ++i) {
+            if ( CPU_ISSET( i, & set) ) {
+                cpus.push_back( i);
+            }
+        }
+    }
+    return cpus;
+}
+
+struct placement {
+    std::string         name;
+    int                 from;
+    int                 to;
+};
+
+// same CPU, SMT sibling, other core of the same package, other package
+std::vector< placement > placements( int first) {
+    std::vector< placement > result{ placement{ "same-cpu", first, first } };
+    cpu_topology t = topology_of( first);
+    int sibling = -1, same_package = -1, other_package = -1;
+    for ( int cpu : allowed_cpus() ) {
+        if ( cpu == first) {
+            continue;
+        }
+        cpu_topology u = topology_of( cpu);
+        if ( u.package == t.package && u.core == t.core) {
+            if ( -1 == sibling) {
+                sibling = cpu;
+            }
+        } else if ( u.package == t.package) {
+            if ( -1 == same_package) {
+                same_package = cpu;
+            }
+        } else if ( -1 == other_package) {
+            other_package = cpu;
+        }
+    }
+    if ( -1 != sibling) {
+        result.push_back( placement{ "smt-sibling", first, sibling });
+    }
+    if ( -1 != same_package) {
+        result.push_back( placement{ "same-socket", first, same_package });
+    }
+    if ( -1 != other_package) {
+        result.push_back( placement{ "cross-socket", first, other_package });
+    }
+    return result;
+}
+
+// touches `touch` bytes of its stack (one write per cache line) per resume
+ctx::fiber make_fiber( std::size_t touch) {
+    return ctx::fiber{ [touch]( ctx::fiber && f) {
+                volatile char hot[max_touch];
+                for (;;) {
+                    for ( std::size_t i = 0; i < touch; i += cache_line) {
+                        hot[i] = hot[i] + 1;
+                    }
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+}
+
+double nanoseconds( duration_type d) {
+    return static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() );
+}
+
+// ns per resume (switch to the fiber, touch, switch back)
+std::vector< double > same_cpu( int cpu, std::size_t touch, boost::uint64_t n, std::size_t warmup) {
+    std::vector< double > values;
+    values.reserve( n);
+    std::thread t{ [&values,cpu,touch,n,warmup](){
+                if ( ! pin( cpu) ) {
+                    std::cerr << "sched_setaffinity() failed for CPU " << cpu << std::endl;
+                }
+                ctx::fiber f = make_fiber( touch);
+                for ( boost::uint64_t i = 0; i < warmup + n; ++i) {
+                    time_point_type start( clock_type::now() );
+                    f = std::move( f).resume();
+                    duration_type d = clock_type::now() - start;
+                    if ( i >= warmup) {
+                        values.push_back( nanoseconds( d) );
+                    }
+                }
+            }};
+    t.join();
+    return values;
+}
+
+// the threads take turns; every resume happens on the other CPU than the last one
+std::vector< double > migrated( int from, int to, std::size_t touch, boost::uint64_t n, std::size_t warmup) {
+    ctx::fiber f = make_fiber( touch);
+    std::atomic< int > turn{ 0 };
+    std::vector< double > values[2];
+    auto run = [&f,&turn,&values,n,warmup]( int id, int cpu) {
+        if ( ! pin( cpu) ) {
+            std::cerr << "sched_setaffinity() failed for CPU " << cpu << std::endl;
+        }
+        values[id].reserve( n);
+        for ( boost::uint64_t i = 0; i < warmup + n; ++i) {
+            while ( id != turn.load( std::memory_order_acquire) ) {
+            }
+            time_point_type start( clock_type::now() );
+            f = std::move( f).resume();
+            duration_type d = clock_type::now() - start;
+            if ( i >= warmup) {
+                values[id].push_back( nanoseconds( d) );
+            }
+            turn.store( 1 - id, std::memory_order_release);
+        }
+    };
+    std::thread a{ run, 0, from };
+    std::thread b{ run, 1, to };
+    a.join();
+    b.join();
+    values[0].insert( values[0].end(), values[1].begin(), values[1].end() );
+    return values[0];
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        boost::uint64_t jobs = 100000;
+        std::size_t warmup = 1000;
+        std::vector< std::size_t > touches{ 0, 4096, 16384 };
+        int first = -1;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & jobs), "resumes per thread and measurement")
+            ("warmup,w", boost::program_options::value< std::size_t >( & warmup), "resumes not measured")
+            ("touch", boost::program_options::value< std::vector< std::size_t > >( & touches)->multitoken(), "bytes of hot stack data touched per resume")
+            ("cpu", boost::program_options::value< int >( & first), "CPU the fiber starts on (default: first allowed)");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        for ( std::size_t touch : touches) {
+            if ( touch > max_touch) {
+                throw std::invalid_argument("--touch is limited to " + std::to_string( max_touch) + " bytes");
+            }
+        }
+        if ( -1 == first) {
+            std::vector< int > cpus = allowed_cpus();
+            if ( cpus.empty() ) {
+                throw std::runtime_error("sched_getaffinity() failed");
+            }
+            first = cpus.front();
+        }
+
+        std::vector< placement > places = placements( first);
+        std::cout << "ns per resume (switch to the fiber, touch, switch back), clock overhead included" << std::endl;
+        std::cout << std::left << std::setw( 14) << "placement" << std::right << std::setw( 10) << "CPUs"
+                  << std::setw( 8) << "touch" << std::setw( 12) << "median" << std::setw( 12) << "p99"
+                  << std::setw( 12) << "MAD" << std::setw( 12) << "transfer" << std::endl;
+        // median of the same-CPU resume per touch
+        std::map< std::size_t, double > local;
+        for ( placement const& p : places) {
+            for ( std::size_t touch : touches) {
+                std::vector< double > values = p.from == p.to
+                    ? same_cpu( p.from, touch, jobs, warmup)
+                    : migrated( p.from, p.to, touch, jobs, warmup);
+                benchmark_summary s = summarize( p.name, std::move( values), jobs);
+                if ( p.from == p.to) {
+                    local[touch] = s.median;
+                }
+                std::cout << std::fixed << std::setprecision( 1)
+                          << std::left << std::setw( 14) << p.name << std::right
+                          << std::setw( 10) << ( std::to_string( p.from) + "->" + std::to_string( p.to) )
+                          << std::setw( 8) << touch << std::setw( 12) << s.median << std::setw( 12) << s.p99
+                          << std::setw( 12) << s.mad << std::setw( 12) << s.median - local[touch] << std::endl;
+                std::cout.unsetf( std::ios_base::floatfield);
+            }
+        }
+        if ( 1 == places.size() ) {
+            std::cerr << "no other CPU available to migrate to" << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
+
+#else
+
+int main() {
+    std::cerr << "the migration benchmark requires sched_setaffinity() (Linux)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,252 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// lookups in a read-mostly routing table replaced by a writer thread:
+// std::atomic_load() of a std::shared_ptr per lookup against a plain load
+// protected by quiescent-state-based reclamation (fiber switches)
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/context/fiber_qsbr.hpp>
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+struct settings {
+    benchmark_options   options;
+    std::size_t         threads{ (std::max)( std::thread::hardware_concurrency(), 1u) };
+    // lookups between two context switches
+    std::size_t         batch{ 64 };
+    std::size_t         routes{ 4096 };
+    // microseconds between two replacements of the table
+    std::size_t         period{ 100 };
+};
+
+struct table {
+    std::vector< boost::uint32_t >  routes;
+
+    table( std::size_t n, boost::uint32_t version) :
+        routes( n) {
+        for ( std::size_t i = 0; i < n; ++i) {
+            routes[i] = static_cast< boost::uint32_t >( i) ^ version;
+        }
+    }
+};
+
+std::atomic< std::size_t > tables_deleted{ 0 };
+volatile boost::uint32_t sink = 0;
+
+void delete_table( void * vp) {
+    delete static_cast< table * >( vp);
+    ++tables_deleted;
+}
+
+// shared_ptr: every lookup pins the table
+struct shared_table {
+    std::shared_ptr< table >        current;
+
+    void publish( std::shared_ptr< table > t) {
+        std::atomic_store_explicit( & current, std::move( t), std::memory_order_release);
+    }
+
+    boost::uint32_t lookup( boost::uint32_t key) const {
+        std::shared_ptr< table > t = std::atomic_load_explicit( & current, std::memory_order_acquire);
+        return t->routes[key % t->routes.size()];
+    }
+};
+
+// QSBR: the table is not deleted before every reader has switched
+struct qsbr_table {
+    std::atomic< table * >          current{ nullptr };
+
+    ~qsbr_table() {
+        delete current.load();
+    }
+
+    void publish( table * t) {
+        table * old = current.exchange( t, std::memory_order_acq_rel);
+        if ( nullptr != old) {
+            ctx::fiber_retire( old, delete_table);
+        }
+    }
+
+    boost::uint32_t lookup( boost::uint32_t key) const {
+        table const* t = current.load( std::memory_order_acquire);
+        return t->routes[key % t->routes.size()];
+    }
+};
+
+struct result {
+    // mean of the readers
+    double              lookup_ns{ 0 };
+    std::size_t         replaced{ 0 };
+    // tables retired but not yet deleted, sampled by the writer
+    std::size_t         max_pending{ 0 };
+};
+
+// each reader runs a fiber performing `batch` lookups per resume
+template< typename Table >
+double read( Table const& t, settings const& s, boost::uint64_t n) {
+    boost::uint32_t sum = 0;
+    boost::uint32_t key = 0;
+    ctx::fiber f{
+        [&t,&s,&sum,&key]( ctx::fiber && f) {
+            while ( true) {
+                for ( std::size_t i = 0; i < s.batch; ++i) {
+                    sum += t.lookup( key);
+                    key += 2654435761u;
+                }
+                f = std::move( f).resume();
+            }
+            return std::move( f);
+        }};
+    boost::uint64_t switches = (std::max)( n / s.batch, boost::uint64_t( 1) );
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < switches; ++i) {
+        f = std::move( f).resume();
+    }
+    duration_type d = clock_type::now() - start;
+    sink = sum;
+    return static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) /
+           ( switches * s.batch);
+}
+
+template< typename Table, typename Publish >
+result run( Table & t, Publish publish, settings const& s, boost::uint64_t n) {
+    result r;
+    std::vector< double > ns( s.threads);
+    std::vector< std::thread > readers;
+    std::atomic< std::size_t > done{ 0 };
+    for ( std::size_t i = 0; i < s.threads; ++i) {
+        readers.emplace_back( [&t,&s,&ns,&done,n,i](){
+                    ns[i] = read( t, s, n);
+                    ++done;
+                });
+    }
+    std::size_t retired = 0;
+    std::size_t deleted = tables_deleted.load();
+    while ( s.threads != done.load() ) {
+        std::this_thread::sleep_for( std::chrono::microseconds( s.period) );
+        retired += publish( static_cast< boost::uint32_t >( ++r.replaced) );
+        r.max_pending = (std::max)( r.max_pending, retired - ( tables_deleted.load() - deleted) );
+    }
+    for ( std::thread & reader : readers) {
+        reader.join();
+    }
+    double sum = 0;
+    for ( double v : ns) {
+        sum += v;
+    }
+    r.lookup_ns = sum / s.threads;
+    return r;
+}
+
+void print( std::string const& name, result const& r) {
+    std::cout << std::fixed << std::setprecision( 2)
+              << std::left << std::setw( 14) << name << std::right
+              << std::setw( 12) << r.lookup_ns << std::setw( 10) << r.replaced
+              << std::setw( 10) << r.max_pending << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & s.options.jobs), "lookups per reader")
+            ("threads", boost::program_options::value< std::size_t >( & s.threads), "reader threads")
+            ("batch", boost::program_options::value< std::size_t >( & s.batch), "lookups between two context switches")
+            ("routes", boost::program_options::value< std::size_t >( & s.routes), "entries of the table")
+            ("period", boost::program_options::value< std::size_t >( & s.period), "microseconds between two replacements")
+            ("filter,f", boost::program_options::value< std::string >( & s.options.filter), "variants containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == s.threads || 0 == s.batch || 0 == s.routes) {
+            throw std::invalid_argument("--threads, --batch and --routes must be positive");
+        }
+        if ( ! ctx::start_fiber_qsbr() ) {
+            throw std::runtime_error("no hook table could be installed");
+        }
+
+        std::cout << s.threads << " readers, " << s.batch << " lookups per switch, table replaced every "
+                  << s.period << " us" << std::endl;
+        std::cout << std::left << std::setw( 14) << "variant" << std::right
+                  << std::setw( 12) << "lookup ns" << std::setw( 10) << "replaced"
+                  << std::setw( 10) << "pending" << std::endl;
+        if ( std::string::npos != std::string{ "shared_ptr" }.find( s.options.filter) ) {
+            shared_table t;
+            t.publish( std::make_shared< table >( s.routes, 0) );
+            print( "shared_ptr", run( t,
+                    [&t,&s]( boost::uint32_t version) {
+                        t.publish( std::make_shared< table >( s.routes, version) );
+                        return std::size_t( 0);
+                    }, s, s.options.jobs) );
+        }
+        if ( std::string::npos != std::string{ "qsbr" }.find( s.options.filter) ) {
+            qsbr_table t;
+            t.publish( new table{ s.routes, 0 });
+            print( "qsbr", run( t,
+                    [&t,&s]( boost::uint32_t version) {
+                        t.publish( new table{ s.routes, version });
+                        // the writer does not switch, it stays offline
+                        ctx::fiber_qsbr_reclaim();
+                        return std::size_t( 1);
+                    }, s, s.options.jobs) );
+            // the readers have terminated
+            ctx::fiber_qsbr_reclaim();
+        }
+        ctx::stop_fiber_qsbr();
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
+
+#else
+
+int main() {
+    std::cerr << "fiber hooks are disabled (fiber-hooks=on)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,298 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// switches round-robin through rings of N fibers (see example/fiber/circle.cpp)
+// to measure the context switch once the stacks no longer fit into the caches
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+#include <boost/context/segmented_stack.hpp>
+#endif
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../benchmark.hpp"
+#include "../memory.hpp"
+
+namespace ctx = boost::context;
+
+// fiber i resumes fiber i+1, the last one resumes the first one;
+// slot `n` holds the main context
+class ring {
+private:
+    std::vector< ctx::fiber >   slots_;
+    std::size_t                 n_;
+    // index of the context that resumed the running fiber
+    std::size_t                 from_;
+    std::size_t                 cursor_{ 0 };
+    boost::uint64_t             remaining_{ 0 };
+
+    ctx::fiber activate( std::size_t i, ctx::fiber && f) {
+        for (;;) {
+            slots_[from_] = std::move( f);
+            std::size_t next = 0 == --remaining_ ? n_ : ( i + 1) % n_;
+            from_ = i;
+            f = std::move( slots_[next]).resume();
+        }
+        return ctx::fiber{};
+    }
+
+public:
+    template< typename StackAlloc >
+    ring( std::size_t n, StackAlloc salloc) :
+        slots_( n + 1),
+        n_{ 0 },
+        from_{ n } {
+        try {
+            for ( ; n_ < n; ++n_) {
+                std::size_t i = n_;
+                slots_[i] = ctx::fiber{ std::allocator_arg, salloc,
+                    [this,i]( ctx::fiber && f) {
+                        return activate( i, std::move( f) );
+                    }};
+            }
+        } catch (...) {
+            // fibers that never ran can not be destroyed with every backend
+            if ( 0 < n_) {
+                run( n_);
+            }
+            throw;
+        }
+        // starts the fibers
+        run( n_);
+    }
+
+    ring( ring const&) = delete;
+    ring & operator=( ring const&) = delete;
+
+    // `switches` activations, continuing where the last call stopped
+    void run( boost::uint64_t switches) {
+        remaining_ = switches;
+        from_ = n_;
+        ctx::fiber f = std::move( slots_[cursor_]).resume();
+        slots_[from_] = std::move( f);
+        cursor_ = ( from_ + 1) % n_;
+    }
+};
+
+struct ring_result {
+    std::string         allocator;
+    std::size_t         fibers;
+    benchmark_summary   summary;
+};
+
+void write_header( std::ostream & os, bool counters) {
+    os << std::left << std::setw( 26) << "allocator" << std::right << std::setw( 9) << "fibers"
+       << std::setw( 12) << "median ns" << std::setw( 12) << "p99 ns" << std::setw( 12) << "MAD ns";
+    if ( counters) {
+        for ( std::size_t j = perf_l1d_misses; j < perf_event_count; ++j) {
+            os << std::setw( 14) << perf_event_name( j);
+        }
+    }
+    os << std::endl;
+}
+
+void write_row( std::ostream & os, ring_result const& r) {
+    os << std::fixed << std::setprecision( 2)
+       << std::left << std::setw( 26) << r.allocator << std::right << std::setw( 9) << r.fibers
+       << std::setw( 12) << r.summary.median << std::setw( 12) << r.summary.p99
+       << std::setw( 12) << r.summary.mad;
+    if ( r.summary.has_events) {
+        for ( std::size_t j = perf_l1d_misses; j < perf_event_count; ++j) {
+            os << std::setw( 14) << r.summary.events[j];
+        }
+    }
+    os << std::endl;
+    os.unsetf( std::ios_base::floatfield);
+}
+
+template< typename StackAlloc >
+bool measure( std::string const& name, StackAlloc salloc, std::size_t n,
+              benchmark_options const& options, perf_counters const* counters,
+              std::vector< ring_result > & results) {
+    std::unique_ptr< ring > r;
+    try {
+        r.reset( new ring{ n, salloc } );
+    } catch ( std::bad_alloc const&) {
+        std::cerr << name << ": unable to allocate " << n << " fibers" << std::endl;
+        return false;
+    }
+    // every fiber runs at least once per trial
+    boost::uint64_t rounds = (std::max)( options.jobs / n, boost::uint64_t( 1) );
+    boost::uint64_t switches = rounds * n;
+    for ( std::size_t i = 0; i < options.warmup; ++i) {
+        r->run( n);
+    }
+    std::vector< double > values;
+    std::vector< double > events[perf_event_count];
+    for ( std::size_t i = 0; i < (std::max)( options.trials, std::size_t( 1) ); ++i) {
+        perf_sample before{};
+        if ( nullptr != counters) {
+            before = counters->read();
+        }
+        time_point_type start( clock_type::now() );
+        r->run( switches);
+        duration_type d = clock_type::now() - start;
+        if ( nullptr != counters) {
+            perf_sample after = counters->read();
+            for ( std::size_t j = 0; j < perf_event_count; ++j) {
+                events[j].push_back( static_cast< double >( after.values[j] - before.values[j]) / switches);
+            }
+        }
+        values.push_back(
+                static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) / switches);
+    }
+    ring_result result{ name, n, summarize( name, std::move( values), switches) };
+    if ( nullptr != counters) {
+        result.summary.has_events = true;
+        for ( std::size_t j = 0; j < perf_event_count; ++j) {
+            std::sort( events[j].begin(), events[j].end() );
+            result.summary.events[j] = median_of( events[j]);
+        }
+    }
+    write_row( std::cout, result);
+    results.push_back( std::move( result) );
+    return true;
+}
+
+// one line per ring, for plotting the columns against `fibers`
+void write_csv( std::ostream & os, std::vector< ring_result > const& results) {
+    os << "allocator,fibers,median,p99,mad";
+    for ( std::size_t j = 0; j < perf_event_count; ++j) {
+        os << ',' << perf_event_key( j);
+    }
+    os << '\n';
+    for ( ring_result const& r : results) {
+        os << r.allocator << ',' << r.fibers << ',' << r.summary.median << ','
+           << r.summary.p99 << ',' << r.summary.mad;
+        for ( std::size_t j = 0; j < perf_event_count; ++j) {
+            os << ',';
+            if ( r.summary.has_events) {
+                os << r.summary.events[j];
+            }
+        }
+        os << '\n';
+    }
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        benchmark_options options;
+        options.jobs = 1000000;
+        options.warmup = 1;
+        options.trials = 11;
+        std::size_t min_fibers = 2;
+        std::size_t max_fibers = 1024 * 1024;
+        std::size_t factor = 2;
+        std::size_t stack_size = 16 * 1024;
+        std::string csv;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & options.jobs), "minimum switches per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & options.trials), "measured trials")
+            ("warmup,w", boost::program_options::value< std::size_t >( & options.warmup), "warm-up rounds through the ring")
+            ("filter,f", boost::program_options::value< std::string >( & options.filter), "stack allocators containing this string")
+            ("min", boost::program_options::value< std::size_t >( & min_fibers), "smallest ring")
+            ("max", boost::program_options::value< std::size_t >( & max_fibers), "largest ring")
+            ("factor", boost::program_options::value< std::size_t >( & factor), "growth of the ring")
+            ("stack-size", boost::program_options::value< std::size_t >( & stack_size), "stack size in bytes")
+            ("counters", "count cache and TLB misses per switch (perf_event_open)")
+            ("csv", boost::program_options::value< std::string >( & csv), "write the results as CSV to this file");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 2 > min_fibers || 2 > factor) {
+            throw std::invalid_argument("--min and --factor must be at least 2");
+        }
+
+        std::unique_ptr< perf_counters > counters;
+        if ( vm.count("counters") ) {
+            counters.reset( new perf_counters{} );
+            if ( ! counters->valid() ) {
+                std::cerr << "hardware counters not available" << std::endl;
+                counters.reset();
+            }
+        }
+        auto selected = [&options]( char const* name) {
+            return std::string::npos != std::string{ name }.find( options.filter);
+        };
+
+        std::vector< ring_result > results;
+        write_header( std::cout, !! counters);
+        bool fixedsize = selected("fixedsize_stack");
+        bool protected_fixedsize = selected("protected_fixedsize_stack");
+        bool pooled_fixedsize = selected("pooled_fixedsize_stack");
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+        bool segmented = selected("segmented_stack");
+#endif
+        // an allocator is dropped from the sweep once it fails
+        for ( std::size_t n = min_fibers; n <= max_fibers; n *= factor) {
+            if ( fixedsize) {
+                fixedsize = measure( "fixedsize_stack", ctx::fixedsize_stack{ stack_size },
+                                     n, options, counters.get(), results);
+            }
+            if ( protected_fixedsize && n > max_protected_stacks() ) {
+                std::cerr << "protected_fixedsize_stack: " << n << " fibers exceed vm.max_map_count" << std::endl;
+                protected_fixedsize = false;
+            }
+            if ( protected_fixedsize) {
+                protected_fixedsize = measure( "protected_fixedsize_stack", ctx::protected_fixedsize_stack{ stack_size },
+                                               n, options, counters.get(), results);
+            }
+            if ( pooled_fixedsize) {
+                pooled_fixedsize = measure( "pooled_fixedsize_stack", ctx::pooled_fixedsize_stack{ stack_size },
+                                            n, options, counters.get(), results);
+            }
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+            if ( segmented) {
+                segmented = measure( "segmented_stack", ctx::segmented_stack{ stack_size },
+                                     n, options, counters.get(), results);
+            }
+#endif
+        }
+
+        if ( ! csv.empty() ) {
+            std::ofstream os{ csv };
+            write_csv( os, results);
+            if ( ! os) {
+                throw std::runtime_error("unable to write " + csv);
+            }
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
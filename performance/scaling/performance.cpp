@@ -0,0 +1,248 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// independent ping-pong pairs and spawn/destroy loops on 1..N threads at
+// once; the per-thread throughput drops if the threads contend for the
+// stack allocator (malloc arenas, mmap_sem) or share cache lines
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/context/percpu_fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+#include <boost/context/segmented_stack.hpp>
+#endif
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+ctx::fiber loop( ctx::fiber && f) {
+    while ( true) {
+        f = std::move( f).resume();
+    }
+    return ctx::fiber{};
+}
+
+template< typename StackAlloc >
+duration_type ping_pong( StackAlloc salloc, boost::uint64_t n) {
+    ctx::fiber f{ std::allocator_arg, salloc, loop };
+    f = std::move( f).resume();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+template< typename StackAlloc >
+duration_type spawn( StackAlloc salloc, boost::uint64_t n) {
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        ctx::fiber f{ std::allocator_arg, salloc,
+            []( ctx::fiber && f) {
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+    }
+    return clock_type::now() - start;
+}
+
+// runs n iterations on the calling thread, constructing its own allocator
+// (boost::pool behind pooled_fixedsize_stack is not synchronized) or
+// copying a shared one
+typedef std::function< duration_type( boost::uint64_t) >    workload_fn;
+
+struct workload {
+    std::string         name;
+    workload_fn         fn;
+    // iterations per thread = jobs / divisor
+    boost::uint64_t     divisor;
+};
+
+template< typename StackAlloc >
+void add_workloads( std::vector< workload > & workloads, std::string const& name, std::size_t stack_size) {
+    workloads.push_back( workload{ "resume/" + name,
+            [stack_size]( boost::uint64_t n) { return ping_pong( StackAlloc{ stack_size }, n); }, 1 });
+    workloads.push_back( workload{ "spawn/" + name,
+            [stack_size]( boost::uint64_t n) { return spawn( StackAlloc{ stack_size }, n); }, 10 });
+}
+
+template< typename StackAlloc >
+void add_shared_workloads( std::vector< workload > & workloads, std::string const& name, std::size_t stack_size) {
+    StackAlloc salloc{ stack_size };
+    workloads.push_back( workload{ "resume/shared " + name,
+            [salloc]( boost::uint64_t n) { return ping_pong( salloc, n); }, 1 });
+    workloads.push_back( workload{ "spawn/shared " + name,
+            [salloc]( boost::uint64_t n) { return spawn( salloc, n); }, 10 });
+}
+
+// throughput in million iterations per second
+struct scaling {
+    // mean of the threads
+    double              per_thread{ 0 };
+    double              slowest{ 0 };
+    double              total{ 0 };
+};
+
+double throughput( boost::uint64_t n, duration_type d) {
+    double ns = static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() );
+    return 0 < ns ? static_cast< double >( n) * 1e3 / ns : 0.0;
+}
+
+// one trial: all threads start together
+scaling run_threads( workload const& w, std::size_t threads, boost::uint64_t n) {
+    std::vector< duration_type > durations( threads);
+    std::vector< std::thread > pool;
+    std::atomic< std::size_t > ready{ 0 };
+    std::atomic< bool > go{ false };
+    for ( std::size_t i = 0; i < threads; ++i) {
+        pool.emplace_back( [&w,&durations,&ready,&go,n,i](){
+                    // warm-up
+                    w.fn( (std::max)( n / 10, boost::uint64_t( 1) ) );
+                    ++ready;
+                    while ( ! go.load( std::memory_order_acquire) ) {
+                        std::this_thread::yield();
+                    }
+                    durations[i] = w.fn( n);
+                });
+    }
+    while ( threads != ready.load() ) {
+        std::this_thread::yield();
+    }
+    go.store( true, std::memory_order_release);
+    for ( std::thread & t : pool) {
+        t.join();
+    }
+    scaling s;
+    s.slowest = throughput( n, durations[0]);
+    for ( duration_type d : durations) {
+        double t = throughput( n, d);
+        s.total += t;
+        s.slowest = (std::min)( s.slowest, t);
+    }
+    s.per_thread = s.total / threads;
+    return s;
+}
+
+// median of the trials
+scaling measure( workload const& w, std::size_t threads, boost::uint64_t n, std::size_t trials) {
+    std::vector< double > per_thread, slowest, total;
+    for ( std::size_t i = 0; i < (std::max)( trials, std::size_t( 1) ); ++i) {
+        scaling s = run_threads( w, threads, n);
+        per_thread.push_back( s.per_thread);
+        slowest.push_back( s.slowest);
+        total.push_back( s.total);
+    }
+    std::sort( per_thread.begin(), per_thread.end() );
+    std::sort( slowest.begin(), slowest.end() );
+    std::sort( total.begin(), total.end() );
+    scaling s;
+    s.per_thread = median_of( per_thread);
+    s.slowest = median_of( slowest);
+    s.total = median_of( total);
+    return s;
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        benchmark_options options;
+        options.trials = 5;
+        std::size_t max_threads = (std::max)( std::thread::hardware_concurrency(), 1u);
+        std::size_t stack_size = ctx::stack_traits::default_size();
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & options.jobs), "iterations per thread and trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & options.trials), "measured trials")
+            ("threads", boost::program_options::value< std::size_t >( & max_threads), "largest number of threads")
+            ("stack-size", boost::program_options::value< std::size_t >( & stack_size), "stack size in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & options.filter), "workloads containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( 0 == max_threads) {
+            throw std::invalid_argument("--threads must be at least 1");
+        }
+        if ( max_threads > std::thread::hardware_concurrency() ) {
+            std::cerr << "more threads than hardware threads: the threads are time-sliced" << std::endl;
+        }
+
+        std::vector< workload > workloads;
+        add_workloads< ctx::fixedsize_stack >( workloads, "fixedsize_stack", stack_size);
+        add_workloads< ctx::protected_fixedsize_stack >( workloads, "protected_fixedsize_stack", stack_size);
+        add_workloads< ctx::pooled_fixedsize_stack >( workloads, "pooled_fixedsize_stack", stack_size);
+        add_shared_workloads< ctx::percpu_fixedsize_stack >( workloads, "percpu_fixedsize_stack", stack_size);
+#if defined(BOOST_USE_SEGMENTED_STACKS)
+        add_workloads< ctx::segmented_stack >( workloads, "segmented_stack", stack_size);
+#endif
+        // 1, 2, 4, ... threads and the largest number
+        std::vector< std::size_t > counts;
+        for ( std::size_t t = 1; t < max_threads; t *= 2) {
+            counts.push_back( t);
+        }
+        counts.push_back( max_threads);
+
+        std::cout << std::left << std::setw( 40) << "workload" << std::right << std::setw( 8) << "threads"
+                  << std::setw( 14) << "Mops/thread" << std::setw( 14) << "slowest" << std::setw( 14) << "Mops total"
+                  << std::setw( 12) << "efficiency" << std::endl;
+        for ( workload const& w : workloads) {
+            if ( std::string::npos == w.name.find( options.filter) ) {
+                continue;
+            }
+            boost::uint64_t n = (std::max)( options.jobs / w.divisor, boost::uint64_t( 1) );
+            double single = 0;
+            for ( std::size_t threads : counts) {
+                scaling s = measure( w, threads, n, options.trials);
+                if ( 1 == threads) {
+                    single = s.per_thread;
+                }
+                // per-thread throughput relative to one thread
+                std::cout << std::fixed << std::setprecision( 2)
+                          << std::left << std::setw( 40) << w.name << std::right << std::setw( 8) << threads
+                          << std::setw( 14) << s.per_thread << std::setw( 14) << s.slowest
+                          << std::setw( 14) << s.total
+                          << std::setw( 11) << ( 0 < single ? 100 * s.per_thread / single : 0.0) << '%'
+                          << std::endl;
+                std::cout.unsetf( std::ios_base::floatfield);
+            }
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,65 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/context/continuation.hpp>
+#include <boost/cstdint.hpp>
+
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+namespace {
+
+ctx::continuation loop( ctx::continuation && c) {
+    while ( true) {
+        c = c.resume();
+    }
+    return std::move( c);
+}
+
+duration_type resume( boost::uint64_t n) {
+    ctx::continuation c = ctx::callcc( loop);
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        c = c.resume();
+    }
+    return clock_type::now() - start;
+}
+
+duration_type resume_with( boost::uint64_t n) {
+    ctx::continuation c = ctx::callcc( loop);
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        c = c.resume_with(
+                []( ctx::continuation && c) {
+                    return std::move( c);
+                });
+    }
+    return clock_type::now() - start;
+}
+
+// creation, entry, termination and deallocation
+duration_type callcc( boost::uint64_t n) {
+    ctx::fixedsize_stack salloc;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        ctx::callcc( std::allocator_arg, salloc,
+            []( ctx::continuation && c) {
+                return std::move( c);
+            });
+    }
+    return clock_type::now() - start;
+}
+
+// context switches per iteration: 2
+register_benchmark resume_benchmark{ "callcc/resume", resume, 2 };
+register_benchmark resume_with_benchmark{ "callcc/resume_with", resume_with, 2 };
+register_benchmark callcc_benchmark{ "callcc/create/fixedsize_stack", callcc, 1, 10 };
+
+}
@@ -0,0 +1,75 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// raw fcontext_t, not available with ucontext and WinFiber
+#if ! defined(BOOST_USE_UCONTEXT) && ! defined(BOOST_USE_WINFIB)
+
+#include <cstddef>
+
+#include <boost/context/detail/fcontext.hpp>
+#include <boost/context/fixedsize_stack.hpp>
+#include <boost/cstdint.hpp>
+
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+namespace {
+
+void loop( ctx::detail::transfer_t t) {
+    while ( true) {
+        t = ctx::detail::jump_fcontext( t.fctx, nullptr);
+    }
+}
+
+ctx::detail::transfer_t identity( ctx::detail::transfer_t t) {
+    return t;
+}
+
+// keeps a context running loop() for the lifetime of the benchmark
+struct looping_context {
+    ctx::fixedsize_stack        salloc{};
+    ctx::stack_context          sctx;
+    ctx::detail::fcontext_t     fctx;
+
+    looping_context() :
+        sctx( salloc.allocate() ),
+        fctx( ctx::detail::make_fcontext( sctx.sp, sctx.size, loop) ) {
+        // enter loop()
+        fctx = ctx::detail::jump_fcontext( fctx, nullptr).fctx;
+    }
+
+    ~looping_context() {
+        // the stack of loop() holds nothing to be destroyed
+        salloc.deallocate( sctx);
+    }
+};
+
+duration_type jump( boost::uint64_t n) {
+    looping_context c;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        c.fctx = ctx::detail::jump_fcontext( c.fctx, nullptr).fctx;
+    }
+    return clock_type::now() - start;
+}
+
+duration_type ontop( boost::uint64_t n) {
+    looping_context c;
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        c.fctx = ctx::detail::ontop_fcontext( c.fctx, nullptr, identity).fctx;
+    }
+    return clock_type::now() - start;
+}
+
+// context switches per iteration: 2
+register_benchmark jump_benchmark{ "fcontext/jump", jump, 2 };
+register_benchmark ontop_benchmark{ "fcontext/ontop", ontop, 2 };
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <boost/config.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../benchmark.hpp"
+
+// benchmarks register themselves (callcc.cpp, fcontext.cpp, fiber.cpp)
+
+char const* backend() {
+#if defined(BOOST_USE_UCONTEXT)
+    return "ucontext";
+#elif defined(BOOST_USE_WINFIB)
+    return "winfib";
+#else
+    return "fcontext";
+#endif
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        benchmark_options options;
+        std::string json;
+        std::string baseline;
+        double threshold = 5;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & options.jobs), "iterations per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & options.trials), "measured trials")
+            ("warmup,w", boost::program_options::value< std::size_t >( & options.warmup), "warm-up trials")
+            ("filter,f", boost::program_options::value< std::string >( & options.filter), "run benchmarks containing this string")
+            ("counters", "count hardware events per operation (perf_event_open)")
+            ("list", "list the benchmarks")
+            ("json", boost::program_options::value< std::string >( & json), "write the results as JSON to this file")
+            ("baseline", boost::program_options::value< std::string >( & baseline), "compare against a JSON file written by --json")
+            ("threshold", boost::program_options::value< double >( & threshold), "relative slowdown (percent) reported as regression");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( vm.count("list") ) {
+            for ( benchmark const& b : benchmarks() ) {
+                std::cout << b.name << std::endl;
+            }
+            return EXIT_SUCCESS;
+        }
+
+        options.counters = 0 < vm.count("counters");
+        if ( options.counters && ! perf_counters{}.valid() ) {
+            std::cerr << "hardware counters not available" << std::endl;
+        }
+        std::vector< benchmark_summary > summaries = run_benchmarks( options);
+        std::cout << "backend " << backend() << ", " << options.trials << " trials of "
+                  << options.jobs << " iterations (" << options.warmup << " warm-up)" << std::endl;
+        write_table( std::cout, summaries);
+        if ( ! json.empty() ) {
+            std::map< std::string, std::string > context;
+            context["backend"] = backend();
+            context["compiler"] = BOOST_COMPILER;
+            context["platform"] = BOOST_PLATFORM;
+            std::ofstream os{ json };
+            write_json( os, summaries, context);
+            if ( ! os) {
+                throw std::runtime_error("unable to write " + json);
+            }
+        }
+        if ( ! baseline.empty() ) {
+            std::ifstream is{ baseline };
+            if ( ! is) {
+                throw std::runtime_error("unable to read " + baseline);
+            }
+            std::cout << std::endl;
+            std::size_t regressions = compare_baseline( std::cout, summaries, read_baseline( is), threshold / 100);
+            if ( 0 != regressions) {
+                std::cout << regressions << " regression(s)" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
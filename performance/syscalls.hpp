@@ -0,0 +1,56 @@
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SYSCALLS_H
+#define SYSCALLS_H
+
+// counts the calls of mmap(), munmap() and mprotect() by the program
+// (64-bit Linux with glibc); the functions are replaced by wrappers issuing the
+// system calls directly, calls inside the C library (e.g. of malloc) are
+// not seen
+// must be included by exactly one translation unit of a benchmark
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__linux__) && defined(__GLIBC__) && defined(__LP64__)
+# define BOOST_CONTEXT_COUNT_SYSCALLS
+extern "C" {
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/types.h>
+# include <unistd.h>
+}
+#endif
+
+std::atomic< std::size_t > syscall_count{ 0 };
+
+inline
+std::size_t syscalls() noexcept {
+    return syscall_count.load( std::memory_order_relaxed);
+}
+
+#if defined(BOOST_CONTEXT_COUNT_SYSCALLS)
+extern "C" {
+
+void * mmap( void * addr, std::size_t length, int prot, int flags, int fd, off_t offset) noexcept {
+    syscall_count.fetch_add( 1, std::memory_order_relaxed);
+    return reinterpret_cast< void * >( ::syscall( SYS_mmap, addr, length, prot, flags, fd, offset) );
+}
+
+int munmap( void * addr, std::size_t length) noexcept {
+    syscall_count.fetch_add( 1, std::memory_order_relaxed);
+    return static_cast< int >( ::syscall( SYS_munmap, addr, length) );
+}
+
+int mprotect( void * addr, std::size_t length, int prot) noexcept {
+    syscall_count.fetch_add( 1, std::memory_order_relaxed);
+    return static_cast< int >( ::syscall( SYS_mprotect, addr, length, prot) );
+}
+
+}
+#endif
+
+#endif // SYSCALLS_H
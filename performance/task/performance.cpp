@@ -0,0 +1,157 @@
+
+//          Copyright Oliver Kowalke 2009.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// fibers returning a value to the resumer: std::promise/std::future against
+// the result slot of fiber_task
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fiber_task.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/program_options.hpp>
+
+#include "../../test/allocations.hpp"
+#include "../benchmark.hpp"
+
+namespace ctx = boost::context;
+
+struct settings {
+    benchmark_options   options;
+    // switches back to the resumer before the value is produced
+    std::size_t         yields{ 0 };
+    std::size_t         stack_size{ 16 * 1024 };
+};
+
+volatile boost::uint64_t sink = 0;
+
+struct result {
+    double              task_ns{ 0 };
+    double              mallocs{ 0 };
+};
+
+template< typename Fn >
+result measure_tasks( boost::uint64_t n, Fn && fn) {
+    std::size_t allocs = allocations();
+    time_point_type start( clock_type::now() );
+    for ( boost::uint64_t i = 0; i < n; ++i) {
+        fn( i);
+    }
+    duration_type d = clock_type::now() - start;
+    result r;
+    r.task_ns = static_cast< double >( boost::chrono::duration_cast< boost::chrono::nanoseconds >( d).count() ) / n;
+    r.mallocs = static_cast< double >( allocations() - allocs) / n;
+    return r;
+}
+
+// shared state of promise and future allocated per task
+result run_future( settings const& s, ctx::pooled_fixedsize_stack & salloc, boost::uint64_t n) {
+    return measure_tasks( n, [&s,&salloc]( boost::uint64_t i) {
+        std::promise< boost::uint64_t > p;
+        std::future< boost::uint64_t > fut = p.get_future();
+        ctx::fiber f{ std::allocator_arg, salloc,
+            [&s,&p,i]( ctx::fiber && f) {
+                for ( std::size_t j = 0; j < s.yields; ++j) {
+                    f = std::move( f).resume();
+                }
+                p.set_value( i);
+                return std::move( f);
+            }};
+        while ( f) {
+            f = std::move( f).resume();
+        }
+        sink = sink + fut.get();
+    });
+}
+
+result run_task( settings const& s, ctx::pooled_fixedsize_stack & salloc, boost::uint64_t n) {
+    return measure_tasks( n, [&s,&salloc]( boost::uint64_t i) {
+        ctx::fiber_task< boost::uint64_t > t{ std::allocator_arg, salloc,
+            [&s,i]( ctx::fiber & caller) {
+                for ( std::size_t j = 0; j < s.yields; ++j) {
+                    caller = std::move( caller).resume();
+                }
+                return i;
+            }};
+        sink = sink + t.join();
+    });
+}
+
+template< typename Run >
+void measure( std::string const& name, settings const& s, Run run) {
+    if ( std::string::npos == name.find( s.options.filter) ) {
+        return;
+    }
+    // stacks are recycled by the pool, the allocations of the variants remain
+    ctx::pooled_fixedsize_stack salloc{ s.stack_size };
+    std::vector< double > ns, mallocs;
+    for ( std::size_t t = 0; t < s.options.warmup + (std::max)( s.options.trials, std::size_t( 1) ); ++t) {
+        result r = run( s, salloc, (std::max)( s.options.jobs, boost::uint64_t( 1) ) );
+        if ( t >= s.options.warmup) {
+            ns.push_back( r.task_ns);
+            mallocs.push_back( r.mallocs);
+        }
+    }
+    std::sort( ns.begin(), ns.end() );
+    std::sort( mallocs.begin(), mallocs.end() );
+    std::cout << std::fixed << std::setprecision( 2)
+              << std::left << std::setw( 10) << name << std::right
+              << std::setw( 12) << median_of( ns) << std::setw( 12) << median_of( mallocs) << std::endl;
+    std::cout.unsetf( std::ios_base::floatfield);
+}
+
+int main( int argc, char * argv[]) {
+    try {
+        settings s;
+        s.options.trials = 5;
+        s.options.warmup = 1;
+        boost::program_options::options_description desc("allowed options");
+        desc.add_options()
+            ("help", "help message")
+            ("jobs,j", boost::program_options::value< boost::uint64_t >( & s.options.jobs), "tasks per trial")
+            ("trials,t", boost::program_options::value< std::size_t >( & s.options.trials), "measured trials")
+            ("yields", boost::program_options::value< std::size_t >( & s.yields), "switches back before the value is produced")
+            ("stack-size", boost::program_options::value< std::size_t >( & s.stack_size), "stack size in bytes")
+            ("filter,f", boost::program_options::value< std::string >( & s.options.filter), "variants containing this string");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+                boost::program_options::parse_command_line(
+                    argc,
+                    argv,
+                    desc),
+                vm);
+        boost::program_options::notify( vm);
+
+        if ( vm.count("help") ) {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::cout << s.yields << " switches back per task" << std::endl;
+        std::cout << std::left << std::setw( 10) << "variant" << std::right
+                  << std::setw( 12) << "ns/task" << std::setw( 12) << "mallocs" << std::endl;
+        measure( "future", s, run_future);
+        measure( "task", s, run_task);
+
+        return EXIT_SUCCESS;
+    } catch ( std::exception const& e) {
+        std::cerr << "exception: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "unhandled exception" << std::endl;
+    }
+    return EXIT_FAILURE;
+}
@@ -12,6 +12,9 @@
 #include "boost/context/execution_context.hpp"
 #endif
 
+#include <new>
+#include <type_traits>
+
 #include <boost/config.hpp>
 
 #ifdef BOOST_HAS_ABI_HEADERS
@@ -25,18 +28,21 @@ namespace detail {
 // zero-initialization
 thread_local activation_record * current_rec;
 thread_local static std::size_t counter;
+// record of the main context, not allocated from the heap
+thread_local static typename std::aligned_storage<
+    sizeof( activation_record), alignof( activation_record) >::type main_rec;
 
 // schwarz counter
 activation_record_initializer::activation_record_initializer() noexcept {
     if ( 0 == counter++) {
-        current_rec = new activation_record();
+        current_rec = ::new ( static_cast< void * >( & main_rec) ) activation_record();
     }
 }
 
 activation_record_initializer::~activation_record_initializer() {
     if ( 0 == --counter) {
         BOOST_ASSERT( current_rec->is_main_context() );
-        delete current_rec;
+        current_rec->~activation_record();
     }
 }
 
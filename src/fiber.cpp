@@ -10,6 +10,9 @@
 #include "boost/context/fiber_winfib.hpp"
 #endif
 
+#include <new>
+#include <type_traits>
+
 #include <boost/config.hpp>
 
 #ifdef BOOST_HAS_ABI_HEADERS
@@ -19,36 +22,64 @@
 namespace boost {
 namespace context {
 namespace detail {
+#if defined(BOOST_USE_UCONTEXT)
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN
+#endif
 
 // zero-initialization
 thread_local fiber_activation_record * fib_current_rec;
 thread_local static std::size_t counter;
+// record of the main context, not allocated from the heap
+thread_local static typename std::aligned_storage<
+    sizeof( fiber_activation_record), alignof( fiber_activation_record) >::type main_rec;
 
 // schwarz counter
 fiber_activation_record_initializer::fiber_activation_record_initializer() noexcept {
     if ( 0 == counter++) {
-        fib_current_rec = new fiber_activation_record();
+        fib_current_rec = ::new ( static_cast< void * >( & main_rec) ) fiber_activation_record();
     }
 }
 
 fiber_activation_record_initializer::~fiber_activation_record_initializer() {
     if ( 0 == --counter) {
         BOOST_ASSERT( fib_current_rec->is_main_context() );
-        delete fib_current_rec;
+        fib_current_rec->~fiber_activation_record();
     }
 }
 
+#if defined(BOOST_USE_UCONTEXT)
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_END
+BOOST_CONTEXT_FIBER_ABI_END
+#endif
 }
 
 namespace detail {
+#if defined(BOOST_USE_UCONTEXT)
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_BEGIN
+#endif
 
 fiber_activation_record *&
 fiber_activation_record::current() noexcept {
+#if defined(BOOST_USE_UCONTEXT)
+    // the record of the main context owns no resources and is not
+    // destroyed: no thread-local destructor gets registered, which
+    // would allocate in the C++ runtime
+    if ( BOOST_UNLIKELY( nullptr == fib_current_rec) ) {
+        fib_current_rec = ::new ( static_cast< void * >( & main_rec) ) fiber_activation_record();
+    }
+#else
     // initialized the first time control passes; per thread
     thread_local static fiber_activation_record_initializer initializer;
+#endif
     return fib_current_rec;
 }
 
+#if defined(BOOST_USE_UCONTEXT)
+BOOST_CONTEXT_UCONTEXT_NAMESPACE_END
+BOOST_CONTEXT_FIBER_ABI_END
+#endif
 }
 
 }}
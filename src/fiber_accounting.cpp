@@ -0,0 +1,110 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_accounting.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/timestamp.hpp"
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+// per-context data, in ticks of the time-stamp counter
+struct accounting {
+    // cumulative time running
+    std::uint64_t           run_time;
+    // number of times the context was switched to
+    std::uint64_t           resumes;
+    // longest single run
+    std::uint64_t           max_slice;
+    // start of the current run
+    std::uint64_t           switched_in;
+};
+
+// runs begun before are not accounted (switched_in is stale or zero)
+std::atomic< std::uint64_t > accounting_start{ 0 };
+
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+
+fiber_hooks const accounting_hooks{ nullptr, on_switch, nullptr, sizeof( accounting), {} };
+
+accounting * accounting_of( fiber_info const* info) noexcept {
+    return static_cast< accounting * >( fiber_hooks_data( & accounting_hooks, info) );
+}
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch) noexcept {
+    std::uint64_t now = detail::timestamp();
+    accounting * acc = accounting_of( from);
+    if ( nullptr != acc && acc->switched_in >= accounting_start.load( std::memory_order_relaxed) ) {
+        std::uint64_t slice = now - acc->switched_in;
+        acc->run_time += slice;
+        if ( slice > acc->max_slice) {
+            acc->max_slice = slice;
+        }
+    }
+    acc = accounting_of( to);
+    if ( nullptr != acc) {
+        ++acc->resumes;
+        acc->switched_in = now;
+    }
+}
+
+std::chrono::nanoseconds to_duration( std::uint64_t ticks) noexcept {
+    return std::chrono::nanoseconds{
+        static_cast< std::chrono::nanoseconds::rep >( ticks * 1e9 / detail::timestamp_frequency() ) };
+}
+
+}
+
+bool start_fiber_accounting() noexcept {
+    // calibrate the time-stamp counter before the first run is accounted
+    detail::timestamp_frequency();
+    accounting_start.store( detail::timestamp(), std::memory_order_relaxed);
+    return add_fiber_hooks( & accounting_hooks);
+}
+
+void stop_fiber_accounting() noexcept {
+    remove_fiber_hooks( & accounting_hooks);
+}
+
+fiber_cpu_usage fiber_usage( fiber_info const* info) noexcept {
+    fiber_cpu_usage usage;
+    accounting const* acc = accounting_of( info);
+    if ( nullptr != acc) {
+        usage.run_time = to_duration( acc->run_time);
+        usage.resumes = acc->resumes;
+        usage.max_slice = to_duration( acc->max_slice);
+    }
+    return usage;
+}
+
+void reset_fiber_usage( fiber_info * info) noexcept {
+    accounting * acc = accounting_of( info);
+    if ( nullptr != acc) {
+        acc->run_time = 0;
+        acc->resumes = 0;
+        acc->max_slice = 0;
+    }
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
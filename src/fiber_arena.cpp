@@ -0,0 +1,168 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_arena.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/fiber_arena.hpp"
+#include "boost/context/fiber.hpp"
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_ARENA) && ! defined(BOOST_USE_WINFIB)
+
+namespace boost {
+namespace context {
+
+#if defined(BOOST_CONTEXT_HAS_MEMORY_RESOURCE)
+
+namespace {
+
+// header of each block, the blocks form a list starting at the newest
+struct block {
+    block                   *   next;
+    std::size_t                 size;
+};
+
+// placed in the first block
+class arena final : public std::pmr::memory_resource {
+private:
+    block                   *   blocks_;
+    char                    *   next_;
+    char                    *   end_;
+    std::size_t                 used_{ 0 };
+
+    bool grow( std::size_t bytes, std::size_t alignment) noexcept {
+        std::size_t size = (std::max)( 2 * blocks_->size, sizeof( block) + bytes + alignment);
+        block * b = static_cast< block * >( ::operator new( size, std::nothrow) );
+        if ( nullptr == b) {
+            return false;
+        }
+        b->next = blocks_;
+        b->size = size;
+        blocks_ = b;
+        next_ = reinterpret_cast< char * >( b + 1);
+        end_ = reinterpret_cast< char * >( b) + size;
+        return true;
+    }
+
+protected:
+    void * do_allocate( std::size_t bytes, std::size_t alignment) override {
+        for (;;) {
+            std::uintptr_t p = reinterpret_cast< std::uintptr_t >( next_);
+            p = ( p + alignment - 1) & ~ static_cast< std::uintptr_t >( alignment - 1);
+            if ( p <= reinterpret_cast< std::uintptr_t >( end_) &&
+                 bytes <= reinterpret_cast< std::uintptr_t >( end_) - p) {
+                next_ = reinterpret_cast< char * >( p + bytes);
+                used_ += bytes;
+                return reinterpret_cast< void * >( p);
+            }
+            if ( ! grow( bytes, alignment) ) {
+                throw std::bad_alloc{};
+            }
+        }
+    }
+
+    void do_deallocate( void *, std::size_t, std::size_t) noexcept override {
+    }
+
+    bool do_is_equal( std::pmr::memory_resource const& other) const noexcept override {
+        return this == & other;
+    }
+
+public:
+    arena( block * first) noexcept :
+        blocks_{ first },
+        next_{ reinterpret_cast< char * >( this + 1) },
+        end_{ reinterpret_cast< char * >( first) + first->size } {
+    }
+
+    ~arena() {
+        // the first block holds `this`
+        block * b = blocks_;
+        while ( nullptr != b->next) {
+            block * next = b->next;
+            ::operator delete( b);
+            b = next;
+        }
+    }
+
+    std::size_t used() const noexcept {
+        return used_;
+    }
+};
+
+static_assert( sizeof( block) + sizeof( arena) < BOOST_CONTEXT_FIBER_ARENA_SIZE,
+               "BOOST_CONTEXT_FIBER_ARENA_SIZE too small");
+
+// `slot` is held by the record of the fiber
+arena * arena_of( void ** slot) noexcept {
+    if ( BOOST_UNLIKELY( nullptr == * slot) ) {
+        block * first = static_cast< block * >( ::operator new( BOOST_CONTEXT_FIBER_ARENA_SIZE, std::nothrow) );
+        if ( nullptr == first) {
+            return nullptr;
+        }
+        first->next = nullptr;
+        first->size = BOOST_CONTEXT_FIBER_ARENA_SIZE;
+        * slot = new ( first + 1) arena{ first };
+    }
+    return static_cast< arena * >( * slot);
+}
+
+}
+
+std::pmr::memory_resource * fiber_memory_resource() noexcept {
+    void ** slot = detail::fiber_current_arena();
+    if ( nullptr == slot) {
+        // the main context lives as long as the thread
+        return std::pmr::get_default_resource();
+    }
+    arena * a = arena_of( slot);
+    if ( nullptr == a) {
+        return std::pmr::get_default_resource();
+    }
+    return a;
+}
+
+std::size_t fiber_arena_used() noexcept {
+    void ** slot = detail::fiber_current_arena();
+    return nullptr != slot && nullptr != * slot ? static_cast< arena * >( * slot)->used() : 0;
+}
+
+#endif
+
+namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+void fiber_arena_release( void * vp) noexcept {
+#if defined(BOOST_CONTEXT_HAS_MEMORY_RESOURCE)
+    arena * a = static_cast< arena * >( vp);
+    block * first = reinterpret_cast< block * >( a) - 1;
+    a->~arena();
+    ::operator delete( first);
+#else
+    ( void) vp;
+#endif
+}
+
+BOOST_CONTEXT_FIBER_ABI_END
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,365 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_backtrace.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/frame_walk.hpp"
+#include "boost/context/fiber.hpp"
+
+#if defined(BOOST_CONTEXT_HAS_INTERRUPTED_FRAME)
+# define BOOST_CONTEXT_BACKTRACE_SUPPORTED
+extern "C" {
+# include <dlfcn.h>
+}
+# include <cxxabi.h>
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+
+constexpr std::size_t max_chain = BOOST_CONTEXT_BACKTRACE_MAX_CHAIN;
+
+typedef std::atomic< fiber_info * >     link_type;
+
+// contexts that resumed each other on a thread, the running context on top;
+// all others are suspended at their parked frame
+// links are cleared by other threads if a context migrates
+struct resume_chain {
+    resume_chain                    *   next{ nullptr };
+    std::atomic< bool >                 owned{ true };
+    // stack of the thread (main context)
+    char                            *   low{ nullptr };
+    char                            *   high{ nullptr };
+    std::size_t                         depth{ 0 };
+    link_type                           links[max_chain]{};
+};
+
+// per-context data
+struct parked {
+    // innermost frame of the suspended context
+    std::atomic< void * >       fp;
+    std::atomic< void * >       pc;
+    // entry in the resume chain of a thread
+    std::atomic< link_type * >  link;
+};
+
+// never freed, chains of terminated threads are reused
+std::atomic< resume_chain * >       chains{ nullptr };
+thread_local resume_chain       *   local_chain{ nullptr };
+
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+
+fiber_hooks const backtrace_hooks{ nullptr, on_switch, nullptr, sizeof( parked), {} };
+
+parked * parked_of( fiber_info const* f) noexcept {
+    return static_cast< parked * >( fiber_hooks_data( & backtrace_hooks, f) );
+}
+
+void unlink( parked * p, fiber_info * f) noexcept {
+    link_type * l = p->link.load( std::memory_order_relaxed);
+    if ( nullptr != l) {
+        fiber_info * expected = f;
+        l->compare_exchange_strong( expected, nullptr, std::memory_order_relaxed);
+    }
+}
+
+// the contexts above `depth` have been resumed or have terminated; their
+// `parked::link` is not touched (checked against the link instead)
+void truncate( resume_chain & c, std::size_t depth) noexcept {
+    while ( c.depth > depth) {
+        c.links[--c.depth].store( nullptr, std::memory_order_relaxed);
+    }
+}
+
+// contexts without data are not chained
+void push( resume_chain & c, fiber_info * f) noexcept {
+    parked * p = parked_of( f);
+    if ( nullptr == p) {
+        return;
+    }
+    // removes `f` from the chain of another thread
+    unlink( p, f);
+    if ( max_chain == c.depth) {
+        truncate( c, 0);
+    }
+    link_type & l = c.links[c.depth++];
+    l.store( f, std::memory_order_relaxed);
+    p->link.store( & l, std::memory_order_relaxed);
+}
+
+bool in_chain( resume_chain const& c, fiber_info const* f, std::size_t & i) noexcept {
+    parked * p = parked_of( f);
+    if ( nullptr == p) {
+        return false;
+    }
+    link_type const* l = p->link.load( std::memory_order_relaxed);
+    if ( l < c.links || l >= c.links + c.depth || f != l->load( std::memory_order_relaxed) ) {
+        return false;
+    }
+    i = static_cast< std::size_t >( l - c.links);
+    return true;
+}
+
+struct chain_releaser {
+    ~chain_releaser() {
+        if ( nullptr != local_chain) {
+            truncate( * local_chain, 0);
+            local_chain->owned.store( false, std::memory_order_release);
+            local_chain = nullptr;
+        }
+    }
+};
+
+resume_chain * acquire_chain() noexcept {
+    // releases the chain at thread exit
+    static thread_local chain_releaser releaser;
+    resume_chain * c = nullptr;
+    for ( c = chains.load( std::memory_order_acquire); nullptr != c; c = c->next) {
+        bool expected = false;
+        if ( c->owned.compare_exchange_strong( expected, true, std::memory_order_acq_rel) ) {
+            break;
+        }
+    }
+    if ( nullptr == c) {
+        c = new ( std::nothrow) resume_chain{};
+        if ( nullptr == c) {
+            return nullptr;
+        }
+        c->next = chains.load( std::memory_order_relaxed);
+        while ( ! chains.compare_exchange_weak( c->next, c, std::memory_order_release, std::memory_order_relaxed) ) {
+        }
+    }
+    detail::thread_stack( c->low, c->high);
+    return c;
+}
+
+void bounds_of( fiber_info const* f, resume_chain const& c, char *& low, char *& high) noexcept {
+    if ( nullptr != f && nullptr != f->sctx.sp) {
+        high = static_cast< char * >( f->sctx.sp);
+        low = high - f->sctx.size;
+    } else {
+        low = c.low;
+        high = c.high;
+    }
+}
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch kind) noexcept {
+    resume_chain * c = local_chain;
+    if ( BOOST_UNLIKELY( nullptr == c) ) {
+        c = local_chain = acquire_chain();
+        if ( nullptr == c) {
+            return;
+        }
+    }
+    parked * p = fiber_switch::exit != kind ? parked_of( from) : nullptr;
+    if ( nullptr != p) {
+        char * low = nullptr;
+        char * high = nullptr;
+        bounds_of( from, * c, low, high);
+        void * parked_fp = nullptr;
+        void * parked_pc = nullptr;
+        detail::parked_frame( static_cast< char * >( __builtin_frame_address( 0) ), low, high,
+                              parked_fp, parked_pc);
+        p->fp.store( parked_fp, std::memory_order_relaxed);
+        p->pc.store( parked_pc, std::memory_order_relaxed);
+    }
+    // `from` is the top of the chain unless the backtrace has been started
+    // while the thread was running a fiber
+    if ( 0 == c->depth || from != c->links[c->depth - 1].load( std::memory_order_relaxed) ) {
+        truncate( * c, 0);
+        push( * c, from);
+    }
+    if ( fiber_switch::exit == kind) {
+        truncate( * c, c->depth - 1);
+    }
+    std::size_t i = 0;
+    if ( in_chain( * c, to, i) ) {
+        // `to` returns into the chain
+        truncate( * c, i + 1);
+    } else {
+        push( * c, to);
+    }
+}
+
+std::size_t walk( fiber_info * f, void * pc, char * fp, char const* low, char const* high,
+                  fiber_frame * frames, std::size_t size) noexcept {
+    std::size_t depth = 0;
+    return detail::walk_frames( pc, fp, low, high,
+            [f,frames,size,&depth]( void * addr) noexcept {
+                if ( depth == size) {
+                    return false;
+                }
+                frames[depth].pc = addr;
+                frames[depth].fiber = f;
+                ++depth;
+                return true;
+            });
+}
+
+#endif
+
+std::string name_of( fiber_info * f) {
+    if ( nullptr == f) {
+        return "unknown context";
+    }
+    if ( nullptr != f->label) {
+        return f->label;
+    }
+    if ( nullptr == f->sctx.sp) {
+        return "main context";
+    }
+    return "fiber " + std::to_string( f->id );
+}
+
+}
+
+bool start_fiber_backtrace() noexcept {
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+    return add_fiber_hooks( & backtrace_hooks);
+#else
+    return false;
+#endif
+}
+
+void stop_fiber_backtrace() noexcept {
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+    remove_fiber_hooks( & backtrace_hooks);
+    // the chains are rebuilt after a restart
+#endif
+}
+
+BOOST_NOINLINE
+std::size_t fiber_backtrace( fiber_frame * frames, std::size_t size) noexcept {
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+    resume_chain * c = local_chain;
+    if ( BOOST_UNLIKELY( nullptr == c) ) {
+        c = local_chain = acquire_chain();
+        if ( nullptr == c) {
+            return 0;
+        }
+    }
+    fiber_info * current = current_fiber_info();
+    char * low = nullptr;
+    char * high = nullptr;
+    bounds_of( current, * c, low, high);
+    // skip this function
+    void ** frame = static_cast< void ** >( __builtin_frame_address( 0) );
+    std::size_t depth = walk( current, frame[1], static_cast< char * >( frame[0]), low, high, frames, size);
+    std::size_t i = 0;
+    if ( ! in_chain( * c, current, i) ) {
+        return depth;
+    }
+    while ( 0 < i-- && depth < size) {
+        fiber_info * f = c->links[i].load( std::memory_order_relaxed);
+        parked * p = nullptr != f ? parked_of( f) : nullptr;
+        void * pc = nullptr != p ? p->pc.load( std::memory_order_relaxed) : nullptr;
+        if ( nullptr == pc) {
+            // cleared by another thread
+            break;
+        }
+        bounds_of( f, * c, low, high);
+        depth += walk( f, pc, static_cast< char * >( p->fp.load( std::memory_order_relaxed) ),
+                       low, high, frames + depth, size - depth);
+    }
+    return depth;
+#else
+    ( void) frames;
+    ( void) size;
+    return 0;
+#endif
+}
+
+std::size_t parked_fiber_backtrace( fiber_info const* info, fiber_frame * frames, std::size_t size) noexcept {
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+    if ( nullptr == info || nullptr == info->sctx.sp) {
+        // the stack of a main context is not known on another thread
+        return 0;
+    }
+    parked * p = parked_of( info);
+    void * pc = nullptr != p ? p->pc.load( std::memory_order_relaxed) : nullptr;
+    if ( nullptr == pc) {
+        return 0;
+    }
+    char * high = static_cast< char * >( info->sctx.sp);
+    char * low = high - info->sctx.size;
+    return walk( const_cast< fiber_info * >( info), pc,
+                 static_cast< char * >( p->fp.load( std::memory_order_relaxed) ),
+                 low, high, frames, size);
+#else
+    ( void) info;
+    ( void) frames;
+    ( void) size;
+    return 0;
+#endif
+}
+
+void write_fiber_backtrace( std::ostream & os, fiber_frame const* frames, std::size_t size) {
+    for ( std::size_t i = 0; i < size; ++i) {
+        if ( 0 == i || frames[i].fiber != frames[i - 1].fiber) {
+            os << "--- " << name_of( frames[i].fiber) << '\n';
+        }
+        os << '#' << i << ' ' << frames[i].pc << ' ' << detail::frame_symbol( frames[i].pc, false) << '\n';
+    }
+}
+
+namespace detail {
+
+std::string frame_symbol( void * pc, bool leaf) {
+    // return addresses point behind the call
+    void * addr = leaf ? pc : static_cast< char * >( pc) - 1;
+#if defined(BOOST_CONTEXT_BACKTRACE_SUPPORTED)
+    Dl_info info;
+    if ( 0 != ::dladdr( addr, & info) ) {
+        if ( nullptr != info.dli_sname) {
+            int status = 0;
+            std::unique_ptr< char, void(*)( void *) > demangled{
+                abi::__cxa_demangle( info.dli_sname, nullptr, nullptr, & status), std::free };
+            return 0 == status ? std::string{ demangled.get() } : std::string{ info.dli_sname };
+        }
+        if ( nullptr != info.dli_fname) {
+            char const* name = std::strrchr( info.dli_fname, '/');
+            char buffer[32];
+            std::snprintf( buffer, sizeof( buffer), "+0x%lx",
+                    static_cast< unsigned long >(
+                        static_cast< char * >( addr) - static_cast< char * >( info.dli_fbase) ) );
+            return std::string{ nullptr != name ? name + 1 : info.dli_fname } + buffer;
+        }
+    }
+#endif
+    char buffer[32];
+    std::snprintf( buffer, sizeof( buffer), "%p", addr);
+    return buffer;
+}
+
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
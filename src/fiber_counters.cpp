@@ -0,0 +1,257 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_counters.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/config.hpp>
+#include <boost/predef.h>
+
+#if defined(BOOST_USE_FIBER_HOOKS) && BOOST_OS_LINUX
+extern "C" {
+# include <linux/perf_event.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+}
+# if BOOST_ARCH_X86
+#  include <x86intrin.h>
+# endif
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+#if BOOST_OS_LINUX
+
+constexpr std::size_t counter_count = 4;
+
+std::uint64_t fiber_counters::* const members[counter_count] = {
+    & fiber_counters::instructions,
+    & fiber_counters::cycles,
+    & fiber_counters::cache_misses,
+    & fiber_counters::branch_misses };
+
+std::uint64_t const configs[counter_count] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES };
+
+// incremented by start_fiber_counters(); a thread that samples the first
+// time after a restart does not attribute the events since its last sample
+std::atomic< std::uint64_t > generation{ 0 };
+
+// counts of a perf_event mapped into user space, see perf_event_open(2)
+std::uint64_t read_rdpmc( perf_event_mmap_page volatile* pc) noexcept {
+    std::uint32_t seq;
+    std::uint64_t count;
+    do {
+        seq = pc->lock;
+        std::atomic_signal_fence( std::memory_order_acq_rel);
+        std::uint32_t index = pc->index;
+        count = pc->offset;
+# if BOOST_ARCH_X86
+        if ( pc->cap_user_rdpmc && 0 != index) {
+            std::uint16_t width = pc->pmc_width;
+            // sign-extend the counter from pmc_width bits; shifted left
+            // unsigned, a signed left shift overflowing is undefined
+            std::int64_t pmc = static_cast< std::int64_t >(
+                    static_cast< std::uint64_t >( __rdpmc( index - 1) ) << ( 64 - width) );
+            pmc >>= 64 - width;
+            count += static_cast< std::uint64_t >( pmc);
+        }
+# endif
+        std::atomic_signal_fence( std::memory_order_acq_rel);
+    } while ( pc->lock != seq);
+    return count;
+}
+
+// perf_event group of a thread, counting the thread in user mode on any CPU
+class thread_counters {
+private:
+    int                         fd_[counter_count];
+    perf_event_mmap_page    *   page_[counter_count];
+    std::size_t                 page_size_{ 0 };
+    int                         leader_{ -1 };
+    bool                        opened_{ false };
+
+public:
+    fiber_counters_access       access{ fiber_counters_access::none };
+    std::uint64_t               last[counter_count];
+    std::uint64_t               generation{ 0 };
+
+    thread_counters() noexcept {
+        for ( std::size_t i = 0; i < counter_count; ++i) {
+            fd_[i] = -1;
+            page_[i] = nullptr;
+            last[i] = 0;
+        }
+    }
+
+    ~thread_counters() {
+        for ( std::size_t i = 0; i < counter_count; ++i) {
+            if ( nullptr != page_[i]) {
+                ::munmap( page_[i], page_size_);
+            }
+            if ( -1 != fd_[i]) {
+                ::close( fd_[i]);
+            }
+        }
+    }
+
+    thread_counters( thread_counters const&) = delete;
+    thread_counters & operator=( thread_counters const&) = delete;
+
+    // opens the group once per thread; events not supported by the CPU
+    // are left out (and stay zero)
+    bool open() noexcept {
+        if ( opened_) {
+            return fiber_counters_access::none != access;
+        }
+        opened_ = true;
+        page_size_ = static_cast< std::size_t >( ::sysconf( _SC_PAGESIZE) );
+        for ( std::size_t i = 0; i < counter_count; ++i) {
+            perf_event_attr attr;
+            std::memset( & attr, 0, sizeof( attr) );
+            attr.size = sizeof( attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fd_[i] = static_cast< int >( ::syscall(
+                    __NR_perf_event_open, & attr, 0, -1, leader_, PERF_FLAG_FD_CLOEXEC) );
+            if ( -1 == fd_[i]) {
+                continue;
+            }
+            if ( -1 == leader_) {
+                leader_ = fd_[i];
+            }
+            void * vp = ::mmap( nullptr, page_size_, PROT_READ, MAP_SHARED, fd_[i], 0);
+            page_[i] = MAP_FAILED != vp ? static_cast< perf_event_mmap_page * >( vp) : nullptr;
+        }
+        if ( -1 == leader_) {
+            return false;
+        }
+        access = fiber_counters_access::rdpmc;
+        for ( std::size_t i = 0; i < counter_count; ++i) {
+            if ( -1 != fd_[i] && ( nullptr == page_[i] || ! page_[i]->cap_user_rdpmc) ) {
+                access = fiber_counters_access::read;
+            }
+        }
+#if ! BOOST_ARCH_X86
+        access = fiber_counters_access::read;
+#endif
+        return true;
+    }
+
+    void sample( std::uint64_t (& values)[counter_count]) noexcept {
+        if ( fiber_counters_access::rdpmc == access) {
+            for ( std::size_t i = 0; i < counter_count; ++i) {
+                values[i] = -1 != fd_[i] ? read_rdpmc( page_[i]) : 0;
+            }
+            return;
+        }
+        // PERF_FORMAT_GROUP: number of events followed by the values
+        // in the order the events were added to the group
+        std::uint64_t buffer[1 + counter_count] = { 0 };
+        if ( 0 > ::read( leader_, buffer, sizeof( buffer) ) ) {
+            buffer[0] = 0;
+        }
+        for ( std::size_t i = 0, j = 1; i < counter_count; ++i) {
+            values[i] = ( -1 != fd_[i] && j <= buffer[0]) ? buffer[j++] : 0;
+        }
+    }
+};
+
+thread_local thread_counters counters_of_thread;
+
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+
+// per-context data: the events of the context
+fiber_hooks const counters_hooks{ nullptr, on_switch, nullptr, sizeof( fiber_counters), {} };
+
+void on_switch( fiber_info * from, fiber_info *, fiber_switch) noexcept {
+    thread_counters & tc = counters_of_thread;
+    if ( ! tc.open() ) {
+        return;
+    }
+    std::uint64_t values[counter_count];
+    tc.sample( values);
+    std::uint64_t gen = generation.load( std::memory_order_relaxed);
+    fiber_counters * counters = static_cast< fiber_counters * >( fiber_hooks_data( & counters_hooks, from) );
+    if ( tc.generation == gen && nullptr != counters) {
+        for ( std::size_t i = 0; i < counter_count; ++i) {
+            counters->*members[i] += values[i] - tc.last[i];
+        }
+    }
+    for ( std::size_t i = 0; i < counter_count; ++i) {
+        tc.last[i] = values[i];
+    }
+    tc.generation = gen;
+}
+
+#endif
+
+}
+
+bool start_fiber_counters() noexcept {
+#if BOOST_OS_LINUX
+    if ( ! counters_of_thread.open() ) {
+        return false;
+    }
+    generation.fetch_add( 1, std::memory_order_relaxed);
+    return add_fiber_hooks( & counters_hooks);
+#else
+    return false;
+#endif
+}
+
+void stop_fiber_counters() noexcept {
+#if BOOST_OS_LINUX
+    remove_fiber_hooks( & counters_hooks);
+#endif
+}
+
+fiber_counters fiber_counters_of( fiber_info const* info) noexcept {
+#if BOOST_OS_LINUX
+    fiber_counters const* counters = static_cast< fiber_counters const* >( fiber_hooks_data( & counters_hooks, info) );
+    if ( nullptr != counters) {
+        return * counters;
+    }
+#else
+    ( void) info;
+#endif
+    return fiber_counters{};
+}
+
+fiber_counters_access fiber_counters_access_of_thread() noexcept {
+#if BOOST_OS_LINUX
+    return counters_of_thread.access;
+#else
+    return fiber_counters_access::none;
+#endif
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
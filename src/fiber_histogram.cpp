@@ -0,0 +1,344 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_histogram.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sstream>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/timestamp.hpp"
+
+#if defined(BOOST_MSVC)
+# include <intrin.h>
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+constexpr std::size_t bucket_count = fiber_histogram::bucket_count;
+
+inline
+std::size_t log2_of( std::uint64_t v) noexcept {
+#if defined(BOOST_MSVC) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64( & index, v);
+    return index;
+#elif defined(BOOST_GCC) || defined(BOOST_CLANG)
+    return 63 - __builtin_clzll( v);
+#else
+    std::size_t index = 0;
+    while ( v >>= 1) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// single writer (owning thread), read by the snapshot functions
+struct histogram_buffer {
+    std::atomic< std::uint64_t >    counts[bucket_count];
+    std::atomic< std::uint64_t >    sum;
+
+    histogram_buffer() noexcept {
+        for ( std::atomic< std::uint64_t > & c : counts) {
+            c.store( 0, std::memory_order_relaxed);
+        }
+        sum.store( 0, std::memory_order_relaxed);
+    }
+
+    void record( std::uint64_t value) noexcept {
+        std::atomic< std::uint64_t > & c = counts[fiber_histogram::bucket_of( value)];
+        c.store( c.load( std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store( sum.load( std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void copy_to( fiber_histogram & h) const noexcept {
+        h.count = 0;
+        for ( std::size_t i = 0; i < bucket_count; ++i) {
+            h.counts[i] = counts[i].load( std::memory_order_relaxed);
+            h.count += h.counts[i];
+        }
+        h.sum = sum.load( std::memory_order_relaxed);
+        h.frequency = detail::timestamp_frequency();
+    }
+
+    void clear() noexcept {
+        for ( std::atomic< std::uint64_t > & c : counts) {
+            c.store( 0, std::memory_order_relaxed);
+        }
+        sum.store( 0, std::memory_order_relaxed);
+    }
+};
+
+struct thread_histograms {
+    thread_histograms   *   next{ nullptr };
+    std::atomic< bool >     owned{ true };
+    std::size_t             index;
+    histogram_buffer        delay{};
+    histogram_buffer        slice{};
+
+    explicit thread_histograms( std::size_t index_) noexcept :
+        index{ index_ } {
+    }
+};
+
+// never freed, histograms of terminated threads are reused
+std::atomic< thread_histograms * >  histograms{ nullptr };
+std::atomic< std::size_t >          histogram_count{ 0 };
+// stamps taken before are ignored
+std::atomic< std::uint64_t >        histogram_start{ 0 };
+thread_local thread_histograms  *   local_histograms{ nullptr };
+
+struct histograms_releaser {
+    ~histograms_releaser() {
+        if ( nullptr != local_histograms) {
+            local_histograms->owned.store( false, std::memory_order_release);
+            local_histograms = nullptr;
+        }
+    }
+};
+
+thread_histograms * acquire_histograms() noexcept {
+    // releases the histograms at thread exit
+    static thread_local histograms_releaser releaser;
+    for ( thread_histograms * h = histograms.load( std::memory_order_acquire); nullptr != h; h = h->next) {
+        bool expected = false;
+        if ( h->owned.compare_exchange_strong( expected, true, std::memory_order_acq_rel) ) {
+            return h;
+        }
+    }
+    thread_histograms * h = new ( std::nothrow) thread_histograms{
+        histogram_count.fetch_add( 1, std::memory_order_relaxed) + 1 };
+    if ( nullptr == h) {
+        return nullptr;
+    }
+    h->next = histograms.load( std::memory_order_relaxed);
+    while ( ! histograms.compare_exchange_weak( h->next, h, std::memory_order_release, std::memory_order_relaxed) ) {
+    }
+    return h;
+}
+
+// per-context data, in ticks of the time-stamp counter
+struct stamps {
+    // start of the current run
+    std::uint64_t           switched_in;
+    // suspension (or creation) of the context
+    std::uint64_t           switched_out;
+};
+
+void on_create( fiber_info *) noexcept;
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+
+fiber_hooks const histogram_hooks{ on_create, on_switch, nullptr, sizeof( stamps), {} };
+
+stamps * stamps_of( fiber_info const* info) noexcept {
+    return static_cast< stamps * >( fiber_hooks_data( & histogram_hooks, info) );
+}
+
+void on_create( fiber_info * info) noexcept {
+    stamps * s = stamps_of( info);
+    if ( nullptr != s) {
+        s->switched_out = detail::timestamp();
+    }
+}
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch) noexcept {
+    thread_histograms * h = local_histograms;
+    if ( BOOST_UNLIKELY( nullptr == h) ) {
+        h = local_histograms = acquire_histograms();
+        if ( nullptr == h) {
+            return;
+        }
+    }
+    std::uint64_t now = detail::timestamp();
+    std::uint64_t start = histogram_start.load( std::memory_order_relaxed);
+    stamps * s = nullptr != from->sctx.sp ? stamps_of( from) : nullptr;
+    if ( nullptr != s) {
+        if ( s->switched_in >= start) {
+            h->slice.record( now - s->switched_in);
+        }
+        s->switched_out = now;
+    }
+    s = nullptr != to->sctx.sp ? stamps_of( to) : nullptr;
+    if ( nullptr != s) {
+        if ( s->switched_out >= start) {
+            h->delay.record( now - s->switched_out);
+        }
+        s->switched_in = now;
+    }
+}
+
+fiber_histograms snapshot_of( thread_histograms const& t) noexcept {
+    fiber_histograms h;
+    h.thread = t.index;
+    t.delay.copy_to( h.scheduling_delay);
+    t.slice.copy_to( h.run_slice);
+    return h;
+}
+
+std::chrono::nanoseconds to_duration( double ticks, double frequency) noexcept {
+    return std::chrono::nanoseconds{
+        static_cast< std::chrono::nanoseconds::rep >( ticks * 1e9 / frequency) };
+}
+
+void write_prometheus( std::ostream & os, char const* name, char const* help, fiber_histogram const& h) {
+    // fixed bucket bounds (1-2.5-5 series, 100ns..10s), rounded to the
+    // resolution of the histogram
+    os << "# HELP " << name << ' ' << help << '\n'
+       << "# TYPE " << name << " histogram\n";
+    double const frequency = 0 < h.frequency ? h.frequency : detail::timestamp_frequency();
+    std::uint64_t cumulative = 0;
+    std::size_t bucket = 0;
+    for ( double decade = 1e-7; decade < 1e2; decade *= 10) {
+        for ( double factor : { 1.0, 2.5, 5.0 }) {
+            double le = decade * factor;
+            if ( le > 10.0) {
+                break;
+            }
+            double ticks = le * frequency;
+            // buckets entirely below the bound
+            while ( bucket + 1 < bucket_count &&
+                    static_cast< double >( fiber_histogram::lower_bound( bucket + 1) ) <= ticks) {
+                cumulative += h.counts[bucket++];
+            }
+            os << name << "_bucket{le=\"" << le << "\"} " << cumulative << '\n';
+        }
+    }
+    os << name << "_bucket{le=\"+Inf\"} " << h.count << '\n'
+       << name << "_sum " << h.sum / frequency << '\n'
+       << name << "_count " << h.count << '\n';
+}
+
+}
+
+std::size_t fiber_histogram::bucket_of( std::uint64_t value) noexcept {
+    if ( value < sub_bucket_count) {
+        return static_cast< std::size_t >( value);
+    }
+    std::size_t e = log2_of( value);
+    return ( ( e - sub_bucket_bits + 1) << sub_bucket_bits) |
+           static_cast< std::size_t >( ( value >> ( e - sub_bucket_bits) ) & ( sub_bucket_count - 1) );
+}
+
+std::uint64_t fiber_histogram::lower_bound( std::size_t index) noexcept {
+    if ( index < sub_bucket_count) {
+        return index;
+    }
+    std::size_t e = ( index >> sub_bucket_bits) + sub_bucket_bits - 1;
+    std::uint64_t sub = index & ( sub_bucket_count - 1);
+    return ( sub_bucket_count + sub) << ( e - sub_bucket_bits);
+}
+
+void fiber_histogram::merge( fiber_histogram const& other) noexcept {
+    for ( std::size_t i = 0; i < bucket_count; ++i) {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if ( 0 == frequency) {
+        frequency = other.frequency;
+    }
+}
+
+std::chrono::nanoseconds fiber_histogram::percentile( double q) const noexcept {
+    if ( 0 == count) {
+        return std::chrono::nanoseconds{ 0 };
+    }
+    std::uint64_t rank = static_cast< std::uint64_t >( q * count + 0.5);
+    rank = rank < 1 ? 1 : ( rank > count ? count : rank);
+    std::uint64_t seen = 0;
+    for ( std::size_t i = 0; i < bucket_count; ++i) {
+        seen += counts[i];
+        if ( seen >= rank) {
+            double upper = i + 1 < bucket_count
+                ? static_cast< double >( lower_bound( i + 1) - 1)
+                : static_cast< double >( ~std::uint64_t( 0) );
+            return to_duration( upper, frequency);
+        }
+    }
+    return to_duration( static_cast< double >( ~std::uint64_t( 0) ), frequency);
+}
+
+std::chrono::nanoseconds fiber_histogram::mean() const noexcept {
+    if ( 0 == count) {
+        return std::chrono::nanoseconds{ 0 };
+    }
+    return to_duration( static_cast< double >( sum) / count, frequency);
+}
+
+bool start_fiber_histograms() noexcept {
+    // calibrate the time-stamp counter before the first value is recorded
+    detail::timestamp_frequency();
+    histogram_start.store( detail::timestamp(), std::memory_order_relaxed);
+    return add_fiber_hooks( & histogram_hooks);
+}
+
+void stop_fiber_histograms() noexcept {
+    remove_fiber_hooks( & histogram_hooks);
+}
+
+void reset_fiber_histograms() noexcept {
+    for ( thread_histograms * h = histograms.load( std::memory_order_acquire); nullptr != h; h = h->next) {
+        h->delay.clear();
+        h->slice.clear();
+    }
+}
+
+fiber_histograms fiber_histograms_snapshot() {
+    fiber_histograms merged;
+    merged.scheduling_delay.frequency = detail::timestamp_frequency();
+    merged.run_slice.frequency = merged.scheduling_delay.frequency;
+    for ( thread_histograms * h = histograms.load( std::memory_order_acquire); nullptr != h; h = h->next) {
+        fiber_histograms t = snapshot_of( * h);
+        merged.scheduling_delay.merge( t.scheduling_delay);
+        merged.run_slice.merge( t.run_slice);
+    }
+    return merged;
+}
+
+std::vector< fiber_histograms > fiber_histograms_per_thread() {
+    std::vector< fiber_histograms > result;
+    for ( thread_histograms * h = histograms.load( std::memory_order_acquire); nullptr != h; h = h->next) {
+        result.push_back( snapshot_of( * h) );
+    }
+    return result;
+}
+
+void write_fiber_histograms_prometheus( std::ostream & os) {
+    fiber_histograms h = fiber_histograms_snapshot();
+    write_prometheus( os, "boost_context_fiber_scheduling_delay_seconds",
+            "Time between suspension (or creation) and resumption of a fiber.",
+            h.scheduling_delay);
+    write_prometheus( os, "boost_context_fiber_run_slice_seconds",
+            "Time a fiber runs until it is suspended or terminates.",
+            h.run_slice);
+}
+
+void write_fiber_histograms_prometheus( std::function< void( std::string const&) > const& fn) {
+    std::ostringstream os;
+    write_fiber_histograms_prometheus( os);
+    fn( os.str() );
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,220 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_hooks.hpp"
+
+#include <cstring>
+#include <new>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace detail {
+BOOST_CONTEXT_FIBER_ABI_BEGIN
+
+std::atomic< std::size_t > fiber_hooks_installed{ 0 };
+
+std::atomic< std::uint64_t > fiber_next_id{ 0 };
+
+// zero-initialization
+static std::atomic< fiber_hooks const* > tables[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+// per index: bumped each time a table is installed
+static std::atomic< std::uint32_t > generations[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+// per index: the table the per-context data belongs to, kept after removal
+// until another table is installed at the index
+static std::atomic< fiber_hooks const* > owners[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+
+namespace {
+
+constexpr std::size_t aligned( std::size_t size) noexcept {
+    return ( size + 15) & ~ std::size_t( 15);
+}
+
+// start of the per-context data of a context, followed by the data of the
+// tables
+struct data_header {
+    // generation of the index the data belongs to, 0 if none
+    std::atomic< std::uint32_t >    generation[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+    std::uint16_t                   offset[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+    std::uint16_t                   size[BOOST_CONTEXT_MAX_FIBER_HOOKS];
+};
+
+constexpr std::size_t header_size = aligned( sizeof( data_header) );
+constexpr std::size_t max_data_size = aligned( BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA);
+
+// per-context data of the main context: each index at a fixed offset,
+// zero-filled by the owning thread when a table has been installed
+struct main_data {
+    data_header                     header;
+    alignas( 16) unsigned char      data[BOOST_CONTEXT_MAX_FIBER_HOOKS][max_data_size];
+};
+
+thread_local main_data local_main;
+
+void refresh_main( fiber_info * info) noexcept {
+    main_data & m = local_main;
+    if ( BOOST_UNLIKELY( nullptr == info->data) ) {
+        for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+            m.header.offset[i] = static_cast< std::uint16_t >(
+                    reinterpret_cast< unsigned char * >( m.data[i]) - reinterpret_cast< unsigned char * >( & m.header) );
+            m.header.size[i] = static_cast< std::uint16_t >( max_data_size);
+        }
+        info->data = & m.header;
+    }
+    if ( & m.header != info->data) {
+        // the main context of another thread
+        return;
+    }
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        std::uint32_t generation = generations[i].load( std::memory_order_acquire);
+        if ( BOOST_UNLIKELY( generation != m.header.generation[i].load( std::memory_order_relaxed) ) ) {
+            std::memset( m.data[i], 0, max_data_size);
+            m.header.generation[i].store( generation, std::memory_order_release);
+        }
+    }
+}
+
+}
+
+std::size_t fiber_hooks_data_size() noexcept {
+    std::size_t size = header_size;
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* hooks = tables[i].load( std::memory_order_acquire);
+        if ( nullptr != hooks) {
+            size += aligned( hooks->data_size);
+        }
+    }
+    return size;
+}
+
+void fiber_hooks_data_init( fiber_info * info, void * data, std::size_t size) noexcept {
+    if ( size < header_size) {
+        return;
+    }
+    data_header * header = ::new ( data) data_header;
+    std::size_t offset = header_size;
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        std::uint32_t generation = generations[i].load( std::memory_order_acquire);
+        fiber_hooks const* hooks = tables[i].load( std::memory_order_acquire);
+        std::size_t bytes = nullptr != hooks ? aligned( hooks->data_size) : 0;
+        if ( 0 == bytes || offset + bytes > size) {
+            // tables installed meanwhile get no data
+            generation = 0;
+            bytes = 0;
+        }
+        std::memset( static_cast< unsigned char * >( data) + offset, 0, bytes);
+        header->offset[i] = static_cast< std::uint16_t >( offset);
+        header->size[i] = static_cast< std::uint16_t >( bytes);
+        header->generation[i].store( generation, std::memory_order_relaxed);
+        offset += bytes;
+    }
+    info->data = header;
+}
+
+void fiber_hooks_create( fiber_info * info) noexcept {
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* hooks = tables[i].load( std::memory_order_acquire);
+        if ( nullptr != hooks && nullptr != hooks->on_create) {
+            hooks->on_create( info);
+        }
+    }
+}
+
+void fiber_hooks_switch( fiber_info * from, fiber_info * to, fiber_switch kind) noexcept {
+    if ( nullptr == from->sctx.sp) {
+        refresh_main( from);
+    }
+    if ( nullptr == to->sctx.sp) {
+        refresh_main( to);
+    }
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* hooks = tables[i].load( std::memory_order_acquire);
+        if ( nullptr != hooks && nullptr != hooks->on_switch) {
+            hooks->on_switch( from, to, kind);
+        }
+    }
+}
+
+void fiber_hooks_terminate( fiber_info * info) noexcept {
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* hooks = tables[i].load( std::memory_order_acquire);
+        if ( nullptr != hooks && nullptr != hooks->on_terminate) {
+            hooks->on_terminate( info);
+        }
+    }
+}
+
+BOOST_CONTEXT_FIBER_ABI_END
+}
+
+bool add_fiber_hooks( fiber_hooks const* hooks) noexcept {
+    BOOST_ASSERT( nullptr != hooks);
+    if ( BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA < hooks->data_size) {
+        return false;
+    }
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* expected = nullptr;
+        if ( detail::tables[i].compare_exchange_strong( expected, hooks, std::memory_order_acq_rel) ) {
+            // the data of contexts created before is not handed out
+            detail::generations[i].fetch_add( 1, std::memory_order_acq_rel);
+            detail::owners[i].store( hooks, std::memory_order_release);
+            hooks->slot.store( i + 1, std::memory_order_release);
+            detail::fiber_hooks_installed.fetch_add( 1, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+void remove_fiber_hooks( fiber_hooks const* hooks) noexcept {
+    for ( std::size_t i = 0; i < BOOST_CONTEXT_MAX_FIBER_HOOKS; ++i) {
+        fiber_hooks const* expected = hooks;
+        if ( detail::tables[i].compare_exchange_strong( expected, nullptr, std::memory_order_acq_rel) ) {
+            detail::fiber_hooks_installed.fetch_sub( 1, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void * fiber_hooks_data( fiber_hooks const* hooks, fiber_info const* info) noexcept {
+    detail::data_header * header = static_cast< detail::data_header * >( info->data);
+    if ( nullptr == header) {
+        return nullptr;
+    }
+    // index cached by add_fiber_hooks()
+    std::size_t slot = hooks->slot.load( std::memory_order_acquire);
+    if ( 0 == slot) {
+        return nullptr;
+    }
+    std::size_t i = slot - 1;
+    if ( hooks != detail::owners[i].load( std::memory_order_acquire) ) {
+        // the index has been taken over by another table
+        return nullptr;
+    }
+    std::uint32_t generation = header->generation[i].load( std::memory_order_acquire);
+    if ( 0 == generation ||
+         generation != detail::generations[i].load( std::memory_order_relaxed) ||
+         header->size[i] < hooks->data_size) {
+        return nullptr;
+    }
+    return reinterpret_cast< unsigned char * >( header) + header->offset[i];
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,177 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_memory.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <utility>
+
+#include <boost/config.hpp>
+#include <boost/core/demangle.hpp>
+
+#include "boost/context/fiber_registry.hpp"
+#include "boost/context/stack_traits.hpp"
+
+#if ! defined(BOOST_WINDOWS)
+extern "C" {
+# include <sys/mman.h>
+}
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+typedef std::vector< std::pair< std::uintptr_t, std::uintptr_t > > ranges_t;
+
+#if defined(__linux__)
+typedef unsigned char   mincore_t;
+#else
+typedef char            mincore_t;
+#endif
+
+// readable and writable mappings of the process, sorted by address;
+// empty if not known (not Linux)
+ranges_t writable_mappings() {
+    ranges_t ranges;
+#if defined(__linux__)
+    std::ifstream maps{ "/proc/self/maps" };
+    std::string line;
+    while ( std::getline( maps, line) ) {
+        unsigned long long begin = 0, end = 0;
+        char perms[5] = { 0 };
+        if ( 3 == std::sscanf( line.c_str(), "%llx-%llx %4s", & begin, & end, perms) &&
+             'r' == perms[0] && 'w' == perms[1]) {
+            ranges.emplace_back( static_cast< std::uintptr_t >( begin), static_cast< std::uintptr_t >( end) );
+        }
+    }
+#endif
+    return ranges;
+}
+
+std::size_t overlap( ranges_t const& ranges, std::uintptr_t begin, std::uintptr_t end) noexcept {
+    std::size_t size = 0;
+    ranges_t::const_iterator i = std::partition_point( ranges.begin(), ranges.end(),
+            [begin]( std::pair< std::uintptr_t, std::uintptr_t > const& r) {
+                return r.second <= begin;
+            });
+    for ( ; i != ranges.end() && i->first < end; ++i) {
+        size += (std::min)( end, i->second) - (std::max)( begin, i->first);
+    }
+    return size;
+}
+
+std::size_t resident( std::uintptr_t begin, std::uintptr_t end, std::vector< mincore_t > & vec) {
+#if ! defined(BOOST_WINDOWS)
+    std::uintptr_t const page = static_cast< std::uintptr_t >( stack_traits::page_size() );
+    std::uintptr_t first = begin & ~( page - 1);
+    std::uintptr_t last = ( end + page - 1) & ~( page - 1);
+    vec.resize( ( last - first) / page);
+    if ( vec.empty() || 0 != ::mincore( reinterpret_cast< void * >( first), last - first, vec.data() ) ) {
+        return 0;
+    }
+    std::size_t pages = 0;
+    for ( mincore_t v : vec) {
+        pages += v & 1;
+    }
+    return pages * page;
+#else
+    ( void) begin;
+    ( void) end;
+    ( void) vec;
+    return 0;
+#endif
+}
+
+}
+
+std::vector< fiber_stack > fiber_stacks() {
+    ranges_t const ranges = writable_mappings();
+    std::vector< mincore_t > vec;
+    std::vector< fiber_stack > stacks;
+    stacks.reserve( fiber_count() );
+    for_each_fiber(
+        [&ranges,&vec,&stacks]( fiber_info & info) {
+            fiber_stack s;
+            s.id = info.id;
+            s.label = info.label;
+            s.allocator = info.allocator;
+            s.state = fiber_state_of( & info);
+            s.end = info.sctx.sp;
+            s.begin = static_cast< char * >( info.sctx.sp) - info.sctx.size;
+            s.reserved = info.sctx.size;
+            std::uintptr_t begin = reinterpret_cast< std::uintptr_t >( s.begin);
+            std::uintptr_t end = reinterpret_cast< std::uintptr_t >( s.end);
+            s.committed = ranges.empty() ? s.reserved : overlap( ranges, begin, end);
+            s.resident = resident( begin, end, vec);
+            stacks.push_back( s);
+        });
+    return stacks;
+}
+
+std::vector< fiber_memory > fiber_memory_report() {
+    std::map< std::string, fiber_memory > allocators;
+    for ( fiber_stack const& s : fiber_stacks() ) {
+        std::string name = nullptr != s.allocator ? s.allocator : "";
+        fiber_memory & m = allocators[name];
+        ++m.fibers;
+        m.reserved += s.reserved;
+        m.committed += s.committed;
+        m.resident += s.resident;
+    }
+    std::vector< fiber_memory > report;
+    for ( auto & a : allocators) {
+        a.second.allocator = a.first.empty() ? std::string{ "unknown" } : boost::core::demangle( a.first.c_str() );
+        report.push_back( std::move( a.second) );
+    }
+    return report;
+}
+
+void write_fiber_memory_report( std::ostream & os) {
+    std::vector< fiber_memory > report = fiber_memory_report();
+    fiber_memory total;
+    total.allocator = "total";
+    std::size_t width = total.allocator.size();
+    for ( fiber_memory const& m : report) {
+        width = (std::max)( width, m.allocator.size() );
+        total.fibers += m.fibers;
+        total.reserved += m.reserved;
+        total.committed += m.committed;
+        total.resident += m.resident;
+    }
+    report.push_back( total);
+    os << std::left << std::setw( width) << "allocator" << std::right
+       << std::setw( 12) << "fibers"
+       << std::setw( 16) << "reserved KiB"
+       << std::setw( 16) << "committed KiB"
+       << std::setw( 16) << "resident KiB" << '\n';
+    for ( fiber_memory const& m : report) {
+        os << std::left << std::setw( width) << m.allocator << std::right
+           << std::setw( 12) << m.fibers
+           << std::setw( 16) << m.reserved / 1024
+           << std::setw( 16) << m.committed / 1024
+           << std::setw( 16) << m.resident / 1024 << '\n';
+    }
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,354 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/frame_walk.hpp"
+#include "boost/context/fiber_backtrace.hpp"
+#include "boost/context/fiber_registry.hpp"
+
+#if defined(BOOST_CONTEXT_HAS_INTERRUPTED_FRAME)
+# define BOOST_CONTEXT_PROFILER_SUPPORTED
+extern "C" {
+# include <signal.h>
+# include <sys/time.h>
+}
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+
+constexpr std::size_t max_frames = BOOST_CONTEXT_PROFILER_MAX_FRAMES;
+
+struct sample {
+    // set after the sample has been written
+    std::atomic< bool >     ready{ false };
+    bool                    parked{ false };
+    std::uint32_t           depth{ 0 };
+    // thread index, 0 if the thread did not switch since the start
+    std::uint32_t           thread{ 0 };
+    // 0 for the main context of a thread
+    std::uint64_t           fiber{ 0 };
+    char const          *   label{ nullptr };
+    void                *   pcs[max_frames];
+};
+
+// filled by the signal handlers (lock-free), read after stop
+std::atomic< sample * >     samples{ nullptr };
+std::size_t                 sample_capacity{ 0 };
+std::atomic< std::size_t >  sample_next{ 0 };
+std::atomic< std::size_t >  sample_dropped{ 0 };
+std::atomic< std::uint32_t > thread_count{ 0 };
+struct sigaction            old_action;
+// between start_fiber_profiler() and stop_fiber_profiler()
+std::atomic< bool >         started{ false };
+// handlers record samples only while set
+std::atomic< bool >         sampling{ false };
+// handlers executing; stop_fiber_profiler() waits until they have left
+std::atomic< std::size_t >  handlers{ 0 };
+
+// trivially constructible: accessed from the signal handler
+struct thread_state {
+    fiber_info          *   running;
+    char                *   low;
+    char                *   high;
+    std::uint32_t           index;
+};
+
+thread_local thread_state local_state;
+
+void init_thread( thread_state & ts) noexcept {
+    ts.index = thread_count.fetch_add( 1, std::memory_order_relaxed) + 1;
+    detail::thread_stack( ts.low, ts.high);
+}
+
+// the stack of `info` running on the thread described by `ts`
+void bounds_of( fiber_info const* info, thread_state const& ts, char *& low, char *& high) noexcept {
+    if ( nullptr != info && nullptr != info->sctx.sp) {
+        high = static_cast< char * >( info->sctx.sp);
+        low = high - info->sctx.size;
+    } else {
+        low = ts.low;
+        high = ts.high;
+    }
+}
+
+void walk( sample & s, void * pc, char * fp, char const* low, char const* high) noexcept {
+    s.depth = static_cast< std::uint32_t >( detail::walk_frames( s.pcs, max_frames, pc, fp, low, high) );
+}
+
+sample * claim() noexcept {
+    sample * buffer = samples.load( std::memory_order_acquire);
+    if ( nullptr == buffer) {
+        return nullptr;
+    }
+    std::size_t i = sample_next.fetch_add( 1, std::memory_order_relaxed);
+    if ( i >= sample_capacity) {
+        sample_dropped.fetch_add( 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return buffer + i;
+}
+
+void on_sigprof( int, siginfo_t *, void * vp) {
+    int saved_errno = errno;
+    // pairs with stop_fiber_profiler(): either the handler sees `sampling`
+    // cleared or stop waits for it
+    handlers.fetch_add( 1, std::memory_order_seq_cst);
+    sample * s = sampling.load( std::memory_order_seq_cst) ? claim() : nullptr;
+    if ( nullptr != s) {
+        void * pc = nullptr;
+        char * fp = nullptr;
+        char * sp = nullptr;
+        detail::interrupted_frame( vp, pc, fp, sp);
+        thread_state const& ts = local_state;
+        fiber_info * running = ts.running;
+        char * low = nullptr;
+        char * high = nullptr;
+        bounds_of( running, ts, low, high);
+        if ( sp < low || sp >= high) {
+            // interrupted inside a context switch: the stack pointer does
+            // not belong to the fiber, record the program counter only
+            high = nullptr;
+        }
+        s->parked = false;
+        s->thread = ts.index;
+        s->fiber = nullptr != running && nullptr != running->sctx.sp ? running->id : 0;
+        s->label = nullptr != running ? running->label : nullptr;
+        walk( * s, pc, fp, sp, high);
+        s->ready.store( true, std::memory_order_release);
+    }
+    handlers.fetch_sub( 1, std::memory_order_release);
+    errno = saved_errno;
+}
+
+// per-context data: innermost frame of the suspended context
+struct parked {
+    std::atomic< void * >   fp;
+    std::atomic< void * >   pc;
+};
+
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+
+fiber_hooks const profiler_hooks{ nullptr, on_switch, nullptr, sizeof( parked), {} };
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch kind) noexcept {
+    thread_state & ts = local_state;
+    if ( BOOST_UNLIKELY( 0 == ts.index) ) {
+        init_thread( ts);
+    }
+    parked * p = fiber_switch::exit != kind
+        ? static_cast< parked * >( fiber_hooks_data( & profiler_hooks, from) )
+        : nullptr;
+    if ( nullptr != p) {
+        char * low = nullptr;
+        char * high = nullptr;
+        bounds_of( from, ts, low, high);
+        void * parked_fp = nullptr;
+        void * parked_pc = nullptr;
+        detail::parked_frame( static_cast< char * >( __builtin_frame_address( 0) ), low, high,
+                              parked_fp, parked_pc);
+        p->fp.store( parked_fp, std::memory_order_relaxed);
+        p->pc.store( parked_pc, std::memory_order_relaxed);
+    }
+    ts.running = to;
+}
+
+#endif
+
+}
+
+bool start_fiber_profiler( std::chrono::microseconds interval, std::size_t capacity) noexcept {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    if ( started.exchange( true, std::memory_order_acquire) ) {
+        return false;
+    }
+    // stopped: no handler uses the buffer
+    if ( nullptr == samples.load( std::memory_order_relaxed) || capacity != sample_capacity) {
+        delete [] samples.exchange( nullptr, std::memory_order_acq_rel);
+        sample_capacity = 0;
+        sample * buffer = new ( std::nothrow) sample[capacity];
+        if ( nullptr == buffer) {
+            started.store( false, std::memory_order_release);
+            return false;
+        }
+        sample_capacity = capacity;
+        sample_next.store( 0, std::memory_order_relaxed);
+        samples.store( buffer, std::memory_order_release);
+    }
+    if ( ! start_fiber_registry() ) {
+        started.store( false, std::memory_order_release);
+        return false;
+    }
+    if ( ! add_fiber_hooks( & profiler_hooks) ) {
+        stop_fiber_registry();
+        started.store( false, std::memory_order_release);
+        return false;
+    }
+    // the calling thread might be interrupted before its first switch
+    if ( 0 == local_state.index) {
+        init_thread( local_state);
+    }
+    struct sigaction action;
+    std::memset( & action, 0, sizeof( action) );
+    action.sa_sigaction = on_sigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    ::sigemptyset( & action.sa_mask);
+    sampling.store( true, std::memory_order_seq_cst);
+    ::sigaction( SIGPROF, & action, & old_action);
+    struct itimerval timer;
+    timer.it_interval.tv_sec = static_cast< time_t >( interval.count() / 1000000);
+    timer.it_interval.tv_usec = static_cast< suseconds_t >( interval.count() % 1000000);
+    timer.it_value = timer.it_interval;
+    ::setitimer( ITIMER_PROF, & timer, nullptr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void stop_fiber_profiler() noexcept {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    if ( ! started.load( std::memory_order_acquire) ) {
+        return;
+    }
+    struct itimerval timer;
+    std::memset( & timer, 0, sizeof( timer) );
+    ::setitimer( ITIMER_PROF, & timer, nullptr);
+    // signals still in flight on other threads do not record samples, the
+    // handlers executing are waited for: afterwards the buffer is not
+    // written and might be replaced by the next start
+    sampling.store( false, std::memory_order_seq_cst);
+    while ( 0 != handlers.load( std::memory_order_seq_cst) ) {
+        std::this_thread::yield();
+    }
+    ::sigaction( SIGPROF, & old_action, nullptr);
+    remove_fiber_hooks( & profiler_hooks);
+    stop_fiber_registry();
+    started.store( false, std::memory_order_release);
+#endif
+}
+
+void clear_fiber_profile() noexcept {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    sample * buffer = samples.load( std::memory_order_acquire);
+    std::size_t size = (std::min)( sample_next.load( std::memory_order_acquire), sample_capacity);
+    for ( std::size_t i = 0; i < size; ++i) {
+        buffer[i].ready.store( false, std::memory_order_relaxed);
+    }
+    sample_next.store( 0, std::memory_order_release);
+    sample_dropped.store( 0, std::memory_order_relaxed);
+#endif
+}
+
+std::size_t sample_parked_fibers() noexcept {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    std::size_t count = 0;
+    for_each_fiber(
+        [&count]( fiber_info & info) {
+            parked * p = static_cast< parked * >( fiber_hooks_data( & profiler_hooks, & info) );
+            if ( nullptr == p || fiber_state::suspended != fiber_state_of( & info) ) {
+                return;
+            }
+            char * fp = static_cast< char * >( p->fp.load( std::memory_order_relaxed) );
+            if ( nullptr == fp) {
+                return;
+            }
+            sample * s = claim();
+            if ( nullptr == s) {
+                return;
+            }
+            s->parked = true;
+            s->thread = 0;
+            s->fiber = info.id;
+            s->label = info.label;
+            // the fiber might be resumed meanwhile, its stack stays mapped
+            walk( * s, p->pc.load( std::memory_order_relaxed),
+                  fp, fp, static_cast< char * >( info.sctx.sp) );
+            s->ready.store( true, std::memory_order_release);
+            ++count;
+        });
+    return count;
+#else
+    return 0;
+#endif
+}
+
+std::size_t fiber_profile_dropped() noexcept {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    return sample_dropped.load( std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+void write_fiber_profile_collapsed( std::ostream & os) {
+#if defined(BOOST_CONTEXT_PROFILER_SUPPORTED)
+    sample const* buffer = samples.load( std::memory_order_acquire);
+    std::size_t size = (std::min)( sample_next.load( std::memory_order_acquire), sample_capacity);
+    std::unordered_map< void *, std::string > symbols;
+    std::map< std::string, std::size_t > stacks;
+    for ( std::size_t i = 0; i < size; ++i) {
+        sample const& s = buffer[i];
+        if ( ! s.ready.load( std::memory_order_acquire) ) {
+            continue;
+        }
+        std::string stack = s.parked ? "[parked];" : "";
+        if ( nullptr != s.label) {
+            stack += s.label;
+        } else if ( 0 != s.fiber) {
+            stack += "fiber " + std::to_string( s.fiber);
+        } else {
+            stack += "thread " + std::to_string( s.thread);
+        }
+        for ( std::uint32_t j = s.depth; 0 < j--; ) {
+            std::string & symbol = symbols[s.pcs[j]];
+            if ( symbol.empty() ) {
+                symbol = detail::frame_symbol( s.pcs[j], 0 == j && ! s.parked);
+            }
+            stack += ';';
+            stack += symbol;
+        }
+        ++stacks[stack];
+    }
+    for ( auto const& stack : stacks) {
+        os << stack.first << ' ' << stack.second << '\n';
+    }
+#else
+    ( void) os;
+#endif
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,327 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_qsbr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <boost/config.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+struct retired {
+    void                            *   p;
+    fiber_deleter                       deleter;
+};
+
+struct batch {
+    // grace period: every online thread has seen this epoch
+    std::uint64_t                       epoch;
+    std::vector< retired >              objects;
+};
+
+struct thread_record {
+    thread_record                   *   next{ nullptr };
+    std::atomic< bool >                 owned{ true };
+    // epoch seen at the last quiescent state, 0 while offline
+    std::atomic< std::uint64_t >        seen{ 0 };
+    // quiescent states since the last reclamation, owning thread only
+    std::size_t                         passed{ 0 };
+    // guards the retired objects: appended by the owning thread, sealed
+    // and deleted by threads passing quiescent states, too
+    std::mutex                          mtx{};
+    // inherited with the record
+    std::vector< retired >              current{};
+    std::vector< batch >                sealed{};
+};
+
+// never freed, records of terminated threads are reused
+std::atomic< thread_record * >      records{ nullptr };
+thread_local thread_record      *   local_record{ nullptr };
+
+std::atomic< std::uint64_t >        global_epoch{ 1 };
+
+void online( thread_record * r) noexcept {
+    r->seen.store( global_epoch.load( std::memory_order_acquire), std::memory_order_relaxed);
+    // the reads following are ordered after the store (scan() reads `seen`
+    // after a fence, too)
+    std::atomic_thread_fence( std::memory_order_seq_cst);
+}
+
+void quiescent( thread_record * r) noexcept {
+    if ( BOOST_UNLIKELY( 0 == r->seen.load( std::memory_order_relaxed) ) ) {
+        online( r);
+        return;
+    }
+    // the reads preceding happen before the deleters of objects retired
+    // before `global_epoch` has been read
+    r->seen.store( global_epoch.load( std::memory_order_acquire), std::memory_order_release);
+}
+
+// smallest epoch seen by the online threads
+std::uint64_t scan() noexcept {
+    std::atomic_thread_fence( std::memory_order_seq_cst);
+    std::uint64_t epoch = (std::numeric_limits< std::uint64_t >::max)();
+    for ( thread_record * r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+        std::uint64_t seen = r->seen.load( std::memory_order_acquire);
+        if ( 0 != seen) {
+            epoch = (std::min)( epoch, seen);
+        }
+    }
+    return epoch;
+}
+
+// retired objects wait for a grace period that starts at this point;
+// requires `r->mtx`
+void seal( thread_record * r) {
+    if ( r->current.empty() ) {
+        return;
+    }
+    r->sealed.reserve( r->sealed.size() + 1);
+    std::uint64_t epoch = global_epoch.fetch_add( 1, std::memory_order_acq_rel) + 1;
+    r->sealed.push_back( batch{ epoch, std::move( r->current) });
+    r->current.clear();
+}
+
+void try_seal( thread_record * r) noexcept {
+    std::unique_lock< std::mutex > lk{ r->mtx, std::try_to_lock };
+    if ( lk.owns_lock() ) {
+        try {
+            seal( r);
+        } catch ( std::bad_alloc const&) {
+        }
+    }
+}
+
+// deletes the batches of `r` sealed until `epoch`; skips a record in use by
+// another thread unless `wait` is set
+std::size_t reclaim( thread_record * r, std::uint64_t epoch, bool wait) noexcept {
+    std::size_t n = 0;
+    for (;;) {
+        std::vector< retired > objects;
+        {
+            std::unique_lock< std::mutex > lk{ r->mtx, std::defer_lock };
+            if ( wait) {
+                lk.lock();
+            } else if ( ! lk.try_lock() ) {
+                return n;
+            }
+            // batches are sealed in increasing order of epochs
+            if ( r->sealed.empty() || epoch < r->sealed.front().epoch) {
+                return n;
+            }
+            objects = std::move( r->sealed.front().objects);
+            r->sealed.erase( r->sealed.begin() );
+        }
+        // not holding the lock: deleters might retire objects
+        for ( retired & o : objects) {
+            o.deleter( o.p);
+        }
+        n += objects.size();
+    }
+}
+
+// seals the objects retired by the other threads and deletes the expired
+// batches of all threads; a thread that stopped retiring objects (or has
+// terminated) does not keep them alive
+std::size_t reclaim_all( thread_record * self) noexcept {
+    for ( thread_record * r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+        if ( self != r) {
+            try_seal( r);
+        }
+    }
+    std::uint64_t epoch = scan();
+    std::size_t n = 0;
+    for ( thread_record * r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+        n += reclaim( r, epoch, self == r);
+    }
+    return n;
+}
+
+void passed( thread_record * r) noexcept {
+    quiescent( r);
+    if ( BOOST_UNLIKELY( BOOST_CONTEXT_QSBR_INTERVAL <= ++r->passed) ) {
+        r->passed = 0;
+        reclaim_all( r);
+    }
+}
+
+struct record_releaser {
+    ~record_releaser() {
+        if ( nullptr != local_record) {
+            local_record->seen.store( 0, std::memory_order_release);
+            {
+                std::unique_lock< std::mutex > lk{ local_record->mtx };
+                try {
+                    seal( local_record);
+                } catch ( std::bad_alloc const&) {
+                }
+            }
+            // the remaining batches are deleted by the threads passing
+            // quiescent states
+            reclaim( local_record, scan(), true);
+            local_record->passed = 0;
+            local_record->owned.store( false, std::memory_order_release);
+            local_record = nullptr;
+        }
+    }
+};
+
+thread_record * acquire_record() noexcept {
+    // releases the record at thread exit
+    static thread_local record_releaser releaser;
+    thread_record * r = nullptr;
+    for ( r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+        bool expected = false;
+        if ( r->owned.compare_exchange_strong( expected, true, std::memory_order_acq_rel) ) {
+            break;
+        }
+    }
+    if ( nullptr == r) {
+        r = new ( std::nothrow) thread_record{};
+        if ( nullptr == r) {
+            return nullptr;
+        }
+        r->next = records.load( std::memory_order_relaxed);
+        while ( ! records.compare_exchange_weak( r->next, r, std::memory_order_release, std::memory_order_relaxed) ) {
+        }
+    }
+    // offline until the first switch (or fiber_quiescent_state(),
+    // fiber_qsbr_online()); a writer only retiring objects never delays
+    // grace periods
+    return r;
+}
+
+thread_record * local() noexcept {
+    thread_record * r = local_record;
+    if ( BOOST_UNLIKELY( nullptr == r) ) {
+        r = local_record = acquire_record();
+    }
+    return r;
+}
+
+// fiber_qsbr_mode::main_context
+void on_switch_main( fiber_info *, fiber_info * to, fiber_switch) noexcept {
+    thread_record * r = local();
+    if ( nullptr == r) {
+        return;
+    }
+    // the main context of a thread has no stack of its own
+    if ( nullptr == to->sctx.sp) {
+        passed( r);
+    } else if ( BOOST_UNLIKELY( 0 == r->seen.load( std::memory_order_relaxed) ) ) {
+        // a fiber reads shared objects from its first switch on
+        online( r);
+    }
+}
+
+// fiber_qsbr_mode::every_switch
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept {
+    thread_record * r = local();
+    if ( nullptr != r) {
+        passed( r);
+    }
+}
+
+fiber_hooks const qsbr_main_hooks{ nullptr, on_switch_main, nullptr, 0, {} };
+fiber_hooks const qsbr_hooks{ nullptr, on_switch, nullptr, 0, {} };
+
+}
+
+bool start_fiber_qsbr( fiber_qsbr_mode mode) noexcept {
+    return add_fiber_hooks( fiber_qsbr_mode::main_context == mode ? & qsbr_main_hooks : & qsbr_hooks);
+}
+
+void stop_fiber_qsbr() noexcept {
+    remove_fiber_hooks( & qsbr_main_hooks);
+    remove_fiber_hooks( & qsbr_hooks);
+}
+
+void fiber_retire( void * p, fiber_deleter deleter) {
+    thread_record * r = local();
+    if ( nullptr == r) {
+        throw std::bad_alloc{};
+    }
+    {
+        std::unique_lock< std::mutex > lk{ r->mtx };
+        r->current.push_back( retired{ p, deleter });
+        if ( BOOST_CONTEXT_QSBR_BATCH > r->current.size() ) {
+            return;
+        }
+        // `p` is retired, the batch waits for the next call if sealing fails
+        try {
+            seal( r);
+        } catch ( std::bad_alloc const&) {
+            return;
+        }
+    }
+    reclaim( r, scan(), true);
+}
+
+void fiber_quiescent_state() noexcept {
+    thread_record * r = local();
+    if ( nullptr != r) {
+        passed( r);
+    }
+}
+
+void fiber_qsbr_offline() noexcept {
+    thread_record * r = local();
+    if ( nullptr != r) {
+        r->seen.store( 0, std::memory_order_release);
+    }
+}
+
+void fiber_qsbr_online() noexcept {
+    thread_record * r = local();
+    if ( nullptr != r) {
+        online( r);
+    }
+}
+
+std::size_t fiber_qsbr_reclaim() noexcept {
+    thread_record * r = local();
+    if ( nullptr == r) {
+        return 0;
+    }
+    {
+        std::unique_lock< std::mutex > lk{ r->mtx };
+        try {
+            seal( r);
+        } catch ( std::bad_alloc const&) {
+        }
+    }
+    // after sealing, the batch does not wait for the calling thread; an
+    // offline thread stays offline
+    if ( 0 != r->seen.load( std::memory_order_relaxed) ) {
+        quiescent( r);
+    }
+    return reclaim_all( r);
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
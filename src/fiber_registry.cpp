@@ -0,0 +1,250 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_registry.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+// registered fibers are kept in slots, allocated in chunks which are never
+// freed (up to 16M fibers)
+constexpr std::size_t chunk_size = 4096;
+constexpr std::size_t max_chunks = 4096;
+constexpr std::uint32_t no_slot = ~std::uint32_t( 0);
+
+struct slot {
+    std::atomic< fiber_info * >     info{ nullptr };
+    // visitors currently reading info
+    std::atomic< std::uint32_t >    pins{ 0 };
+    // next free slot
+    std::atomic< std::uint32_t >    next{ no_slot };
+};
+
+std::atomic< slot * >           chunks[max_chunks];
+// slots handed out so far
+std::atomic< std::uint32_t >    high{ 0 };
+// free slots: Treiber stack, the tag in the upper half prevents ABA
+std::atomic< std::uint64_t >    free_head{ no_slot };
+std::atomic< std::size_t >      registered{ 0 };
+
+std::mutex                      users_mtx;
+std::size_t                     users{ 0 };
+
+slot * slot_of( std::uint32_t index) noexcept {
+    std::atomic< slot * > & chunk = chunks[index / chunk_size];
+    slot * s = chunk.load( std::memory_order_acquire);
+    if ( BOOST_UNLIKELY( nullptr == s) ) {
+        slot * fresh = new ( std::nothrow) slot[chunk_size];
+        if ( nullptr == fresh) {
+            return nullptr;
+        }
+        if ( chunk.compare_exchange_strong( s, fresh, std::memory_order_acq_rel) ) {
+            s = fresh;
+        } else {
+            delete [] fresh;
+        }
+    }
+    return s + index % chunk_size;
+}
+
+std::uint32_t pop_free() noexcept {
+    std::uint64_t head = free_head.load( std::memory_order_acquire);
+    while ( no_slot != static_cast< std::uint32_t >( head) ) {
+        std::uint32_t index = static_cast< std::uint32_t >( head);
+        std::uint64_t next = slot_of( index)->next.load( std::memory_order_relaxed);
+        std::uint64_t desired = ( ( head >> 32) + 1) << 32 | next;
+        if ( free_head.compare_exchange_weak( head, desired, std::memory_order_acq_rel) ) {
+            return index;
+        }
+    }
+    return no_slot;
+}
+
+void push_free( std::uint32_t index) noexcept {
+    slot * s = slot_of( index);
+    std::uint64_t head = free_head.load( std::memory_order_relaxed);
+    std::uint64_t desired;
+    do {
+        s->next.store( static_cast< std::uint32_t >( head), std::memory_order_relaxed);
+        desired = ( ( head >> 32) + 1) << 32 | index;
+    } while ( ! free_head.compare_exchange_weak( head, desired, std::memory_order_acq_rel) );
+}
+
+// per-context data
+struct registration {
+    std::atomic< fiber_state >      state;
+    // index of the slot + 1, 0 if not registered
+    std::uint32_t                   slot;
+};
+
+void on_create( fiber_info *) noexcept;
+void on_switch( fiber_info *, fiber_info *, fiber_switch) noexcept;
+void on_terminate( fiber_info *) noexcept;
+
+fiber_hooks const registry_hooks{ on_create, on_switch, on_terminate, sizeof( registration), {} };
+
+registration * registration_of( fiber_info const* info) noexcept {
+    return static_cast< registration * >( fiber_hooks_data( & registry_hooks, info) );
+}
+
+void on_create( fiber_info * info) noexcept {
+    registration * r = registration_of( info);
+    if ( nullptr == r) {
+        return;
+    }
+    std::uint32_t index = pop_free();
+    if ( no_slot == index) {
+        index = high.fetch_add( 1, std::memory_order_relaxed);
+        if ( index >= chunk_size * max_chunks) {
+            high.fetch_sub( 1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    slot * s = slot_of( index);
+    if ( nullptr == s) {
+        // out of memory, the fiber is not registered
+        return;
+    }
+    r->slot = index + 1;
+    s->info.store( info, std::memory_order_seq_cst);
+    registered.fetch_add( 1, std::memory_order_relaxed);
+}
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch) noexcept {
+    registration * r = registration_of( from);
+    if ( nullptr != r) {
+        r->state.store( fiber_state::suspended, std::memory_order_relaxed);
+    }
+    r = registration_of( to);
+    if ( nullptr != r) {
+        r->state.store( fiber_state::running, std::memory_order_relaxed);
+    }
+}
+
+void on_terminate( fiber_info * info) noexcept {
+    registration * r = registration_of( info);
+    if ( nullptr == r || 0 == r->slot) {
+        return;
+    }
+    std::uint32_t index = r->slot - 1;
+    r->slot = 0;
+    slot * s = slot_of( index);
+    fiber_info * expected = info;
+    if ( ! s->info.compare_exchange_strong( expected, nullptr, std::memory_order_seq_cst) ) {
+        // registered before the registry was restarted
+        return;
+    }
+    // the stack is deallocated after return; wait for visitors
+    while ( 0 != s->pins.load( std::memory_order_seq_cst) ) {
+        std::this_thread::yield();
+    }
+    registered.fetch_sub( 1, std::memory_order_relaxed);
+    push_free( index);
+}
+
+struct unpin {
+    slot    *   s;
+
+    ~unpin() {
+        s->pins.fetch_sub( 1, std::memory_order_seq_cst);
+    }
+};
+
+}
+
+namespace detail {
+
+void visit_fibers( void (* visitor)( fiber_info &, void *), void * vp) {
+    std::uint32_t size = high.load( std::memory_order_acquire);
+    for ( std::uint32_t index = 0; index < size; ++index) {
+        slot * s = chunks[index / chunk_size].load( std::memory_order_acquire);
+        if ( nullptr == s) {
+            continue;
+        }
+        s += index % chunk_size;
+        if ( nullptr == s->info.load( std::memory_order_relaxed) ) {
+            continue;
+        }
+        s->pins.fetch_add( 1, std::memory_order_seq_cst);
+        unpin guard{ s };
+        fiber_info * info = s->info.load( std::memory_order_seq_cst);
+        if ( nullptr != info) {
+            visitor( * info, vp);
+        }
+    }
+}
+
+}
+
+bool start_fiber_registry() noexcept {
+    std::unique_lock< std::mutex > lk{ users_mtx };
+    if ( 0 == users) {
+        if ( ! add_fiber_hooks( & registry_hooks) ) {
+            return false;
+        }
+    }
+    ++users;
+    return true;
+}
+
+void stop_fiber_registry() noexcept {
+    std::unique_lock< std::mutex > lk{ users_mtx };
+    BOOST_ASSERT( 0 < users);
+    if ( 0 != --users) {
+        return;
+    }
+    remove_fiber_hooks( & registry_hooks);
+    // fibers still alive are forgotten
+    std::uint32_t size = high.load( std::memory_order_acquire);
+    for ( std::uint32_t index = 0; index < size; ++index) {
+        slot * s = chunks[index / chunk_size].load( std::memory_order_acquire);
+        if ( nullptr == s) {
+            continue;
+        }
+        s += index % chunk_size;
+        s->info.store( nullptr, std::memory_order_seq_cst);
+        while ( 0 != s->pins.load( std::memory_order_seq_cst) ) {
+            std::this_thread::yield();
+        }
+    }
+    free_head.store( no_slot, std::memory_order_relaxed);
+    high.store( 0, std::memory_order_release);
+    registered.store( 0, std::memory_order_relaxed);
+}
+
+std::size_t fiber_count() noexcept {
+    return registered.load( std::memory_order_relaxed);
+}
+
+fiber_state fiber_state_of( fiber_info const* info) noexcept {
+    registration const* r = registration_of( info);
+    return nullptr != r ? r->state.load( std::memory_order_relaxed) : fiber_state::created;
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
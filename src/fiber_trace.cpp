@@ -0,0 +1,490 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#include "boost/context/detail/timestamp.hpp"
+
+#if defined(BOOST_WINDOWS)
+# include <process.h>
+#else
+extern "C" {
+# include <unistd.h>
+}
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+enum trace_type : std::uint32_t {
+    // values of fiber_switch
+    trace_resume = 0,
+    trace_resume_with,
+    trace_unwind,
+    trace_exit,
+    trace_create,
+    trace_terminate
+};
+
+// flags
+static constexpr std::uint32_t from_main = 1;
+static constexpr std::uint32_t to_main = 2;
+
+struct trace_event {
+    std::uint64_t       tsc;
+    std::uint64_t       from;
+    std::uint64_t       to;
+    // label of the suspended context (switch) or of the created/terminated fiber
+    char const      *   label;
+    std::uint32_t       type;
+    std::uint32_t       flags;
+};
+
+// slot of the ring buffer, guarded by a sequence lock: `seq` is odd while the
+// producer writes the event with index i and 2*i+2 afterwards, a reader keeps
+// a copy only if it has seen 2*i+2 before and after copying
+struct trace_slot {
+    std::atomic< std::uint64_t >        seq{ 0 };
+    std::atomic< std::uint64_t >        tsc{ 0 };
+    std::atomic< std::uint64_t >        from{ 0 };
+    std::atomic< std::uint64_t >        to{ 0 };
+    std::atomic< char const* >          label{ nullptr };
+    std::atomic< std::uint32_t >        type{ 0 };
+    std::atomic< std::uint32_t >        flags{ 0 };
+
+    void store( std::uint64_t i, trace_event const& e) noexcept {
+        seq.store( 2 * i + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence( std::memory_order_release);
+        tsc.store( e.tsc, std::memory_order_relaxed);
+        from.store( e.from, std::memory_order_relaxed);
+        to.store( e.to, std::memory_order_relaxed);
+        label.store( e.label, std::memory_order_relaxed);
+        type.store( e.type, std::memory_order_relaxed);
+        flags.store( e.flags, std::memory_order_relaxed);
+        seq.store( 2 * i + 2, std::memory_order_release);
+    }
+
+    bool load( std::uint64_t i, trace_event & e) const noexcept {
+        if ( 2 * i + 2 != seq.load( std::memory_order_acquire) ) {
+            return false;
+        }
+        e.tsc = tsc.load( std::memory_order_relaxed);
+        e.from = from.load( std::memory_order_relaxed);
+        e.to = to.load( std::memory_order_relaxed);
+        e.label = label.load( std::memory_order_relaxed);
+        e.type = type.load( std::memory_order_relaxed);
+        e.flags = flags.load( std::memory_order_relaxed);
+        std::atomic_thread_fence( std::memory_order_acquire);
+        return 2 * i + 2 == seq.load( std::memory_order_relaxed);
+    }
+};
+
+// single producer (owning thread), read by the writer functions
+struct trace_buffer {
+    trace_buffer                    *   next{ nullptr };
+    std::atomic< bool >                 owned{ true };
+    std::size_t                         index;
+    std::size_t                         capacity;
+    std::unique_ptr< trace_slot[] >     events;
+    std::atomic< std::uint64_t >        head{ 0 };
+
+    trace_buffer( std::size_t index_, std::size_t capacity_, trace_slot * events_) noexcept :
+        index{ index_ },
+        capacity{ capacity_ },
+        events{ events_ } {
+    }
+};
+
+// ring buffers are never freed, buffers of terminated threads are reused
+std::atomic< trace_buffer * >   buffers{ nullptr };
+std::atomic< std::size_t >      buffer_count{ 0 };
+std::atomic< std::size_t >      trace_capacity{ 65536 };
+std::atomic< std::uint64_t >    trace_start{ 0 };
+thread_local trace_buffer   *   local_buffer{ nullptr };
+
+struct buffer_releaser {
+    ~buffer_releaser() {
+        if ( nullptr != local_buffer) {
+            local_buffer->owned.store( false, std::memory_order_release);
+            local_buffer = nullptr;
+        }
+    }
+};
+
+trace_buffer * acquire_buffer() noexcept {
+    // releases the ring buffer at thread exit
+    static thread_local buffer_releaser releaser;
+    std::size_t capacity = trace_capacity.load( std::memory_order_relaxed);
+    for ( trace_buffer * b = buffers.load( std::memory_order_acquire); nullptr != b; b = b->next) {
+        bool expected = false;
+        if ( b->capacity == capacity &&
+             b->owned.compare_exchange_strong( expected, true, std::memory_order_acq_rel) ) {
+            // the events of the terminated thread would be written on the
+            // track of this thread; the slots of indices below the head
+            // are rewritten before they are read again
+            b->head.store( 0, std::memory_order_release);
+            return b;
+        }
+    }
+    trace_slot * events = new ( std::nothrow) trace_slot[capacity];
+    if ( nullptr == events) {
+        return nullptr;
+    }
+    trace_buffer * b = new ( std::nothrow) trace_buffer{
+        buffer_count.fetch_add( 1, std::memory_order_relaxed) + 1, capacity, events };
+    if ( nullptr == b) {
+        delete [] events;
+        return nullptr;
+    }
+    b->next = buffers.load( std::memory_order_relaxed);
+    while ( ! buffers.compare_exchange_weak( b->next, b, std::memory_order_release, std::memory_order_relaxed) ) {
+    }
+    return b;
+}
+
+inline
+void record( std::uint32_t type, fiber_info * from, fiber_info * to, char const* label) noexcept {
+    trace_buffer * b = local_buffer;
+    if ( BOOST_UNLIKELY( nullptr == b) ) {
+        b = local_buffer = acquire_buffer();
+        if ( nullptr == b) {
+            return;
+        }
+    }
+    std::uint64_t h = b->head.load( std::memory_order_relaxed);
+    trace_event e;
+    e.tsc = detail::timestamp();
+    e.type = type;
+    e.flags = 0;
+    e.from = 0;
+    e.to = 0;
+    if ( nullptr != from) {
+        e.from = from->id;
+        e.flags |= nullptr == from->sctx.sp ? from_main : 0;
+    }
+    if ( nullptr != to) {
+        e.to = to->id;
+        e.flags |= nullptr == to->sctx.sp ? to_main : 0;
+    }
+    e.label = label;
+    b->events[h & ( b->capacity - 1)].store( h, e);
+    b->head.store( h + 1, std::memory_order_release);
+}
+
+void on_create( fiber_info * info) {
+    record( trace_create, nullptr, info, info->label);
+}
+
+void on_switch( fiber_info * from, fiber_info * to, fiber_switch kind) {
+    record( static_cast< std::uint32_t >( kind), from, to, from->label);
+}
+
+void on_terminate( fiber_info * info) {
+    record( trace_terminate, info, nullptr, info->label);
+}
+
+fiber_hooks trace_hooks{ on_create, on_switch, on_terminate, 0, {} };
+
+struct thread_trace {
+    std::size_t                 index;
+    std::vector< trace_event >  events;
+};
+
+// copies the ring buffers; events being written or overwritten while
+// copying are dropped
+std::vector< thread_trace > snapshot() {
+    std::vector< thread_trace > traces;
+    for ( trace_buffer * b = buffers.load( std::memory_order_acquire); nullptr != b; b = b->next) {
+        std::uint64_t head = b->head.load( std::memory_order_acquire);
+        std::uint64_t size = (std::min)( head, static_cast< std::uint64_t >( b->capacity) );
+        if ( 0 == size) {
+            continue;
+        }
+        thread_trace t;
+        t.index = b->index;
+        t.events.reserve( size);
+        for ( std::uint64_t i = head - size; i < head; ++i) {
+            trace_event e;
+            if ( b->events[i & ( b->capacity - 1)].load( i, e) ) {
+                t.events.push_back( e);
+            }
+        }
+        if ( ! t.events.empty() ) {
+            traces.push_back( std::move( t) );
+        }
+    }
+    std::sort( traces.begin(), traces.end(),
+               []( thread_trace const& l, thread_trace const& r) {
+                    return l.index < r.index;
+               });
+    return traces;
+}
+
+struct slice {
+    std::uint64_t       begin;
+    std::uint64_t       end;
+    std::uint64_t       id;
+    char const      *   label;
+    std::uint32_t       type;
+    bool                main;
+};
+
+// run slices (switch-in to switch-out) and instants (create, terminate) of one thread
+std::vector< slice > slices_of( thread_trace const& t) {
+    std::vector< slice > slices;
+    trace_event const* previous = nullptr;
+    for ( trace_event const& e : t.events) {
+        if ( trace_create == e.type || trace_terminate == e.type) {
+            std::uint64_t id = trace_create == e.type ? e.to : e.from;
+            slices.push_back( slice{ e.tsc, e.tsc, id, e.label, e.type, false });
+            continue;
+        }
+        if ( nullptr != previous && previous->to == e.from) {
+            slices.push_back( slice{ previous->tsc, e.tsc, e.from, e.label, e.type, 0 != ( e.flags & from_main) });
+        }
+        previous = & e;
+    }
+    return slices;
+}
+
+std::string name_of( slice const& s) {
+    if ( nullptr != s.label) {
+        return s.label;
+    }
+    if ( s.main) {
+        return "main";
+    }
+    return "fiber " + std::to_string( s.id);
+}
+
+char const* type_name( std::uint32_t type) {
+    switch ( type) {
+    case trace_resume: return "resume";
+    case trace_resume_with: return "resume_with";
+    case trace_unwind: return "unwind";
+    case trace_exit: return "exit";
+    case trace_create: return "create";
+    case trace_terminate: return "terminate";
+    default: return "unknown";
+    }
+}
+
+std::string json_escape( std::string const& str) {
+    std::string result;
+    for ( char c : str) {
+        switch ( c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if ( static_cast< unsigned char >( c) < 0x20) {
+                char buf[8];
+                std::snprintf( buf, sizeof( buf), "\\u%04x", static_cast< unsigned >( c) );
+                result += buf;
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result;
+}
+
+long process_id() noexcept {
+#if defined(BOOST_WINDOWS)
+    return static_cast< long >( ::_getpid() );
+#else
+    return static_cast< long >( ::getpid() );
+#endif
+}
+
+// timestamp of the first recorded event (or of start_fiber_trace())
+std::uint64_t base_of( std::vector< thread_trace > const& traces) {
+    std::uint64_t base = trace_start.load( std::memory_order_relaxed);
+    for ( thread_trace const& t : traces) {
+        base = (std::min)( base, t.events.front().tsc);
+    }
+    return base;
+}
+
+// protobuf encoding, see perfetto/protos/perfetto/trace/
+void put_varint( std::string & s, std::uint64_t v) {
+    while ( v >= 0x80) {
+        s.push_back( static_cast< char >( ( v & 0x7f) | 0x80) );
+        v >>= 7;
+    }
+    s.push_back( static_cast< char >( v) );
+}
+
+void put_uint( std::string & s, std::uint32_t field, std::uint64_t v) {
+    put_varint( s, field << 3);
+    put_varint( s, v);
+}
+
+void put_bytes( std::string & s, std::uint32_t field, std::string const& v) {
+    put_varint( s, ( field << 3) | 2);
+    put_varint( s, v.size() );
+    s += v;
+}
+
+// TracePacket
+static constexpr std::uint32_t packet_timestamp = 8;
+static constexpr std::uint32_t packet_sequence_id = 10;
+static constexpr std::uint32_t packet_track_event = 11;
+static constexpr std::uint32_t packet_sequence_flags = 13;
+static constexpr std::uint32_t packet_track_descriptor = 60;
+// TrackDescriptor
+static constexpr std::uint32_t descriptor_uuid = 1;
+static constexpr std::uint32_t descriptor_name = 2;
+static constexpr std::uint32_t descriptor_thread = 4;
+// ThreadDescriptor
+static constexpr std::uint32_t thread_pid = 1;
+static constexpr std::uint32_t thread_tid = 2;
+// TrackEvent
+static constexpr std::uint32_t event_type = 9;
+static constexpr std::uint32_t event_track_uuid = 11;
+static constexpr std::uint32_t event_name = 23;
+static constexpr std::uint64_t slice_begin = 1;
+static constexpr std::uint64_t slice_end = 2;
+static constexpr std::uint64_t instant = 3;
+
+void put_packet( std::ostream & os, std::string const& packet) {
+    std::string s;
+    // Trace.packet
+    put_bytes( s, 1, packet);
+    os.write( s.data(), s.size() );
+}
+
+void put_track_event( std::ostream & os, std::uint64_t ns, std::uint64_t uuid, std::uint64_t type, std::string const* name) {
+    std::string event;
+    put_uint( event, event_type, type);
+    put_uint( event, event_track_uuid, uuid);
+    if ( nullptr != name) {
+        put_bytes( event, event_name, * name);
+    }
+    std::string packet;
+    put_uint( packet, packet_timestamp, ns);
+    put_uint( packet, packet_sequence_id, 1);
+    put_bytes( packet, packet_track_event, event);
+    put_packet( os, packet);
+}
+
+}
+
+bool start_fiber_trace( std::size_t capacity) noexcept {
+    std::size_t size = 1;
+    while ( size < capacity) {
+        size <<= 1;
+    }
+    trace_capacity.store( size, std::memory_order_relaxed);
+    trace_start.store( detail::timestamp(), std::memory_order_relaxed);
+    return add_fiber_hooks( & trace_hooks);
+}
+
+void stop_fiber_trace() noexcept {
+    remove_fiber_hooks( & trace_hooks);
+}
+
+void clear_fiber_trace() noexcept {
+    for ( trace_buffer * b = buffers.load( std::memory_order_acquire); nullptr != b; b = b->next) {
+        b->head.store( 0, std::memory_order_release);
+    }
+}
+
+void write_fiber_trace_json( std::ostream & os) {
+    std::vector< thread_trace > traces = snapshot();
+    std::uint64_t base = base_of( traces);
+    double scale = 1e6 / detail::timestamp_frequency();
+    long pid = process_id();
+    char const* separator = "\n";
+    os << "{\"traceEvents\":[";
+    for ( thread_trace const& t : traces) {
+        os << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+           << ",\"tid\":" << t.index << ",\"args\":{\"name\":\"thread " << t.index << "\"}}";
+        separator = ",\n";
+        for ( slice const& s : slices_of( t) ) {
+            double ts = ( s.begin - base) * scale;
+            os << separator << "{\"name\":\"";
+            if ( trace_create == s.type || trace_terminate == s.type) {
+                os << type_name( s.type) << ' ' << json_escape( name_of( s) )
+                   << "\",\"cat\":\"fiber\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << ts;
+            } else {
+                os << json_escape( name_of( s) )
+                   << "\",\"cat\":\"fiber\",\"ph\":\"X\",\"ts\":" << ts
+                   << ",\"dur\":" << ( s.end - s.begin) * scale;
+            }
+            os << ",\"pid\":" << pid << ",\"tid\":" << t.index
+               << ",\"args\":{\"fiber\":" << s.id << ",\"event\":\"" << type_name( s.type) << "\"}}";
+        }
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void write_fiber_trace_perfetto( std::ostream & os) {
+    std::vector< thread_trace > traces = snapshot();
+    std::uint64_t base = base_of( traces);
+    double scale = 1e9 / detail::timestamp_frequency();
+    long pid = process_id();
+    bool first = true;
+    for ( thread_trace const& t : traces) {
+        std::string thread;
+        put_uint( thread, thread_pid, static_cast< std::uint64_t >( pid) );
+        put_uint( thread, thread_tid, t.index);
+        std::string descriptor;
+        put_uint( descriptor, descriptor_uuid, t.index);
+        put_bytes( descriptor, descriptor_name, "thread " + std::to_string( t.index) );
+        put_bytes( descriptor, descriptor_thread, thread);
+        std::string packet;
+        put_uint( packet, packet_sequence_id, 1);
+        if ( first) {
+            // SEQ_INCREMENTAL_STATE_CLEARED
+            put_uint( packet, packet_sequence_flags, 1);
+            first = false;
+        }
+        put_bytes( packet, packet_track_descriptor, descriptor);
+        put_packet( os, packet);
+        for ( slice const& s : slices_of( t) ) {
+            std::string name = name_of( s);
+            std::uint64_t begin = static_cast< std::uint64_t >( ( s.begin - base) * scale);
+            if ( trace_create == s.type || trace_terminate == s.type) {
+                name = type_name( s.type) + ( ' ' + name);
+                put_track_event( os, begin, t.index, instant, & name);
+            } else {
+                std::uint64_t end = static_cast< std::uint64_t >( ( s.end - base) * scale);
+                put_track_event( os, begin, t.index, slice_begin, & name);
+                put_track_event( os, end, t.index, slice_end, nullptr);
+            }
+        }
+    }
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
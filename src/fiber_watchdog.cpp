@@ -0,0 +1,341 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "boost/context/fiber_watchdog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <boost/config.hpp>
+
+#include "boost/context/detail/frame_walk.hpp"
+
+#if ! defined(BOOST_WINDOWS)
+# define BOOST_CONTEXT_WATCHDOG_SUPPORTED
+extern "C" {
+# include <pthread.h>
+# include <signal.h>
+# include <unistd.h>
+}
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_PREFIX
+#endif
+
+#if defined(BOOST_USE_FIBER_HOOKS)
+
+namespace boost {
+namespace context {
+namespace {
+
+#if defined(BOOST_CONTEXT_WATCHDOG_SUPPORTED)
+
+typedef std::chrono::steady_clock   clock_type;
+
+struct thread_record {
+    thread_record                   *   next{ nullptr };
+    // guards `owned` and `thread`: held by the monitor while it signals the
+    // thread, which does not exit before it has released the record
+    std::mutex                          mtx{};
+    bool                                owned{ true };
+    std::size_t                         index;
+    pthread_t                           thread;
+    char                            *   low{ nullptr };
+    char                            *   high{ nullptr };
+    // written by the owning thread
+    std::atomic< std::uint64_t >        epoch{ 0 };
+    // dereferenced only by the owning thread (signal handler), the
+    // identity lives on the stack of the fiber
+    std::atomic< fiber_info * >         running{ nullptr };
+    // a fiber (not the main context) is running, read by the monitor
+    std::atomic< bool >                 in_fiber{ false };
+    // written by the monitor
+    std::atomic< std::int64_t >         stalled{ 0 };
+    std::uint64_t                       seen_epoch{ 0 };
+    clock_type::time_point              since{};
+    bool                                reported{ false };
+
+    thread_record( std::size_t index_) noexcept :
+        index{ index_ },
+        thread{ ::pthread_self() } {
+        detail::thread_stack( low, high);
+    }
+};
+
+// never freed, records of terminated threads are reused
+std::atomic< thread_record * >      records{ nullptr };
+std::atomic< std::size_t >          record_count{ 0 };
+thread_local thread_record      *   local_record{ nullptr };
+
+std::atomic< fiber_watchdog_callback >  callback{ nullptr };
+int                                 signal_number{ 0 };
+struct sigaction                    old_action;
+std::chrono::milliseconds           threshold{ 0 };
+std::thread                         monitor;
+std::mutex                          monitor_mtx;
+std::condition_variable             monitor_cnd;
+bool                                monitor_stop{ false };
+
+struct record_releaser {
+    ~record_releaser() {
+        if ( nullptr != local_record) {
+            local_record->running.store( nullptr, std::memory_order_relaxed);
+            local_record->in_fiber.store( false, std::memory_order_relaxed);
+            std::unique_lock< std::mutex > lk{ local_record->mtx };
+            local_record->owned = false;
+            local_record = nullptr;
+        }
+    }
+};
+
+thread_record * acquire_record() noexcept {
+    // releases the record at thread exit
+    static thread_local record_releaser releaser;
+    for ( thread_record * r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+        std::unique_lock< std::mutex > lk{ r->mtx };
+        if ( ! r->owned) {
+            r->owned = true;
+            r->thread = ::pthread_self();
+            detail::thread_stack( r->low, r->high);
+            return r;
+        }
+    }
+    thread_record * r = new ( std::nothrow) thread_record{
+        record_count.fetch_add( 1, std::memory_order_relaxed) + 1 };
+    if ( nullptr == r) {
+        return nullptr;
+    }
+    r->next = records.load( std::memory_order_relaxed);
+    while ( ! records.compare_exchange_weak( r->next, r, std::memory_order_release, std::memory_order_relaxed) ) {
+    }
+    return r;
+}
+
+void on_switch( fiber_info *, fiber_info * to, fiber_switch) noexcept {
+    thread_record * r = local_record;
+    if ( BOOST_UNLIKELY( nullptr == r) ) {
+        r = local_record = acquire_record();
+        if ( nullptr == r) {
+            return;
+        }
+    }
+    r->running.store( to, std::memory_order_relaxed);
+    r->in_fiber.store( nullptr != to->sctx.sp, std::memory_order_relaxed);
+    r->epoch.store( r->epoch.load( std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+fiber_hooks const watchdog_hooks{ nullptr, on_switch, nullptr, 0, {} };
+
+void on_signal( int, siginfo_t *, void * vp) {
+    int saved_errno = errno;
+    thread_record const* r = local_record;
+    fiber_watchdog_callback fn = callback.load( std::memory_order_acquire);
+    if ( nullptr != r && nullptr != fn) {
+        fiber_watchdog_report report;
+        fiber_info * running = r->running.load( std::memory_order_relaxed);
+        report.thread = r->index;
+        report.fiber = running;
+        report.stalled = std::chrono::nanoseconds{ r->stalled.load( std::memory_order_relaxed) };
+        char * low = r->low;
+        char * high = r->high;
+        if ( nullptr != running) {
+            report.id = running->id;
+            report.label = running->label;
+            if ( nullptr != running->sctx.sp) {
+                high = static_cast< char * >( running->sctx.sp);
+                low = high - running->sctx.size;
+            }
+        }
+        void * pc = nullptr;
+        char * fp = nullptr;
+        char * sp = nullptr;
+        if ( detail::interrupted_frame( vp, pc, fp, sp) ) {
+            if ( sp < low || sp >= high) {
+                // inside a context switch, record the program counter only
+                high = nullptr;
+            }
+            report.depth = detail::walk_frames(
+                    report.frames, BOOST_CONTEXT_WATCHDOG_MAX_FRAMES, pc, fp, sp, high);
+        }
+        fn( report);
+    }
+    errno = saved_errno;
+}
+
+void watch() {
+    std::chrono::milliseconds period = (std::max)( threshold / 4, std::chrono::milliseconds( 1) );
+    std::unique_lock< std::mutex > lk{ monitor_mtx };
+    while ( ! monitor_cnd.wait_for( lk, period, [](){ return monitor_stop; }) ) {
+        clock_type::time_point now = clock_type::now();
+        for ( thread_record * r = records.load( std::memory_order_acquire); nullptr != r; r = r->next) {
+            std::uint64_t epoch = r->epoch.load( std::memory_order_acquire);
+            if ( epoch != r->seen_epoch) {
+                r->seen_epoch = epoch;
+                r->since = now;
+                r->reported = false;
+                continue;
+            }
+            // the fiber might terminate (and its stack be released) at any
+            // time, its identity is not followed
+            if ( r->reported || ! r->in_fiber.load( std::memory_order_relaxed) ||
+                 now - r->since < threshold) {
+                // the main context of a thread is not watched
+                continue;
+            }
+            r->reported = true;
+            r->stalled.store(
+                    std::chrono::duration_cast< std::chrono::nanoseconds >( now - r->since).count(),
+                    std::memory_order_relaxed);
+            // the lock keeps the thread from exiting, `thread` stays valid
+            std::unique_lock< std::mutex > rlk{ r->mtx };
+            if ( r->owned) {
+                ::pthread_kill( r->thread, signal_number);
+            }
+        }
+    }
+}
+
+// async-signal-safe formatting
+struct text {
+    char            buffer[256];
+    std::size_t     size{ 0 };
+
+    void put( char const* str) noexcept {
+        while ( '\0' != * str && size < sizeof( buffer) ) {
+            buffer[size++] = * str++;
+        }
+    }
+
+    void put( std::uint64_t v, unsigned base = 10) noexcept {
+        char digits[24];
+        std::size_t n = 0;
+        do {
+            digits[n++] = "0123456789abcdef"[v % base];
+            v /= base;
+        } while ( 0 != v);
+        while ( 0 < n && size < sizeof( buffer) ) {
+            buffer[size++] = digits[--n];
+        }
+    }
+
+    void flush( int fd) noexcept {
+        char const* p = buffer;
+        while ( 0 < size) {
+            ssize_t n = ::write( fd, p, size);
+            if ( 0 > n) {
+                if ( EINTR == errno) {
+                    continue;
+                }
+                break;
+            }
+            p += n;
+            size -= static_cast< std::size_t >( n);
+        }
+        size = 0;
+    }
+};
+
+#endif
+
+}
+
+bool start_fiber_watchdog( std::chrono::milliseconds threshold_, fiber_watchdog_callback callback_, int signo) noexcept {
+#if defined(BOOST_CONTEXT_WATCHDOG_SUPPORTED)
+    if ( monitor.joinable() ) {
+        return false;
+    }
+    threshold = threshold_;
+    signal_number = 0 != signo ? signo : SIGURG;
+    callback.store( callback_, std::memory_order_release);
+    struct sigaction action;
+    std::memset( & action, 0, sizeof( action) );
+    action.sa_sigaction = on_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    ::sigemptyset( & action.sa_mask);
+    ::sigaction( signal_number, & action, & old_action);
+    if ( ! add_fiber_hooks( & watchdog_hooks) ) {
+        ::sigaction( signal_number, & old_action, nullptr);
+        return false;
+    }
+    try {
+        monitor_stop = false;
+        monitor = std::thread{ watch };
+    } catch (...) {
+        remove_fiber_hooks( & watchdog_hooks);
+        ::sigaction( signal_number, & old_action, nullptr);
+        return false;
+    }
+    return true;
+#else
+    ( void) threshold_;
+    ( void) callback_;
+    ( void) signo;
+    return false;
+#endif
+}
+
+void stop_fiber_watchdog() noexcept {
+#if defined(BOOST_CONTEXT_WATCHDOG_SUPPORTED)
+    if ( ! monitor.joinable() ) {
+        return;
+    }
+    {
+        std::unique_lock< std::mutex > lk{ monitor_mtx };
+        monitor_stop = true;
+    }
+    monitor_cnd.notify_all();
+    monitor.join();
+    remove_fiber_hooks( & watchdog_hooks);
+    // a signal in flight still finds the handler
+    callback.store( nullptr, std::memory_order_release);
+    ::sigaction( signal_number, & old_action, nullptr);
+#endif
+}
+
+void write_fiber_watchdog_report( int fd, fiber_watchdog_report const& report) noexcept {
+#if defined(BOOST_CONTEXT_WATCHDOG_SUPPORTED)
+    text t;
+    t.put( "fiber ");
+    if ( nullptr != report.label) {
+        t.put( report.label);
+    } else {
+        t.put( report.id);
+    }
+    t.put( " on thread ");
+    t.put( report.thread);
+    t.put( " running for ");
+    t.put( static_cast< std::uint64_t >( report.stalled.count() / 1000000) );
+    t.put( " ms without switching\n");
+    t.flush( fd);
+    for ( std::size_t i = 0; i < report.depth; ++i) {
+        t.put( "  #");
+        t.put( i);
+        t.put( " 0x");
+        t.put( reinterpret_cast< std::uintptr_t >( report.frames[i]), 16);
+        t.put( "\n");
+        t.flush( fd);
+    }
+#else
+    ( void) fd;
+    ( void) report;
+#endif
+}
+
+}}
+
+#endif
+
+#ifdef BOOST_HAS_ABI_HEADERS
+# include BOOST_ABI_SUFFIX
+#endif
@@ -0,0 +1,128 @@
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+// counts the heap allocations and deallocations of the program; with glibc
+// the malloc family is replaced, otherwise the global operator new/delete
+// must be included by exactly one translation unit of a test or benchmark
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+std::atomic< std::size_t > allocation_count{ 0 };
+std::atomic< std::size_t > deallocation_count{ 0 };
+
+inline
+std::size_t allocations() noexcept {
+    return allocation_count.load( std::memory_order_relaxed);
+}
+
+inline
+std::size_t deallocations() noexcept {
+    return deallocation_count.load( std::memory_order_relaxed);
+}
+
+// number of heap allocations done by `fn`
+template< typename Fn >
+std::size_t count_allocations( Fn && fn) {
+    std::size_t before = allocations();
+    fn();
+    return allocations() - before;
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+
+void * __libc_malloc( std::size_t);
+void * __libc_calloc( std::size_t, std::size_t);
+void * __libc_realloc( void *, std::size_t);
+void * __libc_memalign( std::size_t, std::size_t);
+void __libc_free( void *);
+
+void * malloc( std::size_t size) noexcept {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    return __libc_malloc( size);
+}
+
+void * calloc( std::size_t n, std::size_t size) noexcept {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    return __libc_calloc( n, size);
+}
+
+void * realloc( void * p, std::size_t size) noexcept {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    return __libc_realloc( p, size);
+}
+
+void * memalign( std::size_t alignment, std::size_t size) noexcept {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    return __libc_memalign( alignment, size);
+}
+
+void * aligned_alloc( std::size_t alignment, std::size_t size) noexcept {
+    return memalign( alignment, size);
+}
+
+int posix_memalign( void ** p, std::size_t alignment, std::size_t size) noexcept {
+    * p = memalign( alignment, size);
+    return nullptr != * p ? 0 : ENOMEM;
+}
+
+void free( void * p) noexcept {
+    if ( nullptr != p) {
+        deallocation_count.fetch_add( 1, std::memory_order_relaxed);
+    }
+    __libc_free( p);
+}
+
+}
+#else
+void * operator new( std::size_t size) {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    if ( void * p = std::malloc( 0 != size ? size : 1) ) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void * operator new[]( std::size_t size) {
+    return ::operator new( size);
+}
+
+void * operator new( std::size_t size, std::nothrow_t const&) noexcept {
+    allocation_count.fetch_add( 1, std::memory_order_relaxed);
+    return std::malloc( 0 != size ? size : 1);
+}
+
+void * operator new[]( std::size_t size, std::nothrow_t const& tag) noexcept {
+    return ::operator new( size, tag);
+}
+
+void operator delete( void * p) noexcept {
+    if ( nullptr != p) {
+        deallocation_count.fetch_add( 1, std::memory_order_relaxed);
+    }
+    std::free( p);
+}
+
+void operator delete[]( void * p) noexcept {
+    ::operator delete( p);
+}
+
+void operator delete( void * p, std::size_t) noexcept {
+    ::operator delete( p);
+}
+
+void operator delete[]( void * p, std::size_t) noexcept {
+    ::operator delete( p);
+}
+#endif
+
+#endif // ALLOCATIONS_H
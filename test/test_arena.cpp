@@ -0,0 +1,68 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fiber_arena.hpp>
+
+#include "allocations.hpp"
+
+namespace ctx = boost::context;
+
+void test_arena() {
+#if defined(BOOST_CONTEXT_HAS_MEMORY_RESOURCE)
+    // the main context lives as long as the thread
+    BOOST_CHECK( std::pmr::get_default_resource() == ctx::fiber_memory_resource() );
+    std::size_t used = 0;
+    for ( int i = 0; i < 2; ++i) {
+        std::size_t allocated = allocations();
+        std::size_t deallocated = deallocations();
+        ctx::fiber f{
+            [&used]( ctx::fiber && f) {
+                // each fiber starts with an empty arena
+                BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_arena_used() );
+                std::pmr::memory_resource * r = ctx::fiber_memory_resource();
+                BOOST_CHECK( std::pmr::get_default_resource() != r);
+                BOOST_CHECK( r == ctx::fiber_memory_resource() );
+                // grows beyond the first block
+                std::pmr::vector< std::pmr::string > headers{ r };
+                for ( int j = 0; j < 100; ++j) {
+                    headers.emplace_back( 100, 'x');
+                }
+                used = ctx::fiber_arena_used();
+                f = std::move( f).resume();
+                BOOST_CHECK_EQUAL( std::string( 100, 'x'), std::string{ headers.back().c_str() });
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        BOOST_CHECK( 100 * 101 <= used);
+        // the stack, the first block of the arena and the blocks it grew by
+        BOOST_CHECK( 3 <= allocations() - allocated);
+        // terminates, the arena is released with the stack (ucontext: with
+        // the fiber holding the terminated context)
+        f = std::move( f).resume();
+        BOOST_CHECK( ! f);
+        f = ctx::fiber{};
+        BOOST_CHECK_EQUAL( allocations() - allocated, deallocations() - deallocated);
+    }
+#endif
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
+{
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Context: fiber arena test suite");
+
+    test->add( BOOST_TEST_CASE( & test_arena) );
+
+    return test;
+}
@@ -0,0 +1,84 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/context/continuation.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+
+#include "allocations.hpp"
+
+namespace ctx = boost::context;
+
+// resumes the caller n times, then terminates
+struct ping {
+    int n;
+
+    ctx::continuation operator()( ctx::continuation && c) {
+        while ( 0 < n--) {
+            c = c.resume();
+        }
+        return std::move( c);
+    }
+};
+
+void warm_up() {
+    ctx::continuation c = ctx::callcc( std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1 } );
+}
+
+void test_callcc() {
+    warm_up();
+    ctx::protected_fixedsize_stack salloc;
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&salloc](){
+        ctx::continuation c = ctx::callcc( std::allocator_arg, salloc, ping{ 1000 } );
+        while ( c) {
+            c = c.resume();
+        }
+    }) );
+}
+
+void test_resume_with() {
+    warm_up();
+    // captures more than fits into the small buffer of std::function
+    int i = 0, j = 0, k = 0, l = 0;
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&](){
+        ctx::continuation c = ctx::callcc( std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1000 } );
+        while ( c) {
+            c = c.resume_with(
+                [&i,&j,&k,&l]( ctx::continuation && c) {
+                    ++i; ++j; ++k; ++l;
+                    return std::move( c);
+                });
+        }
+    }) );
+    BOOST_CHECK_EQUAL( 1000, i);
+    BOOST_CHECK_EQUAL( 1000, l);
+}
+
+void test_unwind() {
+    warm_up();
+    // the exception object of forced_unwind is allocated by the C++ runtime
+    std::size_t n = count_allocations( [](){
+        ctx::continuation c = ctx::callcc( std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1 } );
+    });
+    BOOST_CHECK_EQUAL( std::size_t( 1), n);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
+{
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Context: callcc allocation test suite");
+
+    test->add( BOOST_TEST_CASE( & test_callcc) );
+    test->add( BOOST_TEST_CASE( & test_resume_with) );
+    test->add( BOOST_TEST_CASE( & test_unwind) );
+
+    return test;
+}
@@ -27,6 +27,9 @@
 #include <boost/variant.hpp>
 
 #include <boost/context/fiber.hpp>
+#if ! defined(BOOST_USE_WINFIB)
+#include <boost/context/fiber_task.hpp>
+#endif
 #include <boost/context/detail/config.hpp>
 
 #ifdef BOOST_WINDOWS
@@ -193,6 +196,197 @@ void test_exception() {
 #endif
 }
 
+void test_exception_propagation() {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    {
+        // rethrown by the resume() of the resumer, the stack is unwound
+        value1 = 0;
+        ctx::fiber f{
+            [](ctx::fiber && f) {
+                Y y;
+                f = std::move( f).resume();
+                throw std::runtime_error( "hello world");
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        BOOST_CHECK_EQUAL( 3, value1);
+        bool thrown = false;
+        try {
+            f = std::move( f).resume();
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "hello world"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK_EQUAL( 7, value1);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // propagated through a chain of fibers
+        int i = 0;
+        ctx::fiber f{
+            [&i](ctx::fiber && f) {
+                ctx::fiber inner{
+                    [](ctx::fiber &&) -> ctx::fiber {
+                        throw std::logic_error( "inner");
+                    }};
+                try {
+                    inner = std::move( inner).resume();
+                } catch ( std::logic_error const&) {
+                    i = 1;
+                    throw;
+                }
+                return std::move( f);
+            }};
+        bool thrown = false;
+        try {
+            f = std::move( f).resume();
+        } catch ( std::logic_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "inner"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK_EQUAL( 1, i);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // the fiber taken by value is destroyed by the exception, the
+        // resumer is not unwound
+        ctx::fiber f{
+            []( ctx::fiber f) {
+                f = std::move( f).resume();
+                throw std::runtime_error( "by value");
+                return f;
+            }};
+        f = std::move( f).resume();
+        bool thrown = false;
+        try {
+            f = std::move( f).resume();
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "by value"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // the resumer moved away
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                ctx::fiber c = std::move( f);
+                c = std::move( c).resume();
+                throw std::runtime_error( "moved");
+                return c;
+            }};
+        f = std::move( f).resume();
+        bool thrown = false;
+        try {
+            f = std::move( f).resume();
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "moved"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // caught by the context-function after the resumer has been
+        // destroyed, the kept handle is returned to
+        int i = 0;
+        ctx::fiber f{
+            [&i]( ctx::fiber && f) {
+                try {
+                    ctx::fiber c = std::move( f);
+                    throw std::runtime_error( "caught");
+                } catch ( std::runtime_error const&) {
+                    i = 1;
+                }
+                return ctx::fiber{};
+            }};
+        f = std::move( f).resume();
+        BOOST_CHECK_EQUAL( 1, i);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // a fiber that has switched to the fiber last is unwound, the
+        // exception is propagated to the valid resumer
+        value1 = 0;
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                ctx::fiber inner{
+                    []( ctx::fiber && f) {
+                        Y y;
+                        f = std::move( f).resume();
+                        return std::move( f);
+                    }};
+                inner = std::move( inner).resume();
+                BOOST_CHECK_EQUAL( 3, value1);
+                throw std::runtime_error( "inner suspended");
+                return std::move( f);
+            }};
+        bool thrown = false;
+        try {
+            f = std::move( f).resume();
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "inner suspended"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK_EQUAL( 7, value1);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // thrown by a function executed by resume_with() in the resumed
+        // fiber, escapes its context-function
+        value1 = 0;
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                Y y;
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        BOOST_CHECK_EQUAL( 3, value1);
+        bool thrown = false;
+        try {
+            f = std::move( f).resume_with( []( ctx::fiber && f) {
+                    throw std::runtime_error( "on top");
+                    return std::move( f);
+                });
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "on top"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK_EQUAL( 7, value1);
+        BOOST_CHECK( ! f);
+    }
+    {
+        // thrown by a function executed by resume_with() before the
+        // context-function has been entered
+        bool entered = false;
+        ctx::fiber f{
+            [&entered]( ctx::fiber && f) {
+                entered = true;
+                return std::move( f);
+            }};
+        bool thrown = false;
+        try {
+            f = std::move( f).resume_with( []( ctx::fiber && f) {
+                    throw std::runtime_error( "not started");
+                    return std::move( f);
+                });
+        } catch ( std::runtime_error const& e) {
+            thrown = true;
+            BOOST_CHECK_EQUAL( std::string( "not started"), e.what() );
+        }
+        BOOST_CHECK( thrown);
+        BOOST_CHECK( ! entered);
+        BOOST_CHECK( ! f);
+    }
+#endif
+}
+
 void test_fp() {
     value3 = 0.;
     double d = 7.13;
@@ -279,6 +473,27 @@ void test_ontop() {
                    return std::move( f);
                });
     }
+    {
+        // function passed to a fiber that has not been started yet
+        int i = 0;
+        ctx::fiber f{ [&i](ctx::fiber && f) {
+                    for (;;) {
+                        i += 1;
+                        f = std::move( f).resume();
+                    }
+                    return std::move( f);
+                }};
+        f = std::move( f).resume_with(
+               [&i](ctx::fiber && f){
+                   i += 100;
+                   return std::move( f);
+               });
+        BOOST_CHECK_EQUAL( i, 101);
+        f = std::move( f).resume();
+        f = std::move( f).resume();
+        BOOST_CHECK( f);
+        BOOST_CHECK_EQUAL( i, 103);
+    }
 }
 
 void test_ontop_exception() {
@@ -507,6 +722,101 @@ void test_badcatch() {
 #endif
 }
 
+#if ! defined(BOOST_USE_WINFIB)
+void test_task() {
+    {
+        ctx::fiber_task< std::string > t{
+            []( ctx::fiber & caller) {
+                std::string s{ "hello" };
+                caller = std::move( caller).resume();
+                s += " world";
+                return s;
+            }};
+        BOOST_CHECK( t.joinable() );
+        BOOST_CHECK( ! t.done() );
+        t.resume();
+        BOOST_CHECK( ! t.done() );
+        BOOST_CHECK_EQUAL( std::string( "hello world"), t.join() );
+        BOOST_CHECK( ! t.joinable() );
+    }
+    {
+        // completed before join()
+        value1 = 0;
+        ctx::fiber_task< void > t{
+            []( ctx::fiber &) {
+                value1 = 3;
+            }};
+        t.resume();
+        BOOST_CHECK( t.done() );
+        BOOST_CHECK_EQUAL( 3, value1);
+        t.join();
+    }
+    {
+        // move-only result, moved out before the stack is released
+        ctx::fiber_task< std::unique_ptr< int > > t{
+            std::allocator_arg, ctx::fixedsize_stack(),
+            []( ctx::fiber &) {
+                return std::unique_ptr< int >( new int{ 7 });
+            }};
+        ctx::fiber_task< std::unique_ptr< int > > t2{ std::move( t) };
+        BOOST_CHECK( ! t.joinable() );
+        std::unique_ptr< int > p = t2.join();
+        BOOST_CHECK_EQUAL( 7, * p);
+    }
+}
+
+void test_task_exception() {
+    ctx::fiber_task< int > t{
+        []( ctx::fiber & caller) -> int {
+            caller = std::move( caller).resume();
+            throw std::runtime_error( "task failed");
+        }};
+    bool thrown = false;
+    try {
+        t.join();
+    } catch ( std::runtime_error const& e) {
+        thrown = true;
+        BOOST_CHECK_EQUAL( std::string( "task failed"), e.what() );
+    }
+    BOOST_CHECK( thrown);
+    BOOST_CHECK( ! t.joinable() );
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    // the caller moved away is destroyed by the exception, the task returns
+    // to it nevertheless
+    ctx::fiber_task< int > moved{
+        []( ctx::fiber & caller) -> int {
+            ctx::fiber c = std::move( caller);
+            throw std::runtime_error( "boom");
+        }};
+    thrown = false;
+    try {
+        moved.join();
+    } catch ( std::runtime_error const& e) {
+        thrown = true;
+        BOOST_CHECK_EQUAL( std::string( "boom"), e.what() );
+    }
+    BOOST_CHECK( thrown);
+    BOOST_CHECK( ! moved.joinable() );
+#endif
+}
+
+void test_task_unwind() {
+    // a task not joined is unwound by its destructor
+    value1 = 0;
+    {
+        ctx::fiber_task< int > t{
+            []( ctx::fiber & caller) {
+                Y y;
+                caller = std::move( caller).resume();
+                return 1;
+            }};
+        t.resume();
+        BOOST_CHECK_EQUAL( 3, value1);
+    }
+    BOOST_CHECK_EQUAL( 7, value1);
+}
+#endif
+
 boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
 {
     boost::unit_test::test_suite * test =
@@ -515,6 +825,7 @@ boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
     test->add( BOOST_TEST_CASE( & test_move) );
     test->add( BOOST_TEST_CASE( & test_bind) );
     test->add( BOOST_TEST_CASE( & test_exception) );
+    test->add( BOOST_TEST_CASE( & test_exception_propagation) );
     test->add( BOOST_TEST_CASE( & test_fp) );
     test->add( BOOST_TEST_CASE( & test_stacked) );
     test->add( BOOST_TEST_CASE( & test_prealloc) );
@@ -529,6 +840,11 @@ boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
 #endif
     test->add( BOOST_TEST_CASE( & test_goodcatch) );
     test->add( BOOST_TEST_CASE( & test_badcatch) );
+#if ! defined(BOOST_USE_WINFIB)
+    test->add( BOOST_TEST_CASE( & test_task) );
+    test->add( BOOST_TEST_CASE( & test_task_exception) );
+    test->add( BOOST_TEST_CASE( & test_task_unwind) );
+#endif
 
     return test;
 }
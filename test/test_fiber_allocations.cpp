@@ -0,0 +1,234 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/fiber_task.hpp>
+#include <boost/context/percpu_fixedsize_stack.hpp>
+#include <boost/context/pooled_fixedsize_stack.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+
+#include "allocations.hpp"
+
+namespace ctx = boost::context;
+
+// the hot paths of the library must not allocate from the heap;
+// the stack of fixedsize_stack is the only allocation expected
+
+// resumes the caller n times, then terminates
+struct ping {
+    int n;
+
+    ctx::fiber operator()( ctx::fiber && f) {
+        while ( 0 < n--) {
+            f = std::move( f).resume();
+        }
+        return std::move( f);
+    }
+};
+
+void warm_up() {
+    // the first context switch of a thread registers thread-local
+    // destructors, the first exception allocates in the unwinder
+    ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1 } };
+    f = std::move( f).resume();
+}
+
+void test_construction() {
+    warm_up();
+    ctx::protected_fixedsize_stack protected_stack;
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&protected_stack](){
+        ctx::fiber f{ std::allocator_arg, protected_stack, ping{ 0 } };
+        f = std::move( f).resume();
+    }) );
+    // the stack itself
+    ctx::fixedsize_stack fixedsize_stack;
+    BOOST_CHECK_EQUAL( std::size_t( 1), count_allocations( [&fixedsize_stack](){
+        ctx::fiber f{ std::allocator_arg, fixedsize_stack, ping{ 0 } };
+        f = std::move( f).resume();
+    }) );
+    // stacks are recycled by the pool
+    ctx::pooled_fixedsize_stack pooled_stack;
+    {
+        ctx::fiber f{ std::allocator_arg, pooled_stack, ping{ 0 } };
+        f = std::move( f).resume();
+    }
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&pooled_stack](){
+        ctx::fiber f{ std::allocator_arg, pooled_stack, ping{ 0 } };
+        f = std::move( f).resume();
+    }) );
+    // stacks are recycled by the cache of the CPU; a thread migrating to
+    // another CPU might miss the cache
+    ctx::percpu_fixedsize_stack percpu_stack;
+    std::size_t n = count_allocations( [&percpu_stack](){
+        for ( int i = 0; i < 100; ++i) {
+            ctx::fiber f{ std::allocator_arg, percpu_stack, ping{ 0 } };
+            f = std::move( f).resume();
+        }
+    });
+    BOOST_CHECK( 10 > n);
+    // stack provided by the caller
+    ctx::stack_context sctx = protected_stack.allocate();
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&protected_stack,sctx](){
+        ctx::fiber f{ std::allocator_arg, ctx::preallocated( sctx.sp, sctx.size, sctx), protected_stack,
+                      ping{ 0 } };
+        f = std::move( f).resume();
+    }) );
+}
+
+void test_resume() {
+    warm_up();
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [](){
+        ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1000 } };
+        while ( f) {
+            f = std::move( f).resume();
+        }
+    }) );
+}
+
+void test_resume_with() {
+    warm_up();
+    // captures more than fits into the small buffer of std::function
+    int i = 0, j = 0, k = 0, l = 0;
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&](){
+        ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1000 } };
+        f = std::move( f).resume();
+        while ( f) {
+            f = std::move( f).resume_with(
+                [&i,&j,&k,&l]( ctx::fiber && f) {
+                    ++i; ++j; ++k; ++l;
+                    return std::move( f);
+                });
+        }
+    }) );
+    BOOST_CHECK_EQUAL( 1000, i);
+    BOOST_CHECK_EQUAL( 1000, l);
+}
+
+void test_unwind() {
+    warm_up();
+    // forced_unwind is thrown to unwind the stack of a suspended fiber,
+    // the exception object is allocated by the C++ runtime (the one
+    // allocation of the unwinding)
+    std::size_t n = count_allocations( [](){
+        ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1 } };
+        f = std::move( f).resume();
+    });
+    BOOST_CHECK_EQUAL( std::size_t( 1), n);
+}
+
+void test_exception() {
+#if defined(BOOST_USE_FIBER_EXCEPTIONS)
+    warm_up();
+    // the exception object and the dependent exception of
+    // std::rethrow_exception() are allocated by the C++ runtime, the
+    // exception is handed over on the stack of the fiber
+    std::size_t n = count_allocations( [](){
+        ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(),
+            []( ctx::fiber &&) -> ctx::fiber {
+                throw 1;
+            }};
+        try {
+            f = std::move( f).resume();
+        } catch ( int) {
+        }
+    });
+    BOOST_CHECK_EQUAL( std::size_t( 2), n);
+#endif
+}
+
+void test_task() {
+    warm_up();
+    // the result lives on the stack of the task, no shared state
+    int sum = 0;
+    BOOST_CHECK_EQUAL( std::size_t( 0), count_allocations( [&sum](){
+        for ( int i = 0; i < 100; ++i) {
+            ctx::fiber_task< int > t{ std::allocator_arg, ctx::protected_fixedsize_stack(),
+                [i]( ctx::fiber & caller) {
+                    caller = std::move( caller).resume();
+                    return i;
+                }};
+            sum += t.join();
+        }
+    }) );
+    BOOST_CHECK_EQUAL( 4950, sum);
+}
+
+void test_thread() {
+    std::size_t n = 1;
+    std::thread t{ [&n](){
+        n = count_allocations( [](){
+            ctx::fiber f{ std::allocator_arg, ctx::protected_fixedsize_stack(), ping{ 1 } };
+            f = std::move( f).resume();
+            f = std::move( f).resume();
+        });
+    }};
+    t.join();
+    // the main context of the thread is not allocated on the heap and
+    // registers no thread-local destructor
+    BOOST_CHECK_EQUAL( std::size_t( 0), n);
+}
+
+void test_percpu_threads() {
+    // more threads than CPUs share the caches
+    std::size_t threads = 4 * (std::max)( std::thread::hardware_concurrency(), 1u);
+    ctx::percpu_fixedsize_stack salloc{ ctx::stack_traits::default_size(), 4 };
+    std::vector< std::thread > pool;
+    std::vector< int > owned( threads, 1);
+    for ( std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back( [&salloc,&owned,t](){
+            for ( int i = 0; i < 1000; ++i) {
+                ctx::stack_context sctx[2] = { salloc.allocate(), salloc.allocate() };
+                for ( ctx::stack_context & s : sctx) {
+                    std::memset( static_cast< char * >( s.sp) - 64, static_cast< int >( t), 64);
+                }
+                std::this_thread::yield();
+                // a stack is owned by one thread at a time
+                for ( ctx::stack_context & s : sctx) {
+                    char const* p = static_cast< char const* >( s.sp) - 64;
+                    for ( int j = 0; j < 64; ++j) {
+                        if ( static_cast< char >( t) != p[j]) {
+                            owned[t] = 0;
+                        }
+                    }
+                    salloc.deallocate( s);
+                }
+            }
+        });
+    }
+    for ( std::thread & t : pool) {
+        t.join();
+    }
+    for ( std::size_t t = 0; t < threads; ++t) {
+        BOOST_CHECK( 0 != owned[t]);
+    }
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
+{
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Context: fiber allocation test suite");
+
+    test->add( BOOST_TEST_CASE( & test_construction) );
+    test->add( BOOST_TEST_CASE( & test_resume) );
+    test->add( BOOST_TEST_CASE( & test_resume_with) );
+    test->add( BOOST_TEST_CASE( & test_unwind) );
+    test->add( BOOST_TEST_CASE( & test_exception) );
+    test->add( BOOST_TEST_CASE( & test_task) );
+    test->add( BOOST_TEST_CASE( & test_thread) );
+    test->add( BOOST_TEST_CASE( & test_percpu_threads) );
+
+    return test;
+}
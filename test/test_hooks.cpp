@@ -0,0 +1,977 @@
+
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/context/fiber.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <boost/context/fiber_accounting.hpp>
+#include <boost/context/fiber_backtrace.hpp>
+#include <boost/context/fiber_counters.hpp>
+#include <boost/context/fiber_histogram.hpp>
+#include <boost/context/fiber_memory.hpp>
+#include <boost/context/fiber_profiler.hpp>
+#include <boost/context/fiber_qsbr.hpp>
+#include <boost/context/fiber_registry.hpp>
+#include <boost/context/fiber_trace.hpp>
+#include <boost/context/fiber_watchdog.hpp>
+
+namespace ctx = boost::context;
+
+struct event {
+    enum type_t { create, switch_, terminate };
+
+    type_t              type;
+    ctx::fiber_info *   from;
+    ctx::fiber_info *   to;
+    ctx::fiber_switch   kind;
+};
+
+std::vector< event > events;
+
+void on_create( ctx::fiber_info * info) {
+    events.push_back( event{ event::create, nullptr, info, ctx::fiber_switch::resume });
+}
+
+void on_switch( ctx::fiber_info * from, ctx::fiber_info * to, ctx::fiber_switch kind) {
+    BOOST_CHECK( to == ctx::current_fiber_info() );
+    events.push_back( event{ event::switch_, from, to, kind });
+}
+
+void on_terminate( ctx::fiber_info * info) {
+    BOOST_CHECK( info == ctx::current_fiber_info() );
+    events.push_back( event{ event::terminate, info, nullptr, ctx::fiber_switch::exit });
+}
+
+ctx::fiber_hooks hooks{ on_create, on_switch, on_terminate, 0, {} };
+
+struct hooks_guard {
+    hooks_guard() {
+        events.clear();
+        BOOST_CHECK( ctx::add_fiber_hooks( & hooks) );
+    }
+
+    ~hooks_guard() {
+        ctx::remove_fiber_hooks( & hooks);
+    }
+};
+
+void test_resume() {
+    ctx::fiber_info * main_info = ctx::current_fiber_info();
+    ctx::fiber_info * fiber_info = nullptr;
+    {
+        hooks_guard guard;
+        ctx::fiber f{
+            [&fiber_info]( ctx::fiber && f) {
+                fiber_info = ctx::current_fiber_info();
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        f = std::move( f).resume();
+        BOOST_CHECK( ! f);
+    }
+    BOOST_CHECK( main_info == ctx::current_fiber_info() );
+    BOOST_REQUIRE_EQUAL( std::size_t( 6), events.size() );
+    BOOST_CHECK( event::create == events[0].type);
+    BOOST_CHECK( fiber_info == events[0].to);
+    BOOST_CHECK( nullptr != fiber_info->sctx.sp);
+    BOOST_CHECK( 0 < fiber_info->sctx.size);
+    // main -> fiber -> main -> fiber
+    for ( std::size_t i = 1; i < 4; ++i) {
+        BOOST_CHECK( event::switch_ == events[i].type);
+        BOOST_CHECK( ctx::fiber_switch::resume == events[i].kind);
+        BOOST_CHECK( ( 1 == i % 2 ? main_info : fiber_info) == events[i].from);
+        BOOST_CHECK( ( 1 == i % 2 ? fiber_info : main_info) == events[i].to);
+    }
+    BOOST_CHECK( event::terminate == events[4].type);
+    BOOST_CHECK( fiber_info == events[4].from);
+    BOOST_CHECK( event::switch_ == events[5].type);
+    BOOST_CHECK( ctx::fiber_switch::exit == events[5].kind);
+    BOOST_CHECK( fiber_info == events[5].from);
+    BOOST_CHECK( main_info == events[5].to);
+}
+
+void test_resume_with() {
+    ctx::fiber_info * main_info = ctx::current_fiber_info();
+    ctx::fiber_info * fiber_info = nullptr;
+    ctx::fiber_info * ontop_info = nullptr;
+    {
+        hooks_guard guard;
+        ctx::fiber f{
+            [&fiber_info]( ctx::fiber && f) {
+                fiber_info = ctx::current_fiber_info();
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        f = std::move( f).resume_with(
+            [&ontop_info]( ctx::fiber && f) {
+                ontop_info = ctx::current_fiber_info();
+                return std::move( f);
+            });
+        BOOST_CHECK( ! f);
+    }
+    BOOST_CHECK( fiber_info == ontop_info);
+    BOOST_REQUIRE_EQUAL( std::size_t( 6), events.size() );
+    BOOST_CHECK( ctx::fiber_switch::resume_with == events[3].kind);
+    BOOST_CHECK( main_info == events[3].from);
+    BOOST_CHECK( fiber_info == events[3].to);
+}
+
+void test_unwind() {
+    ctx::fiber_info * main_info = ctx::current_fiber_info();
+    {
+        hooks_guard guard;
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+    }
+    BOOST_REQUIRE_EQUAL( std::size_t( 6), events.size() );
+    ctx::fiber_info * fiber_info = events[0].to;
+    BOOST_CHECK( event::switch_ == events[3].type);
+    BOOST_CHECK( ctx::fiber_switch::unwind == events[3].kind);
+    BOOST_CHECK( main_info == events[3].from);
+    BOOST_CHECK( fiber_info == events[3].to);
+    BOOST_CHECK( event::terminate == events[4].type);
+    BOOST_CHECK( ctx::fiber_switch::exit == events[5].kind);
+    BOOST_CHECK( main_info == events[5].to);
+}
+
+void test_remove() {
+    {
+        hooks_guard guard;
+    }
+    ctx::fiber f{
+        []( ctx::fiber && f) {
+            return std::move( f);
+        }};
+    f = std::move( f).resume();
+    BOOST_CHECK( events.empty() );
+}
+
+// per-context data: creations and resumes of the context
+void on_data_create( ctx::fiber_info *);
+void on_data_switch( ctx::fiber_info *, ctx::fiber_info *, ctx::fiber_switch);
+
+ctx::fiber_hooks data_hooks{ on_data_create, on_data_switch, nullptr, 2 * sizeof( std::uint64_t), {} };
+
+std::uint64_t * data_of( ctx::fiber_info * info) {
+    return static_cast< std::uint64_t * >( ctx::fiber_hooks_data( & data_hooks, info) );
+}
+
+void on_data_create( ctx::fiber_info * info) {
+    std::uint64_t * data = data_of( info);
+    BOOST_REQUIRE( nullptr != data);
+    ++data[0];
+}
+
+void on_data_switch( ctx::fiber_info *, ctx::fiber_info * to, ctx::fiber_switch) {
+    std::uint64_t * data = data_of( to);
+    if ( nullptr != data) {
+        ++data[1];
+    }
+}
+
+void test_hooks_data() {
+    ctx::fiber_hooks too_large{ nullptr, nullptr, nullptr, BOOST_CONTEXT_MAX_FIBER_HOOKS_DATA + 1, {} };
+    BOOST_CHECK( ! ctx::add_fiber_hooks( & too_large) );
+    // created before the table is installed
+    ctx::fiber before{
+        []( ctx::fiber && f) {
+            f = std::move( f).resume();
+            return std::move( f);
+        }};
+    BOOST_REQUIRE( ctx::add_fiber_hooks( & data_hooks) );
+    std::uint64_t * inner = nullptr;
+    {
+        ctx::fiber f{
+            [&inner]( ctx::fiber && f) {
+                inner = data_of( ctx::current_fiber_info() );
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        BOOST_REQUIRE( nullptr != inner);
+        BOOST_CHECK( inner == data_of( f.info() ) );
+        BOOST_CHECK_EQUAL( std::uint64_t( 1), inner[0]);
+        BOOST_CHECK_EQUAL( std::uint64_t( 1), inner[1]);
+        BOOST_CHECK_EQUAL( std::uintptr_t( 0), reinterpret_cast< std::uintptr_t >( inner) % 16);
+        // reserved on the stack of the fiber
+        char * sp = static_cast< char * >( f.info()->sctx.sp);
+        BOOST_CHECK( reinterpret_cast< char * >( inner) < sp);
+        BOOST_CHECK( reinterpret_cast< char * >( inner) >= sp - f.info()->sctx.size);
+        std::uint64_t * main_data = data_of( ctx::current_fiber_info() );
+        BOOST_REQUIRE( nullptr != main_data);
+        BOOST_CHECK_EQUAL( std::uint64_t( 1), main_data[1]);
+        f = std::move( f).resume();
+        BOOST_CHECK_EQUAL( std::uint64_t( 2), main_data[1]);
+        BOOST_CHECK( ! f);
+    }
+    BOOST_CHECK( nullptr == data_of( before.info() ) );
+    ctx::remove_fiber_hooks( & data_hooks);
+    // kept until the table is installed again
+    BOOST_CHECK( nullptr != data_of( ctx::current_fiber_info() ) );
+    BOOST_REQUIRE( ctx::add_fiber_hooks( & data_hooks) );
+    BOOST_CHECK( nullptr == data_of( ctx::current_fiber_info() ) );
+    before = std::move( before).resume();
+    // zero-filled on the first switch
+    BOOST_REQUIRE( nullptr != data_of( ctx::current_fiber_info() ) );
+    BOOST_CHECK_EQUAL( std::uint64_t( 1), data_of( ctx::current_fiber_info() )[1]);
+    ctx::remove_fiber_hooks( & data_hooks);
+    before = std::move( before).resume();
+    BOOST_CHECK( ! before);
+}
+
+void test_ids() {
+    // assigned at creation, without any hook table installed
+    ctx::fiber f1{
+        []( ctx::fiber && f) {
+            return std::move( f);
+        }};
+    ctx::fiber f2{
+        []( ctx::fiber && f) {
+            return std::move( f);
+        }};
+    BOOST_CHECK( 0 != f1.info()->id);
+    BOOST_CHECK( 0 != f2.info()->id);
+    BOOST_CHECK( f1.info()->id != f2.info()->id);
+    BOOST_CHECK( 0 != ctx::current_fiber_info()->id);
+    BOOST_CHECK( f1.info()->id != ctx::current_fiber_info()->id);
+}
+
+void test_trace() {
+    ctx::clear_fiber_trace();
+    BOOST_CHECK( ctx::start_fiber_trace( 1000) );
+    {
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                ctx::current_fiber_info()->label = "worker";
+                for ( int i = 0; i < 3; ++i) {
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        for ( int i = 0; i < 4; ++i) {
+            f = std::move( f).resume();
+        }
+    }
+    ctx::stop_fiber_trace();
+    std::ostringstream json;
+    ctx::write_fiber_trace_json( json);
+    std::string str = json.str();
+    BOOST_CHECK( 0 == str.find( "{\"traceEvents\":[") );
+    BOOST_CHECK( std::string::npos != str.find( "\"name\":\"worker\",\"cat\":\"fiber\",\"ph\":\"X\"") );
+    BOOST_CHECK( std::string::npos != str.find( "\"name\":\"main\",\"cat\":\"fiber\",\"ph\":\"X\"") );
+    BOOST_CHECK( std::string::npos != str.find( "\"name\":\"terminate worker\"") );
+    std::ostringstream proto;
+    ctx::write_fiber_trace_perfetto( proto);
+    BOOST_CHECK( std::string::npos != proto.str().find( "worker") );
+    // nothing recorded after stop
+    ctx::clear_fiber_trace();
+    {
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+    }
+    json.str( "");
+    ctx::write_fiber_trace_json( json);
+    BOOST_CHECK( std::string::npos == json.str().find( "fiber\"") );
+}
+
+void test_trace_reuse() {
+    // the ring buffer of a terminated thread is reused without its events
+    ctx::clear_fiber_trace();
+    BOOST_CHECK( ctx::start_fiber_trace( 128) );
+    for ( char const* label : { "first", "second" }) {
+        std::thread t{ [label](){
+            ctx::fiber f{
+                [label]( ctx::fiber && f) {
+                    ctx::current_fiber_info()->label = label;
+                    return std::move( f);
+                }};
+            f = std::move( f).resume();
+        }};
+        t.join();
+    }
+    ctx::stop_fiber_trace();
+    std::ostringstream json;
+    ctx::write_fiber_trace_json( json);
+    BOOST_CHECK( std::string::npos == json.str().find( "first") );
+    BOOST_CHECK( std::string::npos != json.str().find( "terminate second") );
+    ctx::clear_fiber_trace();
+}
+
+void test_trace_concurrent() {
+    // the ring buffer wraps while it is copied by another thread
+    ctx::clear_fiber_trace();
+    BOOST_CHECK( ctx::start_fiber_trace( 16) );
+    std::atomic< bool > done{ false };
+    std::thread t{ [&done](){
+        ctx::fiber f{
+            [&done]( ctx::fiber && f) {
+                ctx::current_fiber_info()->label = "worker";
+                while ( ! done.load( std::memory_order_relaxed) ) {
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        while ( f) {
+            f = std::move( f).resume();
+        }
+    }};
+    for ( int i = 0; i < 1000; ++i) {
+        std::ostringstream json;
+        ctx::write_fiber_trace_json( json);
+        BOOST_CHECK( 0 == json.str().find( "{\"traceEvents\":[") );
+    }
+    done = true;
+    t.join();
+    ctx::stop_fiber_trace();
+    std::ostringstream json;
+    ctx::write_fiber_trace_json( json);
+    BOOST_CHECK( std::string::npos != json.str().find( "terminate worker") );
+    ctx::clear_fiber_trace();
+}
+
+void test_accounting() {
+    BOOST_CHECK( ctx::start_fiber_accounting() );
+    ctx::fiber_info * fiber_info = nullptr;
+    ctx::fiber_cpu_usage inner;
+    {
+        ctx::fiber f{
+            [&fiber_info,&inner]( ctx::fiber && f) {
+                fiber_info = ctx::current_fiber_info();
+                for ( int i = 0; i < 3; ++i) {
+                    f = std::move( f).resume();
+                }
+                inner = ctx::fiber_usage( fiber_info);
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        BOOST_CHECK( fiber_info == f.info() );
+        ctx::fiber_cpu_usage usage = ctx::fiber_usage( f.info() );
+        BOOST_CHECK_EQUAL( std::uint64_t( 1), usage.resumes);
+        BOOST_CHECK( usage.max_slice <= usage.run_time);
+        for ( int i = 0; i < 3; ++i) {
+            f = std::move( f).resume();
+        }
+        BOOST_CHECK( ! f);
+    }
+    ctx::stop_fiber_accounting();
+    // the last run is still in progress
+    BOOST_CHECK_EQUAL( std::uint64_t( 4), inner.resumes);
+    BOOST_CHECK( inner.max_slice <= inner.run_time);
+    BOOST_CHECK( inner.max_slice.count() >= 0);
+    ctx::fiber_info * main_info = ctx::current_fiber_info();
+    BOOST_CHECK( ctx::fiber_usage( main_info).resumes >= 4);
+    ctx::reset_fiber_usage( main_info);
+    BOOST_CHECK_EQUAL( std::uint64_t( 0), ctx::fiber_usage( main_info).resumes);
+}
+
+void test_counters() {
+    if ( ! ctx::start_fiber_counters() ) {
+        BOOST_CHECK( ctx::fiber_counters_access::none == ctx::fiber_counters_access_of_thread() );
+        BOOST_TEST_MESSAGE( "hardware counters not available");
+        return;
+    }
+    BOOST_CHECK( ctx::fiber_counters_access::none != ctx::fiber_counters_access_of_thread() );
+    ctx::fiber_counters counters;
+    volatile std::uint64_t sum = 0;
+    {
+        ctx::fiber f{
+            [&counters,&sum]( ctx::fiber && f) {
+                for ( std::uint64_t i = 0; i < 100000; ++i) {
+                    sum += i;
+                }
+                f = std::move( f).resume();
+                counters = ctx::fiber_counters_of( ctx::current_fiber_info() );
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        f = std::move( f).resume();
+    }
+    ctx::stop_fiber_counters();
+    BOOST_CHECK( 100000 < counters.instructions);
+}
+
+void test_registry() {
+    BOOST_CHECK( ctx::start_fiber_registry() );
+    std::size_t count = ctx::fiber_count();
+    {
+        ctx::fiber f1{
+            []( ctx::fiber && f) {
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        ctx::fiber f2{
+            []( ctx::fiber && f) {
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f1 = std::move( f1).resume();
+        BOOST_CHECK_EQUAL( count + 2, ctx::fiber_count() );
+        std::size_t suspended = 0, created = 0;
+        ctx::for_each_fiber(
+            [&suspended,&created]( ctx::fiber_info & info) {
+                suspended += ctx::fiber_state::suspended == ctx::fiber_state_of( & info) ? 1 : 0;
+                created += ctx::fiber_state::created == ctx::fiber_state_of( & info) ? 1 : 0;
+                BOOST_CHECK( nullptr != info.sctx.sp);
+            });
+        BOOST_CHECK_EQUAL( std::size_t( 1), suspended);
+        BOOST_CHECK_EQUAL( std::size_t( 1), created);
+        f1 = std::move( f1).resume();
+        BOOST_CHECK( ! f1);
+        BOOST_CHECK_EQUAL( count + 1, ctx::fiber_count() );
+        f2 = std::move( f2).resume();
+        f2 = std::move( f2).resume();
+        BOOST_CHECK( ! f2);
+    }
+    BOOST_CHECK_EQUAL( count, ctx::fiber_count() );
+    ctx::stop_fiber_registry();
+}
+
+BOOST_NOINLINE
+std::uint64_t spin( std::chrono::milliseconds duration) {
+    std::uint64_t n = 0;
+    auto start = std::chrono::steady_clock::now();
+    while ( std::chrono::steady_clock::now() - start < duration) {
+        ++n;
+    }
+    return n;
+}
+
+void test_profiler() {
+    if ( ! ctx::start_fiber_profiler( std::chrono::microseconds( 500) ) ) {
+        BOOST_TEST_MESSAGE( "profiler not supported");
+        return;
+    }
+    // already running
+    BOOST_CHECK( ! ctx::start_fiber_profiler( std::chrono::microseconds( 500), 1024) );
+    ctx::clear_fiber_profile();
+    {
+        ctx::fiber parked{
+            []( ctx::fiber && f) {
+                ctx::current_fiber_info()->label = "parked";
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        parked = std::move( parked).resume();
+        ctx::fiber spinner{
+            []( ctx::fiber && f) {
+                ctx::current_fiber_info()->label = "spinner";
+                for ( int i = 0; i < 5; ++i) {
+                    spin( std::chrono::milliseconds( 20) );
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        for ( int i = 0; i < 6; ++i) {
+            spinner = std::move( spinner).resume();
+        }
+        BOOST_CHECK( ! spinner);
+        BOOST_CHECK_EQUAL( std::size_t( 1), ctx::sample_parked_fibers() );
+    }
+    ctx::stop_fiber_profiler();
+    std::ostringstream os;
+    ctx::write_fiber_profile_collapsed( os);
+    std::string str = os.str();
+    BOOST_CHECK( std::string::npos != str.find( "\nspinner;") || 0 == str.find( "spinner;") );
+    BOOST_CHECK( std::string::npos != str.find( "[parked];parked;") );
+    ctx::clear_fiber_profile();
+    // restarted with another buffer while other threads are interrupted
+    std::atomic< bool > done{ false };
+    std::thread other{ [&done](){
+        while ( ! done.load() ) {
+            spin( std::chrono::milliseconds( 1) );
+        }
+    }};
+    for ( std::size_t capacity = 64; capacity <= 1024; capacity *= 2) {
+        BOOST_REQUIRE( ctx::start_fiber_profiler( std::chrono::microseconds( 100), capacity) );
+        spin( std::chrono::milliseconds( 10) );
+        ctx::stop_fiber_profiler();
+    }
+    done = true;
+    other.join();
+    ctx::clear_fiber_profile();
+}
+
+void test_histogram_buckets() {
+    typedef ctx::fiber_histogram histogram;
+    for ( std::uint64_t v : { 0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456789ull, ~0ull }) {
+        std::size_t b = histogram::bucket_of( v);
+        BOOST_CHECK( b < histogram::bucket_count);
+        BOOST_CHECK( histogram::lower_bound( b) <= v);
+        if ( b + 1 < histogram::bucket_count) {
+            BOOST_CHECK( v < histogram::lower_bound( b + 1) );
+        }
+    }
+    BOOST_CHECK_EQUAL( histogram::bucket_count - 1, histogram::bucket_of( ~0ull) );
+    histogram h;
+    h.frequency = 1e9;
+    for ( std::uint64_t v = 1; v <= 1000; ++v) {
+        ++h.counts[histogram::bucket_of( v)];
+        ++h.count;
+        h.sum += v;
+    }
+    histogram m;
+    m.merge( h);
+    m.merge( h);
+    BOOST_CHECK_EQUAL( std::uint64_t( 2000), m.count);
+    // within the resolution of 1/16
+    BOOST_CHECK( m.percentile( 0.5).count() >= 500);
+    BOOST_CHECK( m.percentile( 0.5).count() <= 500 + 500 / 16);
+    BOOST_CHECK_EQUAL( 500, m.mean().count() );
+}
+
+void test_histograms() {
+    BOOST_CHECK( ctx::start_fiber_histograms() );
+    ctx::reset_fiber_histograms();
+    {
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                for ( int i = 0; i < 9; ++i) {
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        for ( int i = 0; i < 10; ++i) {
+            f = std::move( f).resume();
+        }
+    }
+    ctx::stop_fiber_histograms();
+    ctx::fiber_histograms h = ctx::fiber_histograms_snapshot();
+    BOOST_CHECK_EQUAL( std::uint64_t( 10), h.run_slice.count);
+    BOOST_CHECK_EQUAL( std::uint64_t( 10), h.scheduling_delay.count);
+    BOOST_CHECK( h.run_slice.percentile( 0.5) <= h.run_slice.percentile( 0.99) );
+    BOOST_CHECK( ! ctx::fiber_histograms_per_thread().empty() );
+    std::string text;
+    ctx::write_fiber_histograms_prometheus(
+        [&text]( std::string const& str) {
+            text += str;
+        });
+    BOOST_CHECK( std::string::npos != text.find( "# TYPE boost_context_fiber_run_slice_seconds histogram\n") );
+    BOOST_CHECK( std::string::npos != text.find( "boost_context_fiber_run_slice_seconds_count 10\n") );
+    BOOST_CHECK( std::string::npos != text.find( "boost_context_fiber_scheduling_delay_seconds_bucket{le=\"+Inf\"} 10\n") );
+}
+
+void test_memory_report() {
+    BOOST_CHECK( ctx::start_fiber_registry() );
+    {
+        ctx::fiber f1{
+            std::allocator_arg, ctx::fixedsize_stack( 64 * 1024),
+            []( ctx::fiber && f) {
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        ctx::fiber f2{
+            std::allocator_arg, ctx::protected_fixedsize_stack( 64 * 1024),
+            []( ctx::fiber && f) {
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f1 = std::move( f1).resume();
+        f2 = std::move( f2).resume();
+        std::vector< ctx::fiber_stack > stacks = ctx::fiber_stacks();
+        BOOST_REQUIRE_EQUAL( std::size_t( 2), stacks.size() );
+        for ( ctx::fiber_stack const& s : stacks) {
+            BOOST_CHECK( ctx::fiber_state::suspended == s.state);
+            BOOST_CHECK( 64 * 1024 <= s.reserved);
+            BOOST_CHECK( 0 < s.committed);
+            BOOST_CHECK( s.committed <= s.reserved);
+            // the top of the stack has been used
+            BOOST_CHECK( 0 < s.resident);
+        }
+        std::vector< ctx::fiber_memory > report = ctx::fiber_memory_report();
+        BOOST_REQUIRE_EQUAL( std::size_t( 2), report.size() );
+        std::size_t i = std::string::npos != report[0].allocator.find( "protected") ? 0 : 1;
+        BOOST_CHECK( std::string::npos != report[i].allocator.find( "basic_protected_fixedsize_stack") );
+        BOOST_CHECK_EQUAL( std::size_t( 1), report[i].fibers);
+#if defined(__linux__)
+        // guard page
+        BOOST_CHECK( report[i].committed < report[i].reserved);
+#endif
+        std::ostringstream os;
+        ctx::write_fiber_memory_report( os);
+        BOOST_CHECK( std::string::npos != os.str().find( "total") );
+        f1 = std::move( f1).resume();
+        f2 = std::move( f2).resume();
+    }
+    BOOST_CHECK( ctx::fiber_stacks().empty() );
+    ctx::stop_fiber_registry();
+}
+
+std::atomic< int > watchdog_reports{ 0 };
+char const* watchdog_label = nullptr;
+std::size_t watchdog_depth = 0;
+
+void on_stall( ctx::fiber_watchdog_report const& report) {
+    watchdog_label = report.label;
+    watchdog_depth = report.depth;
+    ++watchdog_reports;
+}
+
+void test_watchdog() {
+    if ( ! ctx::start_fiber_watchdog( std::chrono::milliseconds( 20), on_stall) ) {
+        BOOST_TEST_MESSAGE( "fiber watchdog not supported");
+        return;
+    }
+    {
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                ctx::current_fiber_info()->label = "spinner";
+                spin( std::chrono::milliseconds( 200) );
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        // the main context is not watched
+        spin( std::chrono::milliseconds( 100) );
+        f = std::move( f).resume();
+    }
+    ctx::stop_fiber_watchdog();
+    // reported once per stall
+    BOOST_CHECK_EQUAL( 1, watchdog_reports.load() );
+    BOOST_CHECK_EQUAL( std::string{ "spinner" }, std::string{ nullptr != watchdog_label ? watchdog_label : "" });
+    BOOST_CHECK( 1 <= watchdog_depth);
+}
+
+ctx::fiber_frame backtrace_frames[64];
+std::size_t backtrace_depth = 0;
+
+BOOST_NOINLINE
+void capture_backtrace() {
+    backtrace_depth = ctx::fiber_backtrace( backtrace_frames, 64);
+}
+
+void test_backtrace() {
+    if ( ! ctx::start_fiber_backtrace() ) {
+        BOOST_TEST_MESSAGE( "fiber backtrace not supported");
+        return;
+    }
+    ctx::fiber_info * main_info = ctx::current_fiber_info();
+    ctx::fiber_info * outer_info = nullptr;
+    ctx::fiber_info * inner_info = nullptr;
+    ctx::fiber_frame parked_frames[64];
+    std::size_t parked_depth = 0;
+    {
+        ctx::fiber outer{
+            [&]( ctx::fiber && f) {
+                outer_info = ctx::current_fiber_info();
+                outer_info->label = "outer";
+                ctx::fiber inner{
+                    [&]( ctx::fiber && f) {
+                        inner_info = ctx::current_fiber_info();
+                        inner_info->label = "inner";
+                        capture_backtrace();
+                        f = std::move( f).resume();
+                        return std::move( f);
+                    }};
+                inner = std::move( inner).resume();
+                parked_depth = ctx::parked_fiber_backtrace( inner.info(), parked_frames, 64);
+                inner = std::move( inner).resume();
+                f = std::move( f).resume();
+                return std::move( f);
+            }};
+        outer = std::move( outer).resume();
+        outer = std::move( outer).resume();
+    }
+    ctx::stop_fiber_backtrace();
+    // frames of inner, of outer and of the main context - innermost first
+    std::vector< ctx::fiber_info * > contexts;
+    for ( std::size_t i = 0; i < backtrace_depth; ++i) {
+        if ( contexts.empty() || contexts.back() != backtrace_frames[i].fiber) {
+            contexts.push_back( backtrace_frames[i].fiber);
+        }
+    }
+    BOOST_REQUIRE_EQUAL( std::size_t( 3), contexts.size() );
+    BOOST_CHECK( inner_info == contexts[0]);
+    BOOST_CHECK( outer_info == contexts[1]);
+    BOOST_CHECK( main_info == contexts[2]);
+    BOOST_CHECK( 0 < parked_depth);
+    BOOST_CHECK( inner_info == parked_frames[0].fiber);
+    std::ostringstream os;
+    ctx::write_fiber_backtrace( os, backtrace_frames, backtrace_depth);
+    BOOST_CHECK( std::string::npos != os.str().find( "--- inner\n#0 ") );
+    BOOST_CHECK( std::string::npos != os.str().find( "--- outer\n") );
+}
+
+std::atomic< int > qsbr_deleted{ 0 };
+
+struct retired_object {
+    ~retired_object() {
+        ++qsbr_deleted;
+    }
+};
+
+void wait_for( std::atomic< int > & step, int value) {
+    while ( value != step.load() ) {
+        std::this_thread::yield();
+    }
+}
+
+void test_qsbr() {
+    BOOST_REQUIRE( ctx::start_fiber_qsbr() );
+    std::atomic< int > step{ 0 };
+    std::thread reader{ [&step](){
+        ctx::fiber_qsbr_online();
+        step = 1;
+        wait_for( step, 2);
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                return std::move( f);
+            }};
+        f = std::move( f).resume();
+        step = 3;
+        wait_for( step, 4);
+        ctx::fiber_qsbr_offline();
+        step = 5;
+        wait_for( step, 6);
+    }};
+    wait_for( step, 1);
+    ctx::fiber_retire( new retired_object{} );
+    // the reader has not passed a quiescent state
+    BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 0, qsbr_deleted.load() );
+    // the switch back to the main context is a quiescent state
+    step = 2;
+    wait_for( step, 3);
+    BOOST_CHECK_EQUAL( std::size_t( 1), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 1, qsbr_deleted.load() );
+    // offline threads do not delay grace periods, the online calling thread
+    // does
+    step = 4;
+    wait_for( step, 5);
+    ctx::fiber_qsbr_online();
+    for ( int i = 0; i < BOOST_CONTEXT_QSBR_BATCH; ++i) {
+        ctx::fiber_retire( new retired_object{} );
+    }
+    BOOST_CHECK_EQUAL( 1, qsbr_deleted.load() );
+    BOOST_CHECK_EQUAL( std::size_t( BOOST_CONTEXT_QSBR_BATCH), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 1 + BOOST_CONTEXT_QSBR_BATCH, qsbr_deleted.load() );
+    ctx::fiber_qsbr_offline();
+    step = 6;
+    reader.join();
+    ctx::stop_fiber_qsbr();
+}
+
+void test_qsbr_writer() {
+    BOOST_REQUIRE( ctx::start_fiber_qsbr() );
+    qsbr_deleted = 0;
+    std::atomic< bool > done{ false };
+    std::thread worker{ [&done](){
+        ctx::fiber f{
+            [&done]( ctx::fiber && f) {
+                while ( ! done.load( std::memory_order_relaxed) ) {
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        while ( f) {
+            f = std::move( f).resume();
+        }
+    }};
+    // the writer never switches and only retires objects
+    std::atomic< int > deleted{ 0 };
+    std::thread writer{ [&deleted](){
+        constexpr int n = 100 * BOOST_CONTEXT_QSBR_BATCH;
+        for ( int i = 0; i < n; ++i) {
+            ctx::fiber_retire( new retired_object{} );
+        }
+        for ( int i = 0; i < 10000 && n != qsbr_deleted.load(); ++i) {
+            ctx::fiber_qsbr_reclaim();
+            std::this_thread::yield();
+        }
+        deleted = qsbr_deleted.load();
+    }};
+    writer.join();
+    done = true;
+    worker.join();
+    BOOST_CHECK_EQUAL( 100 * BOOST_CONTEXT_QSBR_BATCH, deleted.load() );
+    ctx::stop_fiber_qsbr();
+}
+
+void test_qsbr_nested() {
+    BOOST_REQUIRE( ctx::start_fiber_qsbr() );
+    qsbr_deleted = 0;
+    std::atomic< int > step{ 0 };
+    std::thread reader{ [&step](){
+        ctx::fiber f{
+            [&step]( ctx::fiber && f) {
+                // switches between fibers while holding a reference
+                ctx::fiber inner{
+                    []( ctx::fiber && f) {
+                        return std::move( f);
+                    }};
+                step = 1;
+                wait_for( step, 2);
+                inner = std::move( inner).resume();
+                step = 3;
+                wait_for( step, 4);
+                return std::move( f);
+            }};
+        ctx::fiber_qsbr_online();
+        f = std::move( f).resume();
+        ctx::fiber_qsbr_offline();
+        step = 5;
+    }};
+    wait_for( step, 1);
+    ctx::fiber_retire( new retired_object{} );
+    // the grace period starts
+    BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_qsbr_reclaim() );
+    step = 2;
+    wait_for( step, 3);
+    // the reader has not returned to its main context
+    BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 0, qsbr_deleted.load() );
+    step = 4;
+    wait_for( step, 5);
+    reader.join();
+    BOOST_CHECK_EQUAL( std::size_t( 1), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 1, qsbr_deleted.load() );
+    ctx::stop_fiber_qsbr();
+    // every switch is a quiescent state
+    BOOST_REQUIRE( ctx::start_fiber_qsbr( ctx::fiber_qsbr_mode::every_switch) );
+    step = 0;
+    std::thread other{ [&step](){
+        ctx::fiber f{
+            [&step]( ctx::fiber && f) {
+                ctx::fiber inner{
+                    []( ctx::fiber && f) {
+                        return std::move( f);
+                    }};
+                step = 1;
+                wait_for( step, 2);
+                inner = std::move( inner).resume();
+                step = 3;
+                wait_for( step, 4);
+                return std::move( f);
+            }};
+        ctx::fiber_qsbr_online();
+        f = std::move( f).resume();
+        ctx::fiber_qsbr_offline();
+    }};
+    wait_for( step, 1);
+    ctx::fiber_retire( new retired_object{} );
+    BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_qsbr_reclaim() );
+    step = 2;
+    wait_for( step, 3);
+    BOOST_CHECK_EQUAL( std::size_t( 1), ctx::fiber_qsbr_reclaim() );
+    BOOST_CHECK_EQUAL( 2, qsbr_deleted.load() );
+    step = 4;
+    other.join();
+    ctx::stop_fiber_qsbr();
+}
+
+void test_qsbr_first_run() {
+    BOOST_REQUIRE( ctx::start_fiber_qsbr() );
+    qsbr_deleted = 0;
+    std::atomic< int > step{ 0 };
+    std::thread reader{ [&step](){
+        // neither fiber_qsbr_online() nor a previous switch
+        for ( int run = 0; run < 2; ++run) {
+            wait_for( step, 4 * run);
+            ctx::fiber f{
+                [&step,run]( ctx::fiber && f) {
+                    // holds a reference to the object retired below
+                    step = 4 * run + 1;
+                    wait_for( step, 4 * run + 2);
+                    return std::move( f);
+                }};
+            f = std::move( f).resume();
+            // offline again before the second run
+            ctx::fiber_qsbr_offline();
+            step = 4 * run + 3;
+        }
+    }};
+    for ( int run = 0; run < 2; ++run) {
+        wait_for( step, 4 * run + 1);
+        ctx::fiber_retire( new retired_object{} );
+        // the reader is online during the run of its fiber
+        BOOST_CHECK_EQUAL( std::size_t( 0), ctx::fiber_qsbr_reclaim() );
+        BOOST_CHECK_EQUAL( run, qsbr_deleted.load() );
+        step = 4 * run + 2;
+        wait_for( step, 4 * run + 3);
+        BOOST_CHECK_EQUAL( std::size_t( 1), ctx::fiber_qsbr_reclaim() );
+        BOOST_CHECK_EQUAL( run + 1, qsbr_deleted.load() );
+        step = 4 * run + 4;
+    }
+    reader.join();
+    ctx::stop_fiber_qsbr();
+}
+
+void test_qsbr_periodic() {
+    BOOST_REQUIRE( ctx::start_fiber_qsbr() );
+    qsbr_deleted = 0;
+    // less than a batch, the writer neither retires nor reclaims afterwards
+    ctx::fiber_retire( new retired_object{} );
+    std::atomic< int > deleted{ 0 };
+    std::thread worker{ [&deleted](){
+        ctx::fiber f{
+            []( ctx::fiber && f) {
+                for (;;) {
+                    f = std::move( f).resume();
+                }
+                return std::move( f);
+            }};
+        // the first reclamation seals the batch, the second deletes it
+        for ( int i = 0; i < 2 * BOOST_CONTEXT_QSBR_INTERVAL; ++i) {
+            f = std::move( f).resume();
+        }
+        deleted = qsbr_deleted.load();
+        ctx::fiber_qsbr_offline();
+    }};
+    worker.join();
+    BOOST_CHECK_EQUAL( 1, deleted.load() );
+    ctx::stop_fiber_qsbr();
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
+{
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Context: fiber hooks test suite");
+
+    test->add( BOOST_TEST_CASE( & test_resume) );
+    test->add( BOOST_TEST_CASE( & test_resume_with) );
+    test->add( BOOST_TEST_CASE( & test_unwind) );
+    test->add( BOOST_TEST_CASE( & test_remove) );
+    test->add( BOOST_TEST_CASE( & test_hooks_data) );
+    test->add( BOOST_TEST_CASE( & test_ids) );
+    test->add( BOOST_TEST_CASE( & test_trace) );
+    test->add( BOOST_TEST_CASE( & test_trace_reuse) );
+    test->add( BOOST_TEST_CASE( & test_trace_concurrent) );
+    test->add( BOOST_TEST_CASE( & test_accounting) );
+    test->add( BOOST_TEST_CASE( & test_counters) );
+    test->add( BOOST_TEST_CASE( & test_registry) );
+    test->add( BOOST_TEST_CASE( & test_profiler) );
+    test->add( BOOST_TEST_CASE( & test_histogram_buckets) );
+    test->add( BOOST_TEST_CASE( & test_histograms) );
+    test->add( BOOST_TEST_CASE( & test_memory_report) );
+    test->add( BOOST_TEST_CASE( & test_watchdog) );
+    test->add( BOOST_TEST_CASE( & test_backtrace) );
+    test->add( BOOST_TEST_CASE( & test_qsbr) );
+    test->add( BOOST_TEST_CASE( & test_qsbr_writer) );
+    test->add( BOOST_TEST_CASE( & test_qsbr_nested) );
+    test->add( BOOST_TEST_CASE( & test_qsbr_first_run) );
+    test->add( BOOST_TEST_CASE( & test_qsbr_periodic) );
+
+    return test;
+}
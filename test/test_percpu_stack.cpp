@@ -0,0 +1,286 @@
+//          Copyright Oliver Kowalke 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/context/detail/rseq.hpp>
+#include <boost/context/percpu_fixedsize_stack.hpp>
+
+#if defined(__linux__)
+extern "C" {
+#include <sched.h>
+}
+#endif
+
+#include "allocations.hpp"
+
+namespace ctx = boost::context;
+
+// compiled twice: with rseq (if available) and with BOOST_CONTEXT_NO_RSEQ,
+// which exercises the atomic fallback
+
+const std::size_t max_cached = 4;
+
+// binds the calling thread to `cpu`; returns false if not supported
+bool pin( std::size_t cpu) noexcept {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO( & set);
+    CPU_SET( cpu, & set);
+    return 0 == ::sched_setaffinity( 0, sizeof( set), & set);
+#else
+    ( void) cpu;
+    return false;
+#endif
+}
+
+void unpin() noexcept {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO( & set);
+    for ( std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        CPU_SET( cpu, & set);
+    }
+    ::sched_setaffinity( 0, sizeof( set), & set);
+#endif
+}
+
+void test_rseq_slots() {
+#if defined(BOOST_CONTEXT_HAS_RSEQ)
+    struct rseq * rs = ctx::detail::rseq_area();
+    if ( nullptr == rs) {
+        BOOST_TEST_MESSAGE( "rseq is not registered");
+        return;
+    }
+    // count followed by the slots
+    std::uintptr_t words[1 + max_cached] = { 0 };
+    auto push = [rs,&words]( std::uintptr_t p) {
+        for (;;) {
+            int result = ctx::detail::rseq_push( rs, ctx::detail::rseq_cpu( rs), words, max_cached, p);
+            if ( 0 <= result) {
+                return result;
+            }
+        }
+    };
+    auto pop = [rs,&words]( std::uintptr_t & p) {
+        for (;;) {
+            int result = ctx::detail::rseq_pop( rs, ctx::detail::rseq_cpu( rs), words, & p);
+            if ( 0 <= result) {
+                return result;
+            }
+        }
+    };
+    // more than the slots hold
+    for ( std::uintptr_t p = 1; p <= max_cached + 3; ++p) {
+        BOOST_CHECK_EQUAL( p <= max_cached ? 0 : 1, push( p) );
+    }
+    BOOST_CHECK_EQUAL( max_cached, words[0]);
+    // each stored value exactly once, last in first out
+    for ( std::uintptr_t expected = max_cached; 0 < expected; --expected) {
+        std::uintptr_t p = 0;
+        BOOST_CHECK_EQUAL( 0, pop( p) );
+        BOOST_CHECK_EQUAL( expected, p);
+    }
+    std::uintptr_t p = 0;
+    BOOST_CHECK_EQUAL( 1, pop( p) );
+    BOOST_CHECK_EQUAL( std::uintptr_t( 0), words[0]);
+#else
+    BOOST_TEST_MESSAGE( "built without rseq");
+#endif
+}
+
+void test_overflow() {
+    const std::size_t n = 3 * max_cached;
+    std::vector< ctx::stack_context > first( n), second( n);
+    std::size_t allocated = allocations();
+    std::size_t deallocated = deallocations();
+    // the cache of one CPU
+    bool pinned = pin( ctx::detail::current_cpu() );
+    {
+        ctx::percpu_fixedsize_stack salloc{ ctx::stack_traits::default_size(), max_cached };
+        for ( ctx::stack_context & sctx : first) {
+            sctx = salloc.allocate();
+        }
+        // max_cached stacks are cached, the others are freed
+        for ( ctx::stack_context & sctx : first) {
+            salloc.deallocate( sctx);
+        }
+        std::size_t m = count_allocations( [&salloc,&second](){
+            for ( ctx::stack_context & sctx : second) {
+                sctx = salloc.allocate();
+            }
+        });
+        if ( pinned) {
+            BOOST_CHECK_EQUAL( n - max_cached, m);
+        }
+        // no stack is handed out twice
+        std::vector< void * > sp;
+        for ( ctx::stack_context & sctx : second) {
+            sp.push_back( sctx.sp);
+        }
+        std::sort( sp.begin(), sp.end() );
+        BOOST_CHECK( sp.end() == std::adjacent_find( sp.begin(), sp.end() ) );
+        for ( ctx::stack_context & sctx : second) {
+            salloc.deallocate( sctx);
+        }
+    }
+    unpin();
+    // the caches are released with the allocator, no stack is lost
+    BOOST_CHECK_EQUAL( allocations() - allocated, deallocations() - deallocated);
+}
+
+// stacks handed out and not yet returned; open addressing, no allocations
+class owned_stacks {
+private:
+    static constexpr std::size_t size = 1 << 14;
+
+    std::mutex                  mtx_{};
+    void                    *   slots_[size] = {};
+
+    static std::size_t hash( void * sp) noexcept {
+        return ( reinterpret_cast< std::uintptr_t >( sp) >> 12) % size;
+    }
+
+public:
+    // returns false if `sp` is already owned
+    bool insert( void * sp) noexcept {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        std::size_t i = hash( sp);
+        while ( nullptr != slots_[i]) {
+            if ( sp == slots_[i]) {
+                return false;
+            }
+            i = ( i + 1) % size;
+        }
+        slots_[i] = sp;
+        return true;
+    }
+
+    // returns false if `sp` is not owned
+    bool erase( void * sp) noexcept {
+        std::unique_lock< std::mutex > lk{ mtx_ };
+        std::size_t i = hash( sp);
+        while ( sp != slots_[i]) {
+            if ( nullptr == slots_[i]) {
+                return false;
+            }
+            i = ( i + 1) % size;
+        }
+        // re-insert the rest of the cluster
+        slots_[i] = nullptr;
+        for ( i = ( i + 1) % size; nullptr != slots_[i]; i = ( i + 1) % size) {
+            void * moved = slots_[i];
+            slots_[i] = nullptr;
+            std::size_t j = hash( moved);
+            while ( nullptr != slots_[j]) {
+                j = ( j + 1) % size;
+            }
+            slots_[j] = moved;
+        }
+        return true;
+    }
+};
+
+owned_stacks owned;
+
+// spins until `count` reaches `n`
+void wait_for( std::atomic< std::size_t > & count, std::size_t n) noexcept {
+    while ( count.load( std::memory_order_acquire) < n) {
+        std::this_thread::yield();
+    }
+}
+
+void test_threads() {
+    // frees of an allocator without cached stacks
+    std::size_t empty = deallocations();
+    {
+        std::unique_ptr< ctx::percpu_fixedsize_stack > salloc{
+            new ctx::percpu_fixedsize_stack{ ctx::stack_traits::minimum_size(), max_cached } };
+    }
+    empty = deallocations() - empty;
+    // more threads than CPUs, migrating between the CPUs
+    std::size_t cpus = (std::max)( std::thread::hardware_concurrency(), 1u);
+    std::size_t threads = 4 * cpus;
+    std::atomic< std::size_t > duplicates{ 0 };
+    std::atomic< std::size_t > unknown{ 0 };
+    std::atomic< std::size_t > started{ 0 };
+    std::atomic< std::size_t > finished{ 0 };
+    std::atomic< std::size_t > go{ 0 };
+    std::atomic< std::size_t > exit{ 0 };
+    std::unique_ptr< ctx::percpu_fixedsize_stack > salloc{
+        new ctx::percpu_fixedsize_stack{ ctx::stack_traits::minimum_size(), max_cached } };
+    std::vector< std::thread > pool;
+    for ( std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back( [&,cpus,t](){
+            ++started;
+            wait_for( go, 1);
+            for ( std::size_t i = 0; i < 5000; ++i) {
+                if ( 0 == i % 100) {
+                    pin( ( t + i / 100) % cpus);
+                }
+                ctx::stack_context sctx[3];
+                std::size_t n = 1 + ( t + i) % 3;
+                for ( std::size_t j = 0; j < n; ++j) {
+                    sctx[j] = salloc->allocate();
+                    if ( ! owned.insert( sctx[j].sp) ) {
+                        ++duplicates;
+                    }
+                }
+                if ( 0 == i % 7) {
+                    std::this_thread::yield();
+                }
+                for ( std::size_t j = 0; j < n; ++j) {
+                    if ( ! owned.erase( sctx[j].sp) ) {
+                        ++unknown;
+                    }
+                    salloc->deallocate( sctx[j]);
+                }
+            }
+            // the allocations of thread exit are not counted
+            ++finished;
+            wait_for( exit, 1);
+        });
+    }
+    wait_for( started, threads);
+    std::size_t allocated = allocations();
+    std::size_t deallocated = deallocations();
+    go = 1;
+    wait_for( finished, threads);
+    // stacks neither freed nor handed out are in the caches
+    std::size_t cached = ( allocations() - allocated) - ( deallocations() - deallocated);
+    deallocated = deallocations();
+    salloc.reset();
+    std::size_t released = deallocations() - deallocated;
+    exit = 1;
+    for ( std::thread & t : pool) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL( std::size_t( 0), duplicates.load() );
+    BOOST_CHECK_EQUAL( std::size_t( 0), unknown.load() );
+    // no stack is lost: the allocator frees every cached stack
+    BOOST_CHECK( 0 < cached);
+    BOOST_CHECK_EQUAL( cached + empty, released);
+}
+
+boost::unit_test::test_suite * init_unit_test_suite( int, char* [])
+{
+    boost::unit_test::test_suite * test =
+        BOOST_TEST_SUITE("Boost.Context: percpu_fixedsize_stack test suite");
+
+    test->add( BOOST_TEST_CASE( & test_rseq_slots) );
+    test->add( BOOST_TEST_CASE( & test_overflow) );
+    test->add( BOOST_TEST_CASE( & test_threads) );
+
+    return test;
+}